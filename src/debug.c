@@ -87,12 +87,15 @@ static int g_trace_indent       = 0;
 
 int trace_enabled(void)
 {
+    /* Called from the decode paths of several threads at once */
     static int g_trace_enabled = -1;
-    if (g_trace_enabled < 0) {
-        if (getenv_yesno("VDPAU_VIDEO_TRACE", &g_trace_enabled) < 0)
-            g_trace_enabled = 0;
+    int enabled = __atomic_load_n(&g_trace_enabled, __ATOMIC_RELAXED);
+    if (enabled < 0) {
+        if (getenv_yesno("VDPAU_VIDEO_TRACE", &enabled) < 0)
+            enabled = 0;
+        __atomic_store_n(&g_trace_enabled, enabled, __ATOMIC_RELAXED);
     }
-    return g_trace_enabled;
+    return enabled;
 }
 
 static int trace_indent_width(void)
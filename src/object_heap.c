@@ -48,6 +48,127 @@
 
 #define LAST_FREE   -1
 #define ALLOCATED   -2
+#define CACHED      -3 /* free, but held in a thread magazine */
+
+/* Lookups run without the heap mutex. Writers publish new buckets and
+   objects with release semantics, readers pick them up with acquire
+   semantics */
+#define atomic_load_acquire(p)          __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomic_store_release(p, v)      __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+/* Smallest (first) bucket holds 1 << OBJECT_HEAP_MIN_BUCKET_SHIFT objects */
+#define OBJECT_HEAP_MIN_BUCKET_SHIFT    4
+#define OBJECT_HEAP_MAX_BUCKET_SHIFT    16
+
+/* Occupancy bitmap words */
+#define BITMAP_BITS     (8 * sizeof(unsigned long))
+
+/*
+ * Buckets grow geometrically: bucket k holds (1 << (bucket_shift + k))
+ * objects, so that object index i lives in the bucket designated by the
+ * most significant bit of (i + (1 << bucket_shift)), at the offset
+ * given by the remaining bits.
+ */
+static inline void
+object_heap_locate(
+    object_heap_p       heap,
+    int                 index,
+    int                *bucket_index,
+    unsigned int       *obj_index
+)
+{
+    const unsigned int n = index + (1U << heap->bucket_shift);
+    const int msb = 31 - __builtin_clz(n);
+
+    *bucket_index = msb - heap->bucket_shift;
+    *obj_index = n ^ (1U << msb);
+}
+
+static inline object_base_p
+object_heap_get(object_heap_p heap, void * const *bucket, int index)
+{
+    int bucket_index;
+    unsigned int obj_index;
+    void *base;
+
+    object_heap_locate(heap, index, &bucket_index, &obj_index);
+    base = atomic_load_acquire(&bucket[bucket_index]);
+    return (object_base_p)(base + obj_index * heap->object_size);
+}
+
+/*
+ * Updates the occupancy bitmap. Objects in thread magazines are
+ * allocated and freed without the heap mutex, hence the atomics
+ */
+static inline void
+object_heap_set_allocated(object_heap_p heap, int index, int allocated)
+{
+    int bucket_index;
+    unsigned int obj_index;
+    unsigned long *word, mask;
+
+    object_heap_locate(heap, index, &bucket_index, &obj_index);
+    word = &heap->bitmap[bucket_index][obj_index / BITMAP_BITS];
+    mask = 1UL << (obj_index % BITMAP_BITS);
+    if (allocated) {
+        int num_live, max_live;
+
+        __atomic_fetch_or(word, mask, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&heap->num_allocations, 1, __ATOMIC_RELAXED);
+        num_live = __atomic_add_fetch(&heap->num_live, 1, __ATOMIC_RELAXED);
+        max_live = __atomic_load_n(&heap->max_live, __ATOMIC_RELAXED);
+        while (num_live > max_live &&
+               !__atomic_compare_exchange_n(&heap->max_live, &max_live, num_live,
+                                            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+    }
+    else {
+        __atomic_fetch_and(word, ~mask, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&heap->num_live, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Returns the index of the first allocated object at or after INDEX,
+ * or -1 if there is none. Cost is proportional to the number of
+ * bitmap words scanned, not to the number of slots
+ */
+static int
+object_heap_next_index_unlocked(object_heap_p heap, int index)
+{
+    int bucket_index, bucket_end;
+    unsigned int obj_index, bit;
+    unsigned long word;
+
+    while (index < heap->heap_size) {
+        object_heap_locate(heap, index, &bucket_index, &obj_index);
+        bit = obj_index % BITMAP_BITS;
+        word = atomic_load_acquire(&heap->bitmap[bucket_index][obj_index / BITMAP_BITS]);
+        word &= ~0UL << bit;
+        if (word)
+            return index + (__builtin_ctzl(word) - bit);
+
+        /* Skip to the next word, without overrunning the bucket */
+        bucket_end = (2 << (heap->bucket_shift + bucket_index)) - (1 << heap->bucket_shift);
+        index += BITMAP_BITS - bit;
+        if (index > bucket_end)
+            index = bucket_end;
+    }
+    return -1;
+}
+
+/* Per-thread object cache */
+#define OBJECT_HEAP_MAGAZINE_SIZE       32
+#define OBJECT_HEAP_MAGAZINE_BATCH      (OBJECT_HEAP_MAGAZINE_SIZE / 2)
+
+typedef struct object_heap_magazine object_heap_magazine_t;
+struct object_heap_magazine {
+    object_heap_p               heap;
+    object_heap_magazine_t     *prev;
+    object_heap_magazine_t     *next;
+    int                         count;
+    int                         slots[OBJECT_HEAP_MAGAZINE_SIZE];
+};
 
 /*
  * Expands the heap
@@ -59,28 +180,35 @@ object_heap_expand(object_heap_p heap)
     int i;
     void *new_heap_index;
     int next_free;
-    int new_heap_size = heap->heap_size + heap->heap_increment;
-    int bucket_index = new_heap_size / heap->heap_increment - 1;
-
-    if (bucket_index >= heap->num_buckets) {
-        int new_num_buckets = heap->num_buckets + 8;
-        void **new_bucket;
+    int bucket_index = heap->num_buckets;
+    int new_heap_size;
 
-        new_bucket = realloc(heap->bucket, new_num_buckets * sizeof(void *));
-        if (NULL == new_bucket) {
-            return -1;
-        }
+    if (heap->heap_size > OBJECT_HEAP_INDEX_MASK) {
+        return -1; /* Out of IDs */
+    }
+    ASSERT(bucket_index < OBJECT_HEAP_MAX_BUCKETS);
 
-        heap->num_buckets = new_num_buckets;
-        heap->bucket = new_bucket;
+    new_heap_size = heap->heap_size + (1 << (heap->bucket_shift + bucket_index));
+    if (new_heap_size > OBJECT_HEAP_INDEX_MASK + 1) {
+        new_heap_size = OBJECT_HEAP_INDEX_MASK + 1;
     }
 
-    new_heap_index = (void *) malloc(heap->heap_increment * heap->object_size);
+    /* Objects start zeroed, so that they can tell state that outlives
+       them (e.g. an initialized lock) from a fresh slot */
+    new_heap_index = (void *) calloc(new_heap_size - heap->heap_size, heap->object_size);
     if (NULL == new_heap_index) {
         return -1; /* Out of memory */
     }
 
-    heap->bucket[bucket_index] = new_heap_index;
+    heap->bitmap[bucket_index] = calloc(
+        (new_heap_size - heap->heap_size + BITMAP_BITS - 1) / BITMAP_BITS,
+        sizeof(unsigned long)
+    );
+    if (NULL == heap->bitmap[bucket_index]) {
+        free(new_heap_index);
+        return -1; /* Out of memory */
+    }
+
     next_free = heap->next_free;
     for (i = new_heap_size; i-- > heap->heap_size;) {
         object_base_p obj = (object_base_p)(new_heap_index + (i - heap->heap_size) * heap->object_size);
@@ -88,8 +216,10 @@ object_heap_expand(object_heap_p heap)
         obj->next_free = next_free;
         next_free = i;
     }
+    atomic_store_release(&heap->bucket[bucket_index], new_heap_index);
+    heap->num_buckets++;
     heap->next_free = next_free;
-    heap->heap_size = new_heap_size;
+    atomic_store_release(&heap->heap_size, new_heap_size);
     return 0; /* Success */
 }
 
@@ -99,14 +229,43 @@ object_heap_expand(object_heap_p heap)
 int
 object_heap_init(object_heap_p heap, int object_size, int id_offset)
 {
-    pthread_mutex_init(&heap->mutex, NULL);
+    return object_heap_init_full(heap, object_size, id_offset, 0);
+}
+
+int
+object_heap_init_full(
+    object_heap_p       heap,
+    int                 object_size,
+    int                 id_offset,
+    unsigned int        num_objects_hint
+)
+{
+    int bucket_shift = OBJECT_HEAP_MIN_BUCKET_SHIFT;
+
+    while (bucket_shift < OBJECT_HEAP_MAX_BUCKET_SHIFT &&
+           (1U << bucket_shift) < num_objects_hint)
+        bucket_shift++;
+
+    /* Recursive so that iteration callbacks can free objects */
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_settype(&mutex_attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&heap->mutex, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
     heap->object_size = object_size;
     heap->id_offset = id_offset & OBJECT_HEAP_OFFSET_MASK;
     heap->heap_size = 0;
-    heap->heap_increment = 16;
+    heap->bucket_shift = bucket_shift;
     heap->next_free = LAST_FREE;
     heap->num_buckets = 0;
-    heap->bucket = NULL;
+    memset(heap->bucket, 0, sizeof(heap->bucket));
+    memset(heap->bitmap, 0, sizeof(heap->bitmap));
+    heap->num_live = 0;
+    heap->max_live = 0;
+    heap->num_allocations = 0;
+    heap->magazines = NULL;
+    heap->use_magazines = 0;
     return object_heap_expand(heap);
 }
 
@@ -118,7 +277,6 @@ static int
 object_heap_allocate_unlocked(object_heap_p heap)
 {
     object_base_p obj;
-    int bucket_index, obj_index;
 
     if (LAST_FREE == heap->next_free) {
         if (-1 == object_heap_expand(heap)) {
@@ -127,20 +285,170 @@ object_heap_allocate_unlocked(object_heap_p heap)
     }
     ASSERT(heap->next_free >= 0);
 
-    bucket_index = heap->next_free / heap->heap_increment;
-    obj_index = heap->next_free % heap->heap_increment;
-
-    obj = (object_base_p)(heap->bucket[bucket_index] + obj_index * heap->object_size);
+    obj = object_heap_get(heap, heap->bucket, heap->next_free);
+    object_heap_set_allocated(heap, heap->next_free, 1);
     heap->next_free = obj->next_free;
-    obj->next_free = ALLOCATED;
+    atomic_store_release(&obj->next_free, ALLOCATED);
     return obj->id;
 }
 
+/*
+ * Moves up to COUNT free objects into the magazine
+ * Returns the number of objects actually moved
+ */
+static int
+object_heap_magazine_fill_unlocked(
+    object_heap_p               heap,
+    object_heap_magazine_t     *magazine,
+    int                         count
+)
+{
+    object_base_p obj;
+    int n;
+
+    for (n = 0; n < count; n++) {
+        if (LAST_FREE == heap->next_free) {
+            if (-1 == object_heap_expand(heap)) {
+                break; /* Out of memory */
+            }
+        }
+        obj = object_heap_get(heap, heap->bucket, heap->next_free);
+        magazine->slots[magazine->count++] = heap->next_free;
+        heap->next_free = obj->next_free;
+        obj->next_free = CACHED;
+    }
+    return n;
+}
+
+/*
+ * Returns the last COUNT objects of the magazine to the free list
+ */
+static void
+object_heap_magazine_drain_unlocked(
+    object_heap_p               heap,
+    object_heap_magazine_t     *magazine,
+    int                         count
+)
+{
+    object_base_p obj;
+    int index;
+
+    while (count-- > 0 && magazine->count > 0) {
+        index = magazine->slots[--magazine->count];
+        obj = object_heap_get(heap, heap->bucket, index);
+        ASSERT(obj->next_free == CACHED);
+        obj->next_free = heap->next_free;
+        heap->next_free = index;
+    }
+}
+
+static void
+object_heap_magazine_destroy_unlocked(
+    object_heap_p               heap,
+    object_heap_magazine_t     *magazine
+)
+{
+    object_heap_magazine_drain_unlocked(heap, magazine, magazine->count);
+
+    if (magazine->prev)
+        magazine->prev->next = magazine->next;
+    else
+        heap->magazines = magazine->next;
+    if (magazine->next)
+        magazine->next->prev = magazine->prev;
+    free(magazine);
+}
+
+/* Called on thread exit */
+static void
+object_heap_magazine_destroy(void *data)
+{
+    object_heap_magazine_t * const magazine = data;
+    object_heap_p const heap = magazine->heap;
+
+    pthread_mutex_lock(&heap->mutex);
+    object_heap_magazine_destroy_unlocked(heap, magazine);
+    pthread_mutex_unlock(&heap->mutex);
+}
+
+/*
+ * Returns the magazine of the calling thread, creating it if needed
+ * Returns NULL if magazines are disabled or on error
+ */
+static object_heap_magazine_t *
+object_heap_magazine_get(object_heap_p heap)
+{
+    object_heap_magazine_t *magazine;
+
+    if (!heap->use_magazines) {
+        return NULL;
+    }
+
+    magazine = pthread_getspecific(heap->magazine_key);
+    if (magazine) {
+        return magazine;
+    }
+
+    magazine = malloc(sizeof(*magazine));
+    if (NULL == magazine) {
+        return NULL;
+    }
+    magazine->heap = heap;
+    magazine->prev = NULL;
+    magazine->count = 0;
+    if (pthread_setspecific(heap->magazine_key, magazine) != 0) {
+        free(magazine);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&heap->mutex);
+    magazine->next = heap->magazines;
+    if (magazine->next)
+        magazine->next->prev = magazine;
+    heap->magazines = magazine;
+    pthread_mutex_unlock(&heap->mutex);
+    return magazine;
+}
+
+int
+object_heap_enable_magazines(object_heap_p heap)
+{
+    if (heap->use_magazines) {
+        return 0;
+    }
+    if (pthread_key_create(&heap->magazine_key, object_heap_magazine_destroy) != 0) {
+        return -1;
+    }
+    heap->use_magazines = 1;
+    return 0;
+}
+
 int
 object_heap_allocate(object_heap_p heap)
 {
+    object_heap_magazine_t *magazine;
+    object_base_p obj;
     int ret;
 
+    magazine = object_heap_magazine_get(heap);
+    if (magazine) {
+        if (magazine->count == 0) {
+            pthread_mutex_lock(&heap->mutex);
+            object_heap_magazine_fill_unlocked(heap, magazine,
+                                               OBJECT_HEAP_MAGAZINE_BATCH);
+            pthread_mutex_unlock(&heap->mutex);
+            if (magazine->count == 0) {
+                return -1; /* Out of memory */
+            }
+        }
+        ret = magazine->slots[--magazine->count];
+        obj = object_heap_get(heap, heap->bucket, ret);
+        ASSERT(obj->next_free == CACHED);
+        object_heap_set_allocated(heap, ret, 1);
+        atomic_store_release(&obj->next_free, ALLOCATED);
+        return obj->id;
+    }
+
     pthread_mutex_lock(&heap->mutex);
     ret = object_heap_allocate_unlocked(heap);
     pthread_mutex_unlock(&heap->mutex);
@@ -150,36 +458,36 @@ object_heap_allocate(object_heap_p heap)
 /*
  * Lookup an object by object ID
  * Returns a pointer to the object on success, returns NULL on error
+ *
+ * This does not take the heap mutex: buckets are never freed before
+ * object_heap_destroy() and the heap size is only published once the
+ * matching bucket is reachable.
  */
-static object_base_p
-object_heap_lookup_unlocked(object_heap_p heap, int id)
+object_base_p
+object_heap_lookup(object_heap_p heap, int id)
 {
     object_base_p obj;
-    int bucket_index, obj_index;
+    int obj_index;
 
-    if ((id < heap->id_offset) || (id > (heap->heap_size + heap->id_offset))) {
+    if ((id & ~OBJECT_HEAP_ID_MASK) != heap->id_offset) {
         return NULL;
     }
     id &= OBJECT_HEAP_ID_MASK;
-    bucket_index = id / heap->heap_increment;
-    obj_index = id % heap->heap_increment;
-    obj = (object_base_p)(heap->bucket[bucket_index] + obj_index * heap->object_size);
+    obj_index = id & OBJECT_HEAP_INDEX_MASK;
+    if (obj_index >= atomic_load_acquire(&heap->heap_size)) {
+        return NULL;
+    }
+    obj = object_heap_get(heap, heap->bucket, obj_index);
 
     /* Check if the object has in fact been allocated */
-    if (obj->next_free != ALLOCATED) {
+    if (atomic_load_acquire(&obj->next_free) != ALLOCATED) {
         return NULL;
     }
-    return obj;
-}
 
-object_base_p
-object_heap_lookup(object_heap_p heap, int id)
-{
-    object_base_p obj;
-
-    pthread_mutex_lock(&heap->mutex);
-    obj = object_heap_lookup_unlocked(heap, id);
-    pthread_mutex_unlock(&heap->mutex);
+    /* Check the ID is not a stale one from a previous generation */
+    if ((atomic_load_acquire(&obj->id) & OBJECT_HEAP_ID_MASK) != id) {
+        return NULL;
+    }
     return obj;
 }
 
@@ -201,23 +509,14 @@ object_heap_first(object_heap_p heap, object_heap_iterator *iter)
 static object_base_p
 object_heap_next_unlocked(object_heap_p heap, object_heap_iterator *iter)
 {
-    object_base_p obj;
-    int bucket_index, obj_index;
-    int i = *iter + 1;
-
-    while (i < heap->heap_size) {
-        bucket_index = i / heap->heap_increment;
-        obj_index = i % heap->heap_increment;
+    int i = object_heap_next_index_unlocked(heap, *iter + 1);
 
-        obj = (object_base_p)(heap->bucket[bucket_index] + obj_index * heap->object_size);
-        if (obj->next_free == ALLOCATED) {
-            *iter = i;
-            return obj;
-        }
-        i++;
+    if (i < 0) {
+        *iter = heap->heap_size;
+        return NULL;
     }
     *iter = i;
-    return NULL;
+    return object_heap_get(heap, heap->bucket, i);
 }
 
 object_base_p
@@ -231,24 +530,119 @@ object_heap_next(object_heap_p heap, object_heap_iterator *iter)
     return obj;
 }
 
+/*
+ * Calls FUNC on each allocated object, with the heap mutex held
+ * throughout. FUNC may free the object it is passed
+ * Returns the first object for which FUNC returned non-zero, or NULL
+ */
+object_base_p
+object_heap_foreach(
+    object_heap_p               heap,
+    object_heap_foreach_func_t  func,
+    void                       *user_data
+)
+{
+    object_base_p obj, found = NULL;
+    int i;
+
+    pthread_mutex_lock(&heap->mutex);
+    for (i = object_heap_next_index_unlocked(heap, 0); i >= 0;
+         i = object_heap_next_index_unlocked(heap, i + 1)) {
+        obj = object_heap_get(heap, heap->bucket, i);
+        if (func(obj, user_data)) {
+            found = obj;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&heap->mutex);
+    return found;
+}
+
+/*
+ * Returns the number of allocated objects
+ */
+int
+object_heap_count(object_heap_p heap)
+{
+    int i, n, count = 0;
+    unsigned int j, num_words;
+
+    pthread_mutex_lock(&heap->mutex);
+    for (i = 0, n = heap->heap_size; i < heap->num_buckets; i++) {
+        num_words = MIN(n, 1 << (heap->bucket_shift + i));
+        n -= num_words;
+        num_words = (num_words + BITMAP_BITS - 1) / BITMAP_BITS;
+        for (j = 0; j < num_words; j++)
+            count += __builtin_popcountl(atomic_load_acquire(&heap->bitmap[i][j]));
+    }
+    pthread_mutex_unlock(&heap->mutex);
+    return count;
+}
+
+/*
+ * Fills in STATS with the heap usage counters. This does not take the
+ * heap mutex, so counters may be slightly out of sync with each other
+ */
+void
+object_heap_get_stats(object_heap_p heap, object_heap_stats_t *stats)
+{
+    const int heap_size = atomic_load_acquire(&heap->heap_size);
+
+    stats->num_live        = __atomic_load_n(&heap->num_live, __ATOMIC_RELAXED);
+    stats->max_live        = __atomic_load_n(&heap->max_live, __ATOMIC_RELAXED);
+    stats->num_allocations = __atomic_load_n(&heap->num_allocations, __ATOMIC_RELAXED);
+    stats->capacity        = heap_size;
+    stats->num_bytes       = (unsigned long)heap_size * heap->object_size +
+                             heap_size / 8; /* occupancy bitmap */
+}
+
 /*
  * Frees an object
  */
-static void
-object_heap_free_unlocked(object_heap_p heap, object_base_p obj)
+static inline void
+object_heap_invalidate_id(object_base_p obj)
 {
     /* Check if the object has in fact been allocated */
     ASSERT(obj->next_free == ALLOCATED);
 
-    obj->next_free = heap->next_free;
-    heap->next_free = obj->id & OBJECT_HEAP_ID_MASK;
+    /* Invalidate outstanding IDs before the object can be looked up again */
+    atomic_store_release(&obj->id,
+                         (obj->id & ~OBJECT_HEAP_GEN_MASK) |
+                         ((obj->id + (1 << OBJECT_HEAP_GEN_SHIFT)) & OBJECT_HEAP_GEN_MASK));
+}
+
+static void
+object_heap_free_unlocked(object_heap_p heap, object_base_p obj)
+{
+    object_heap_invalidate_id(obj);
+    object_heap_set_allocated(heap, obj->id & OBJECT_HEAP_INDEX_MASK, 0);
+    atomic_store_release(&obj->next_free, heap->next_free);
+    heap->next_free = obj->id & OBJECT_HEAP_INDEX_MASK;
 }
 
 void
 object_heap_free(object_heap_p heap, object_base_p obj)
 {
+    object_heap_magazine_t *magazine;
+
     if (!obj)
         return;
+
+    magazine = object_heap_magazine_get(heap);
+    if (magazine) {
+        if (magazine->count == OBJECT_HEAP_MAGAZINE_SIZE) {
+            pthread_mutex_lock(&heap->mutex);
+            object_heap_magazine_drain_unlocked(heap, magazine,
+                                                OBJECT_HEAP_MAGAZINE_BATCH);
+            pthread_mutex_unlock(&heap->mutex);
+        }
+        object_heap_invalidate_id(obj);
+        object_heap_set_allocated(heap, obj->id & OBJECT_HEAP_INDEX_MASK, 0);
+        atomic_store_release(&obj->next_free, CACHED);
+        magazine->slots[magazine->count++] = obj->id & OBJECT_HEAP_INDEX_MASK;
+        return;
+    }
+
     pthread_mutex_lock(&heap->mutex);
     object_heap_free_unlocked(heap, obj);
     pthread_mutex_unlock(&heap->mutex);
@@ -260,26 +654,30 @@ object_heap_free(object_heap_p heap, object_base_p obj)
 void
 object_heap_destroy(object_heap_p heap)
 {
-    object_base_p obj;
-    int bucket_index, obj_index, i;
+    int i;
 
-    /* Check if heap is empty */
-    for (i = 0; i < heap->heap_size; i++) {
-        /* Check if object is not still allocated */
-        bucket_index = i / heap->heap_increment;
-        obj_index = i % heap->heap_increment;
-        obj = (object_base_p)(heap->bucket[bucket_index] + obj_index * heap->object_size);
-        ASSERT(obj->next_free != ALLOCATED);
+    /* Return cached objects of all threads. Threads must not exit
+       concurrently, which would race with their magazine destructor */
+    if (heap->use_magazines) {
+        pthread_key_delete(heap->magazine_key);
+        while (heap->magazines)
+            object_heap_magazine_destroy_unlocked(heap, heap->magazines);
+        heap->use_magazines = 0;
     }
 
-    for (i = 0; i < heap->heap_size / heap->heap_increment; i++) {
+    /* Check if heap is empty */
+    ASSERT(object_heap_next_index_unlocked(heap, 0) < 0);
+
+    for (i = 0; i < heap->num_buckets; i++) {
         free(heap->bucket[i]);
+        heap->bucket[i] = NULL;
+        free(heap->bitmap[i]);
+        heap->bitmap[i] = NULL;
     }
 
     pthread_mutex_destroy(&heap->mutex);
 
-    free(heap->bucket);
-    heap->bucket = NULL;
+    heap->num_buckets = 0;
     heap->heap_size = 0;
     heap->next_free = LAST_FREE;
 }
@@ -21,8 +21,24 @@
 #ifndef VA_OBJECT_HEAP_H
 #define VA_OBJECT_HEAP_H
 
-#define OBJECT_HEAP_OFFSET_MASK 0x7f000000
-#define OBJECT_HEAP_ID_MASK     0x00ffffff
+/*
+ * Object IDs are laid out as follows, bit 31 being left clear so that
+ * IDs remain positive ints:
+ * - bits 27-30: heap offset, i.e. the object type (16 heaps at most);
+ * - bits 16-26: generation of the slot, bumped each time it is freed;
+ * - bits  0-15: slot index, so a heap holds at most 65536 objects.
+ * A stale ID is rejected unless its slot was freed a multiple of 2048
+ * times since, so it takes 2048 vaDestroy*() and vaCreate*() calls that
+ * all recycle that very slot before a stale ID can alias a new object.
+ */
+#define OBJECT_HEAP_OFFSET_MASK 0x78000000
+#define OBJECT_HEAP_ID_MASK     0x07ffffff
+#define OBJECT_HEAP_GEN_MASK    0x07ff0000
+#define OBJECT_HEAP_GEN_SHIFT   16
+#define OBJECT_HEAP_INDEX_MASK  0x0000ffff
+
+/* Enough geometrically growing buckets to cover OBJECT_HEAP_INDEX_MASK */
+#define OBJECT_HEAP_MAX_BUCKETS 16
 
 typedef struct object_base *object_base_p;
 typedef struct object_heap *object_heap_p;
@@ -38,13 +54,31 @@ struct object_heap {
     int id_offset;
     int next_free;
     int heap_size;
-    int heap_increment;
-    void **bucket;
+    int bucket_shift;
+    void *bucket[OBJECT_HEAP_MAX_BUCKETS];
+    unsigned long *bitmap[OBJECT_HEAP_MAX_BUCKETS];
     int num_buckets;
+    int num_live;
+    int max_live;
+    unsigned long num_allocations;
+    pthread_key_t magazine_key;
+    void *magazines;
+    unsigned int use_magazines : 1;
 };
 
 typedef int object_heap_iterator;
 
+typedef struct object_heap_stats object_heap_stats_t;
+struct object_heap_stats {
+    int num_live;                       /* currently allocated objects */
+    int max_live;                       /* peak number of live objects */
+    unsigned long num_allocations;      /* total number of allocations */
+    int capacity;                       /* number of slots in the heap */
+    unsigned long num_bytes;            /* memory used by the heap itself */
+};
+
+typedef int (*object_heap_foreach_func_t)(object_base_p obj, void *user_data);
+
 /*
  * Return 0 on success, -1 on error
  */
@@ -52,9 +86,33 @@ int
 object_heap_init(object_heap_p heap, int object_size, int id_offset)
     attribute_hidden;
 
+/*
+ * Same as object_heap_init() but preallocates room for at least
+ * NUM_OBJECTS_HINT objects. Further growth doubles the heap capacity.
+ * Return 0 on success, -1 on error
+ */
+int
+object_heap_init_full(
+    object_heap_p       heap,
+    int                 object_size,
+    int                 id_offset,
+    unsigned int        num_objects_hint
+) attribute_hidden;
+
+/*
+ * Enables per-thread object caches (magazines)
+ * Each thread then allocates and frees objects from a small private
+ * stack of slots, and only takes the heap mutex to refill or drain it
+ * in batches. Return 0 on success, -1 on error
+ */
+int
+object_heap_enable_magazines(object_heap_p heap)
+    attribute_hidden;
+
 /*
  * Allocates an object
- * Returns the object ID on success, returns -1 on error
+ * Returns the object ID on success, returns -1 on error, including when
+ * all OBJECT_HEAP_INDEX_MASK + 1 slots are in use
  */
 int object_heap_allocate(object_heap_p heap)
     attribute_hidden;
@@ -62,6 +120,8 @@ int object_heap_allocate(object_heap_p heap)
 /*
  * Lookup an allocated object by object ID
  * Returns a pointer to the object on success, returns NULL on error
+ * This function is lock-free and may run concurrently with allocations
+ * Stale IDs from a previous generation of the object are rejected
  */
 object_base_p
 object_heap_lookup(object_heap_p heap, int id)
@@ -83,6 +143,33 @@ object_base_p
 object_heap_next(object_heap_p heap, object_heap_iterator *iter)
     attribute_hidden;
 
+/*
+ * Iterate over all objects in the heap, taking the heap lock only once.
+ * FUNC may free the object it is passed. Iteration stops as soon as
+ * FUNC returns non-zero.
+ * Returns the object that stopped the iteration, or NULL otherwise.
+ */
+object_base_p
+object_heap_foreach(
+    object_heap_p               heap,
+    object_heap_foreach_func_t  func,
+    void                       *user_data
+) attribute_hidden;
+
+/*
+ * Returns the number of allocated objects
+ */
+int
+object_heap_count(object_heap_p heap)
+    attribute_hidden;
+
+/*
+ * Fills in STATS with the heap usage counters
+ */
+void
+object_heap_get_stats(object_heap_p heap, object_heap_stats_t *stats)
+    attribute_hidden;
+
 /*
  * Frees an object
  */
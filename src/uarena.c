@@ -0,0 +1,196 @@
+/*
+ *  uarena.c - Chunked bump allocators
+ *
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "uarena.h"
+
+/*
+ * Allocations are carved out of a list of chunks and are never moved,
+ * nor individually freed. arena_reset() releases everything at once
+ * and keeps the chunks around for the next round.
+ */
+#define ARENA_ALIGN             16
+
+typedef struct _UArenaChunk UArenaChunk;
+struct _UArenaChunk {
+    UArenaChunk        *next;
+    size_t              size;
+    size_t              used;
+    uint8_t            *data;
+};
+
+struct _UArena {
+    UArenaChunk        *chunks;
+    UArenaChunk        *current;
+    size_t              chunk_size;
+    size_t              total_size;     /* bytes in all chunks */
+    size_t              used_size;      /* bytes allocated since reset */
+    unsigned int        num_chunks;
+};
+
+static UArenaChunk *arena_chunk_new(size_t size)
+{
+    UArenaChunk *chunk;
+
+    chunk = malloc(sizeof(*chunk) + ARENA_ALIGN + size);
+    if (!chunk)
+        return NULL;
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->data = (uint8_t *)(((uintptr_t)(chunk + 1) + ARENA_ALIGN - 1) &
+                              -(uintptr_t)ARENA_ALIGN);
+    return chunk;
+}
+
+static void arena_free_chunks(UArena *arena)
+{
+    UArenaChunk *chunk, *next;
+
+    for (chunk = arena->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->chunks     = NULL;
+    arena->current    = NULL;
+    arena->total_size = 0;
+    arena->num_chunks = 0;
+}
+
+UArena *arena_new(size_t chunk_size)
+{
+    UArena *arena;
+
+    arena = calloc(1, sizeof(*arena));
+    if (!arena)
+        return NULL;
+
+    arena->chunk_size = chunk_size;
+    return arena;
+}
+
+void arena_free(UArena *arena)
+{
+    if (!arena)
+        return;
+
+    arena_free_chunks(arena);
+    free(arena);
+}
+
+/* Returns a chunk with at least SIZE bytes left, or NULL if out of memory */
+static UArenaChunk *arena_get_chunk(UArena *arena, size_t size)
+{
+    UArenaChunk *chunk, *prev;
+
+    /* Look for room in the current chunk, or in any chunk kept from a
+       previous round */
+    for (chunk = arena->current; chunk; chunk = chunk->next) {
+        if (chunk->used + size <= chunk->size)
+            break;
+    }
+
+    if (!chunk) {
+        /* Chunks double in size, so that few are needed for a round */
+        size_t chunk_size = arena->chunk_size;
+        if (chunk_size < arena->total_size)
+            chunk_size = arena->total_size;
+        if (chunk_size < size)
+            chunk_size = size;
+
+        chunk = arena_chunk_new(chunk_size);
+        if (!chunk)
+            return NULL;
+
+        if (arena->chunks) {
+            for (prev = arena->chunks; prev->next; prev = prev->next)
+                ;
+            prev->next = chunk;
+        }
+        else
+            arena->chunks = chunk;
+        arena->total_size += chunk_size;
+        arena->num_chunks++;
+    }
+    arena->current = chunk;
+    return chunk;
+}
+
+void *arena_alloc(UArena *arena, size_t size)
+{
+    UArenaChunk *chunk;
+    void *ptr;
+
+    size = (size + ARENA_ALIGN - 1) & -ARENA_ALIGN;
+
+    chunk = arena_get_chunk(arena, size);
+    if (!chunk)
+        return NULL;
+
+    ptr             = chunk->data + chunk->used;
+    chunk->used    += size;
+    arena->used_size += size;
+    return ptr;
+}
+
+/*
+ * Makes sure the next SIZE bytes worth of allocations are served from
+ * memory already owned by the arena
+ * Returns 0 on success, -1 if out of memory
+ */
+int arena_reserve(UArena *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & -ARENA_ALIGN;
+
+    return arena_get_chunk(arena, size) ? 0 : -1;
+}
+
+void arena_reset(UArena *arena)
+{
+    UArenaChunk *chunk;
+
+    if (!arena)
+        return;
+
+    /* Merge chunks into a single one, sized for the last round plus
+       some headroom so that slightly larger rounds still fit */
+    if (arena->num_chunks > 1) {
+        const size_t chunk_size = MAX(arena->used_size + arena->used_size / 4,
+                                      arena->chunk_size);
+        arena_free_chunks(arena);
+        arena->chunks = arena_chunk_new(chunk_size);
+        if (arena->chunks) {
+            arena->total_size = chunk_size;
+            arena->num_chunks = 1;
+        }
+    }
+
+    for (chunk = arena->chunks; chunk; chunk = chunk->next)
+        chunk->used = 0;
+    arena->current   = arena->chunks;
+    arena->used_size = 0;
+}
+
+size_t arena_get_size(UArena *arena)
+{
+    return arena ? arena->total_size : 0;
+}
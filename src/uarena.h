@@ -0,0 +1,45 @@
+/*
+ *  uarena.h - Chunked bump allocators
+ *
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef UARENA_H
+#define UARENA_H
+
+typedef struct _UArena UArena;
+
+UArena *arena_new(size_t chunk_size)
+    attribute_hidden;
+
+void arena_free(UArena *arena)
+    attribute_hidden;
+
+void *arena_alloc(UArena *arena, size_t size)
+    attribute_hidden;
+
+int arena_reserve(UArena *arena, size_t size)
+    attribute_hidden;
+
+void arena_reset(UArena *arena)
+    attribute_hidden;
+
+size_t arena_get_size(UArena *arena)
+    attribute_hidden;
+
+#endif /* UARENA_H */
@@ -28,6 +28,7 @@ struct _UAsyncQueue {
     pthread_mutex_t     mutex;
     pthread_cond_t      cond;
     unsigned int        is_waiting;
+    unsigned int        is_closed;
 };
 
 UAsyncQueue *async_queue_new(void)
@@ -46,10 +47,12 @@ UAsyncQueue *async_queue_new(void)
 
     pthread_mutex_init(&queue->mutex, NULL);
     queue->is_waiting = 0;
+    queue->is_closed  = 0;
     return queue;
 
 error:
-    async_queue_free(queue);
+    queue_free(queue->queue);
+    free(queue);
     return NULL;
 }
 
@@ -58,7 +61,8 @@ void async_queue_free(UAsyncQueue *queue)
     if (!queue)
         return;
 
-    pthread_mutex_unlock(&queue->mutex);
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->mutex);
     queue_free(queue->queue);
     free(queue);
 }
@@ -70,7 +74,8 @@ int async_queue_is_empty(UAsyncQueue *queue)
 
 static UAsyncQueue *async_queue_push_unlocked(UAsyncQueue *queue, void *data)
 {
-    queue_push(queue->queue, data);
+    if (!queue_push(queue->queue, data))
+        return NULL;
     if (queue->is_waiting)
         pthread_cond_signal(&queue->cond);
     return queue;
@@ -78,19 +83,50 @@ static UAsyncQueue *async_queue_push_unlocked(UAsyncQueue *queue, void *data)
 
 UAsyncQueue *async_queue_push(UAsyncQueue *queue, void *data)
 {
+    UAsyncQueue *ret;
+
     if (!queue)
         return NULL;
 
     pthread_mutex_lock(&queue->mutex);
-    async_queue_push_unlocked(queue, data);
+    ret = async_queue_push_unlocked(queue, data);
     pthread_mutex_unlock(&queue->mutex);
-    return queue;
+    return ret;
+}
+
+/* Wakes up readers for good: once the queue is empty, pops return NULL
+   without waiting. Closing needs no memory, unlike pushing a request */
+void async_queue_close(UAsyncQueue *queue)
+{
+    if (!queue)
+        return;
+
+    pthread_mutex_lock(&queue->mutex);
+    queue->is_closed = 1;
+    if (queue->is_waiting)
+        pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+int async_queue_is_closed(UAsyncQueue *queue)
+{
+    int is_closed;
+
+    if (!queue)
+        return 1;
+
+    pthread_mutex_lock(&queue->mutex);
+    is_closed = queue->is_closed;
+    pthread_mutex_unlock(&queue->mutex);
+    return is_closed;
 }
 
 static void *
 async_queue_timed_pop_unlocked(UAsyncQueue *queue, uint64_t end_time)
 {
     if (queue_is_empty(queue->queue)) {
+        if (queue->is_closed)
+            return NULL;
         assert(!queue->is_waiting);
         ++queue->is_waiting;
         if (!end_time)
@@ -35,6 +35,12 @@ int async_queue_is_empty(UAsyncQueue *queue)
 UAsyncQueue *async_queue_push(UAsyncQueue *queue, void *data)
     attribute_hidden;
 
+void async_queue_close(UAsyncQueue *queue)
+    attribute_hidden;
+
+int async_queue_is_closed(UAsyncQueue *queue)
+    attribute_hidden;
+
 void *async_queue_timed_pop(UAsyncQueue *queue, uint64_t end_time)
     attribute_hidden;
 
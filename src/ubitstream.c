@@ -0,0 +1,166 @@
+/*
+ *  ubitstream.c - Bitstream scanning utilities
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "ubitstream.h"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define BITSTREAM_SCANNER "avx2"
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+# define BITSTREAM_SCANNER "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define BITSTREAM_SCANNER "neon"
+#else
+# define BITSTREAM_SCANNER "c"
+#endif
+
+/*
+ * The vector scanners look for 32 candidate positions i at once where
+ * buf[i + 1] == 0 and buf[i + 2] == 1, and only then check buf[i] == 0.
+ * Emulation prevention guarantees that 00 00 01 never occurs inside a
+ * NAL unit, so every match is a real NAL unit boundary and candidates
+ * are rare enough for the check to be done one at a time.
+ */
+
+// Scans buf[start..buf_size) one byte at a time
+static inline unsigned int
+find_start_code_c(const uint8_t *buf, unsigned int start, unsigned int buf_size)
+{
+    unsigned int i;
+
+    if (buf_size < 3)
+        return buf_size;
+
+    for (i = start; i < buf_size - 2; i++) {
+        /* Skip two bytes at once while the third one cannot be a zero */
+        if (buf[i + 2] > 1) {
+            i += 2;
+            continue;
+        }
+        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+            return i;
+    }
+    return buf_size;
+}
+
+// Returns the first candidate flagged in mask that is a start code, or -1
+static inline int
+check_candidates(const uint8_t *buf, unsigned int i, uint32_t mask)
+{
+    while (mask) {
+        const unsigned int j = i + __builtin_ctz(mask);
+        if (buf[j] == 0)
+            return j;
+        mask &= mask - 1;
+    }
+    return -1;
+}
+
+#if defined(__AVX2__)
+static inline unsigned int
+find_start_code_vec(const uint8_t *buf, unsigned int buf_size)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi8(1);
+    unsigned int i;
+    int pos;
+
+    for (i = 0; i + 34 <= buf_size; i += 32) {
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(buf + i + 1));
+        __m256i b2 = _mm256_loadu_si256((const __m256i *)(buf + i + 2));
+        __m256i m  = _mm256_and_si256(_mm256_cmpeq_epi8(b1, zero),
+                                      _mm256_cmpeq_epi8(b2, one));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+        if (mask && (pos = check_candidates(buf, i, mask)) >= 0)
+            return pos;
+    }
+    return find_start_code_c(buf, i, buf_size);
+}
+#elif defined(__SSE2__)
+static inline unsigned int
+find_start_code_vec(const uint8_t *buf, unsigned int buf_size)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one  = _mm_set1_epi8(1);
+    unsigned int i;
+    int pos;
+
+    for (i = 0; i + 34 <= buf_size; i += 32) {
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(buf + i + 1));
+        __m128i a2 = _mm_loadu_si128((const __m128i *)(buf + i + 2));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(buf + i + 17));
+        __m128i b2 = _mm_loadu_si128((const __m128i *)(buf + i + 18));
+        __m128i ma = _mm_and_si128(_mm_cmpeq_epi8(a1, zero),
+                                   _mm_cmpeq_epi8(a2, one));
+        __m128i mb = _mm_and_si128(_mm_cmpeq_epi8(b1, zero),
+                                   _mm_cmpeq_epi8(b2, one));
+        uint32_t mask = ((uint32_t)_mm_movemask_epi8(ma) |
+                         (uint32_t)_mm_movemask_epi8(mb) << 16);
+        if (mask && (pos = check_candidates(buf, i, mask)) >= 0)
+            return pos;
+    }
+    return find_start_code_c(buf, i, buf_size);
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline unsigned int
+find_start_code_vec(const uint8_t *buf, unsigned int buf_size)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one  = vdupq_n_u8(1);
+    unsigned int i;
+
+    for (i = 0; i + 18 <= buf_size; i += 16) {
+        uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(buf + i + 1), zero),
+                                vceqq_u8(vld1q_u8(buf + i + 2), one));
+        /* Narrow to 4 bits per byte so that the mask fits into 64 bits */
+        uint8x8_t n   = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(n), 0);
+        while (mask) {
+            const unsigned int j = i + (__builtin_ctzll(mask) >> 2);
+            if (buf[j] == 0)
+                return j;
+            mask &= ~(UINT64_C(0xf) << ((j - i) << 2));
+        }
+    }
+    return find_start_code_c(buf, i, buf_size);
+}
+#else
+static inline unsigned int
+find_start_code_vec(const uint8_t *buf, unsigned int buf_size)
+{
+    return find_start_code_c(buf, 0, buf_size);
+}
+#endif
+
+// Returns the offset of the first start code prefix in buf
+unsigned int
+bitstream_find_start_code(const uint8_t *buf, unsigned int buf_size)
+{
+    return find_start_code_vec(buf, buf_size);
+}
+
+// Returns the name of the start code scanner implementation
+const char *bitstream_get_scanner_name(void)
+{
+    return BITSTREAM_SCANNER;
+}
@@ -0,0 +1,34 @@
+/*
+ *  ubitstream.h - Bitstream scanning utilities
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef UBITSTREAM_H
+#define UBITSTREAM_H
+
+/* Returns the offset of the first 00 00 01 start code prefix in buf, or
+   buf_size if there is none */
+unsigned int
+bitstream_find_start_code(const uint8_t *buf, unsigned int buf_size)
+    attribute_hidden;
+
+/* Returns the name of the start code scanner implementation */
+const char *bitstream_get_scanner_name(void)
+    attribute_hidden;
+
+#endif /* UBITSTREAM_H */
@@ -63,6 +63,21 @@ UList *list_prepend(UList *list, void *data)
     return list_new(data, list ? list->prev : NULL, list);
 }
 
+UList *list_delete_link(UList *list, UList *link)
+{
+    if (!link)
+        return list;
+
+    if (link->prev)
+        link->prev->next = link->next;
+    if (link->next)
+        link->next->prev = link->prev;
+    if (list == link)
+        list = link->next;
+    list_free_1(link);
+    return list;
+}
+
 UList *list_first(UList *list)
 {
     if (list) {
@@ -42,6 +42,9 @@ UList *list_append(UList *list, void *data)
 UList *list_prepend(UList *list, void *data)
     attribute_hidden;
 
+UList *list_delete_link(UList *list, UList *link)
+    attribute_hidden;
+
 UList *list_first(UList *list)
     attribute_hidden;
 
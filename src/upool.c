@@ -0,0 +1,243 @@
+/*
+ *  upool.c - Size-classed memory pools
+ *
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include <pthread.h>
+#include "upool.h"
+
+/*
+ * Blocks are rounded up to size classes spaced four per power of two,
+ * i.e. 64, 80, 96, 112, 128, 160, ... bytes, so that at most 25% of a
+ * block is wasted. Blocks larger than POOL_MAX_BLOCK_SIZE are not pooled.
+ */
+#define POOL_MIN_BLOCK_SHIFT    6
+#define POOL_MAX_BLOCK_SHIFT    26
+#define POOL_MAX_BLOCK_SIZE     (1UL << POOL_MAX_BLOCK_SHIFT)
+#define POOL_NUM_CLASSES        (1 + 4 * (POOL_MAX_BLOCK_SHIFT - POOL_MIN_BLOCK_SHIFT))
+
+/* Number of releases between two automatic trims */
+#define POOL_TRIM_PERIOD        1024
+
+typedef struct _UPoolBlock UPoolBlock;
+struct _UPoolBlock {
+    UPoolBlock         *next;
+};
+
+typedef struct _UPoolClass UPoolClass;
+struct _UPoolClass {
+    UPoolBlock         *free_blocks;
+    unsigned int        num_free;
+    unsigned int        num_used;
+    unsigned int        max_used;       /* high-water mark since last trim */
+};
+
+struct _UPool {
+    pthread_mutex_t     mutex;
+    UPoolClass          classes[POOL_NUM_CLASSES];
+    unsigned int        num_releases;
+    UPoolStats          stats;
+};
+
+static inline unsigned int
+pool_get_class(size_t size)
+{
+    unsigned long n;
+    unsigned int msb;
+
+    if (size <= (1UL << POOL_MIN_BLOCK_SHIFT))
+        return 0;
+
+    n   = size - 1;
+    msb = 8 * sizeof(n) - 1 - __builtin_clzl(n);
+    return 1 + 4 * (msb - POOL_MIN_BLOCK_SHIFT) + ((n >> (msb - 2)) & 3);
+}
+
+static inline size_t
+pool_get_class_size(unsigned int class_index)
+{
+    unsigned int shift;
+
+    if (class_index == 0)
+        return 1UL << POOL_MIN_BLOCK_SHIFT;
+
+    class_index--;
+    shift = POOL_MIN_BLOCK_SHIFT + class_index / 4 - 2;
+    return (size_t)(5 + class_index % 4) << shift;
+}
+
+/* Frees cached blocks of class CLASS_INDEX until MAX_FREE are left */
+static void
+pool_trim_class_unlocked(UPool *pool, unsigned int class_index,
+                         unsigned int max_free)
+{
+    UPoolClass * const pclass = &pool->classes[class_index];
+    const size_t block_size = pool_get_class_size(class_index);
+    UPoolBlock *block;
+
+    while (pclass->num_free > max_free) {
+        block = pclass->free_blocks;
+        pclass->free_blocks = block->next;
+        pclass->num_free--;
+        free(block);
+        pool->stats.cached_bytes -= block_size;
+        pool->stats.num_trimmed++;
+    }
+}
+
+/*
+ * Only keep as many cached blocks as were needed to reach the high
+ * water mark of the last period, then start a new period
+ */
+static void
+pool_trim_unlocked(UPool *pool)
+{
+    UPoolClass *pclass;
+    unsigned int i;
+
+    for (i = 0; i < POOL_NUM_CLASSES; i++) {
+        pclass = &pool->classes[i];
+        pool_trim_class_unlocked(pool, i, pclass->max_used - pclass->num_used);
+        pclass->max_used = pclass->num_used;
+    }
+    pool->num_releases = 0;
+}
+
+UPool *pool_new(size_t max_cached_bytes)
+{
+    UPool *pool;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->stats.max_cached_bytes = max_cached_bytes;
+    return pool;
+}
+
+void pool_free(UPool *pool)
+{
+    unsigned int i;
+
+    if (!pool)
+        return;
+
+    for (i = 0; i < POOL_NUM_CLASSES; i++)
+        pool_trim_class_unlocked(pool, i, 0);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+void *pool_alloc(UPool *pool, size_t size)
+{
+    UPoolClass *pclass;
+    UPoolBlock *block;
+    unsigned int class_index;
+
+    if (!pool || size > POOL_MAX_BLOCK_SIZE)
+        return malloc(size);
+
+    class_index = pool_get_class(size);
+    pclass = &pool->classes[class_index];
+
+    pthread_mutex_lock(&pool->mutex);
+    block = pclass->free_blocks;
+    if (block) {
+        pclass->free_blocks = block->next;
+        pclass->num_free--;
+        pool->stats.cached_bytes -= pool_get_class_size(class_index);
+        pool->stats.num_hits++;
+    }
+    else
+        pool->stats.num_misses++;
+    if (++pclass->num_used > pclass->max_used)
+        pclass->max_used = pclass->num_used;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!block) {
+        block = malloc(pool_get_class_size(class_index));
+        if (!block) {
+            pthread_mutex_lock(&pool->mutex);
+            pclass->num_used--;
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+    return block;
+}
+
+void pool_release(UPool *pool, void *ptr, size_t size)
+{
+    UPoolClass *pclass;
+    UPoolBlock *block = ptr;
+    unsigned int class_index;
+    size_t block_size;
+
+    if (!ptr)
+        return;
+
+    if (!pool || size > POOL_MAX_BLOCK_SIZE) {
+        free(ptr);
+        return;
+    }
+
+    class_index = pool_get_class(size);
+    block_size  = pool_get_class_size(class_index);
+    pclass      = &pool->classes[class_index];
+
+    pthread_mutex_lock(&pool->mutex);
+    pclass->num_used--;
+    if (pool->stats.cached_bytes + block_size <= pool->stats.max_cached_bytes) {
+        block->next = pclass->free_blocks;
+        pclass->free_blocks = block;
+        pclass->num_free++;
+        pool->stats.cached_bytes += block_size;
+        block = NULL;
+    }
+    else
+        pool->stats.num_trimmed++;
+    if (++pool->num_releases >= POOL_TRIM_PERIOD)
+        pool_trim_unlocked(pool);
+    pthread_mutex_unlock(&pool->mutex);
+
+    free(block);
+}
+
+void pool_trim(UPool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool_trim_unlocked(pool);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void pool_get_stats(UPool *pool, UPoolStats *stats)
+{
+    if (!pool) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+}
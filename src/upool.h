@@ -0,0 +1,54 @@
+/*
+ *  upool.h - Size-classed memory pools
+ *
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef UPOOL_H
+#define UPOOL_H
+
+typedef struct _UPool UPool;
+
+typedef struct _UPoolStats UPoolStats;
+struct _UPoolStats {
+    unsigned long       num_hits;       /* blocks reused from the pool */
+    unsigned long       num_misses;     /* blocks malloc()ed, as none was free */
+    unsigned long       num_trimmed;    /* blocks returned to the system */
+    size_t              cached_bytes;   /* bytes currently held in the pool */
+    size_t              max_cached_bytes;
+};
+
+UPool *pool_new(size_t max_cached_bytes)
+    attribute_hidden;
+
+void pool_free(UPool *pool)
+    attribute_hidden;
+
+void *pool_alloc(UPool *pool, size_t size)
+    attribute_hidden;
+
+void pool_release(UPool *pool, void *ptr, size_t size)
+    attribute_hidden;
+
+void pool_trim(UPool *pool)
+    attribute_hidden;
+
+void pool_get_stats(UPool *pool, UPoolStats *stats)
+    attribute_hidden;
+
+#endif /* UPOOL_H */
@@ -52,7 +52,11 @@ UQueue *queue_push(UQueue *queue, void *data)
     if (!queue)
         return NULL;
 
-    queue->tail = list_last(list_append(queue->tail, data));
+    /* list_append() returns the list unchanged if it is out of memory */
+    UList * const tail = list_last(list_append(queue->tail, data));
+    if (!tail || tail == queue->tail)
+        return NULL;
+    queue->tail = tail;
 
     if (!queue->head)
         queue->head = queue->tail;
@@ -23,11 +23,182 @@
 #include "vdpau_driver.h"
 #include "vdpau_video.h"
 #include "vdpau_dump.h"
+#include "vdpau_stats.h"
 #include "utils.h"
 
 #define DEBUG 1
 #include "debug.h"
 
+// Create picture arena
+static picture_arena_t *
+picture_arena_new(VAContextID context)
+{
+    picture_arena_t *arena;
+
+    arena = malloc(sizeof(*arena));
+    if (!arena)
+        return NULL;
+
+    arena->arena = arena_new(VDPAU_PICTURE_ARENA_SIZE);
+    if (!arena->arena) {
+        free(arena);
+        return NULL;
+    }
+    arena->va_context = context;
+    arena->refcount   = 0;
+    return arena;
+}
+
+// Destroy picture arena
+static void
+picture_arena_destroy(picture_arena_t *arena)
+{
+    if (!arena)
+        return;
+
+    arena_free(arena->arena);
+    free(arena);
+}
+
+// Release a reference to the picture arena, held by a VA buffer
+static void
+picture_arena_unref(
+    vdpau_driver_data_t *driver_data,
+    picture_arena_t     *arena
+)
+{
+    object_context_p obj_context;
+
+    if (__atomic_sub_fetch(&arena->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+
+    /* The arena of the picture being built is released at vaEndPicture() */
+    obj_context = VDPAU_CONTEXT(arena->va_context);
+    if (obj_context && obj_context->picture_arena == arena)
+        return;
+
+    /* Keep one arena around for the next picture, unless the context
+       was destroyed in the meantime */
+    if (obj_context && !obj_context->spare_picture_arena) {
+        arena_reset(arena->arena);
+        obj_context->spare_picture_arena = arena;
+        return;
+    }
+    picture_arena_destroy(arena);
+}
+
+// Return the arena of the picture being built
+static picture_arena_t *
+get_picture_arena(object_context_p obj_context)
+{
+    picture_arena_t *arena = obj_context->picture_arena;
+
+    if (!arena) {
+        arena = obj_context->spare_picture_arena;
+        if (arena)
+            obj_context->spare_picture_arena = NULL;
+        else
+            arena = picture_arena_new(obj_context->context_id);
+        obj_context->picture_arena = arena;
+    }
+    return arena;
+}
+
+// Allocate memory from the picture arena. Memory lives until the picture is complete
+void *
+alloc_picture_data(
+    object_context_p     obj_context,
+    unsigned int         size
+)
+{
+    picture_arena_t * const arena = get_picture_arena(obj_context);
+
+    if (!arena)
+        return NULL;
+    return arena_alloc(arena->arena, size);
+}
+
+// Release the picture arena once all its buffers are destroyed
+void
+rotate_picture_arena(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    picture_arena_t * const arena = obj_context->picture_arena;
+
+    if (!arena)
+        return;
+
+    /* All buffers are gone already: recycle the arena in place */
+    if (__atomic_load_n(&arena->refcount, __ATOMIC_ACQUIRE) == 0) {
+        arena_reset(arena->arena);
+        return;
+    }
+
+    /* Otherwise, the last buffer to be destroyed will release it */
+    obj_context->picture_arena = NULL;
+}
+
+// Keep the picture arena alive past vaEndPicture(), until release_picture_arena()
+picture_arena_t *
+hold_picture_arena(object_context_p obj_context)
+{
+    picture_arena_t * const arena = obj_context->picture_arena;
+
+    if (arena)
+        __atomic_add_fetch(&arena->refcount, 1, __ATOMIC_ACQ_REL);
+    return arena;
+}
+
+// Release a picture arena obtained with hold_picture_arena()
+void
+release_picture_arena(
+    vdpau_driver_data_t *driver_data,
+    picture_arena_t     *arena
+)
+{
+    picture_arena_unref(driver_data, arena);
+}
+
+// Destroy picture arenas, or leave them to the VA buffers still using them
+void
+destroy_picture_arenas(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    picture_arena_t * const arena = obj_context->picture_arena;
+
+    obj_context->picture_arena = NULL;
+    if (arena) {
+        if (__atomic_load_n(&arena->refcount, __ATOMIC_ACQUIRE) == 0)
+            picture_arena_destroy(arena);
+        else
+            arena->va_context = VA_INVALID_ID;
+    }
+
+    picture_arena_destroy(obj_context->spare_picture_arena);
+    obj_context->spare_picture_arena = NULL;
+}
+
+// Check whether VA buffers of the specified type belong to a single picture
+static inline int
+is_picture_buffer_type(VABufferType type)
+{
+    switch (type) {
+    case VAPictureParameterBufferType:
+    case VAIQMatrixBufferType:
+    case VABitPlaneBufferType:
+    case VASliceParameterBufferType:
+    case VASliceDataBufferType:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
 // Destroy dead VA buffers
 void
 destroy_dead_va_buffers(
@@ -62,6 +233,7 @@ create_va_buffer(
 {
     VABufferID buffer_id;
     object_buffer_p obj_buffer;
+    object_context_p obj_context = NULL;
 
     buffer_id = object_heap_allocate(&driver_data->buffer_heap);
     if (buffer_id == VA_INVALID_BUFFER)
@@ -73,17 +245,48 @@ create_va_buffer(
 
     obj_buffer->va_context       = context;
     obj_buffer->type             = buffer_type;
+    obj_buffer->arena            = NULL;
     obj_buffer->max_num_elements = num_elements;
     obj_buffer->num_elements     = num_elements;
     obj_buffer->buffer_size      = size * num_elements;
-    obj_buffer->buffer_data      = malloc(obj_buffer->buffer_size);
     obj_buffer->mtime            = 0;
+    obj_buffer->decode_batch     = 0;
     obj_buffer->delayed_destroy  = 0;
 
-    if (!obj_buffer->buffer_data) {
-        destroy_va_buffer(driver_data, obj_buffer);
-        return NULL;
+    /* Decode buffers go away all at once when the picture is complete,
+       so they are carved from the picture arena and bypass the buffer
+       pool. The pool only serves image buffers, and decode buffers whose
+       context is unknown */
+    if (is_picture_buffer_type(buffer_type))
+        obj_context = VDPAU_CONTEXT(context);
+    if (obj_context) {
+        void *buffer_data = NULL;
+
+        pthread_mutex_lock(&obj_context->lock);
+        obj_buffer->arena = get_picture_arena(obj_context);
+        if (obj_buffer->arena) {
+            __atomic_add_fetch(&obj_buffer->arena->refcount, 1, __ATOMIC_ACQ_REL);
+            buffer_data = arena_alloc(obj_buffer->arena->arena,
+                                      obj_buffer->buffer_size);
+        }
+        obj_buffer->buffer_data = buffer_data;
+
+        /* Dropping the arena reference updates the context */
+        if (!buffer_data)
+            destroy_va_buffer(driver_data, obj_buffer);
+        pthread_mutex_unlock(&obj_context->lock);
+        if (!buffer_data)
+            return NULL;
+    }
+    else {
+        obj_buffer->buffer_data = pool_alloc(driver_data->buffer_pool,
+                                             obj_buffer->buffer_size);
+        if (!obj_buffer->buffer_data) {
+            destroy_va_buffer(driver_data, obj_buffer);
+            return NULL;
+        }
     }
+    vdpau_mem_stats_add(&driver_data->buffer_data_stats, obj_buffer->buffer_size);
     return obj_buffer;
 }
 
@@ -98,8 +301,16 @@ destroy_va_buffer(
         return;
 
     if (obj_buffer->buffer_data) {
-        free(obj_buffer->buffer_data);
+        if (!obj_buffer->arena)
+            pool_release(driver_data->buffer_pool, obj_buffer->buffer_data,
+                         obj_buffer->buffer_size);
         obj_buffer->buffer_data = NULL;
+        vdpau_mem_stats_remove(&driver_data->buffer_data_stats,
+                               obj_buffer->buffer_size);
+    }
+    if (obj_buffer->arena) {
+        picture_arena_unref(driver_data, obj_buffer->arena);
+        obj_buffer->arena = NULL;
     }
     object_heap_free(&driver_data->buffer_heap, (object_base_p)obj_buffer);
 }
@@ -185,9 +396,17 @@ vdpau_DestroyBuffer(
 
     object_buffer_p obj_buffer = VDPAU_BUFFER(buffer_id);
 
-    if (obj_buffer && !obj_buffer->delayed_destroy)
+    if (obj_buffer && !obj_buffer->delayed_destroy) {
+        /* Releasing the picture arena updates its context */
+        object_context_p obj_context = NULL;
+        if (obj_buffer->arena)
+            obj_context = VDPAU_CONTEXT(obj_buffer->va_context);
+        if (obj_context)
+            pthread_mutex_lock(&obj_context->lock);
         destroy_va_buffer(driver_data, obj_buffer);
-
+        if (obj_context)
+            pthread_mutex_unlock(&obj_context->lock);
+    }
     return VA_STATUS_SUCCESS;
 }
 
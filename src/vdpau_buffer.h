@@ -22,20 +22,64 @@
 #define VDPAU_BUFFER_H
 
 #include "vdpau_driver.h"
+#include "uarena.h"
+
+/* Memory for all decode buffers submitted for a single picture */
+typedef struct picture_arena picture_arena_t;
+struct picture_arena {
+    UArena             *arena;
+    VAContextID         va_context;
+    unsigned int        refcount;       /* VA buffers and picture slots using it */
+};
 
 typedef struct object_buffer object_buffer_t;
 struct object_buffer {
     struct object_base  base;
     VAContextID         va_context;
     VABufferType        type;
+    picture_arena_t    *arena;
     void               *buffer_data;
     unsigned int        buffer_size;
     unsigned int        max_num_elements;
     unsigned int        num_elements;
     uint64_t            mtime;
+    /* Last vdpau_ext_DecodePictures() batch that referenced it */
+    uint64_t            decode_batch;
     unsigned int        delayed_destroy : 1;
 };
 
+// Allocate memory from the picture arena. Memory lives until the picture is complete
+void *
+alloc_picture_data(
+    object_context_p     obj_context,
+    unsigned int         size
+) attribute_hidden;
+
+// Release the picture arena once all its buffers are destroyed
+void
+rotate_picture_arena(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
+// Keep the picture arena alive past vaEndPicture(), until release_picture_arena()
+picture_arena_t *
+hold_picture_arena(object_context_p obj_context) attribute_hidden;
+
+// Release a picture arena obtained with hold_picture_arena()
+void
+release_picture_arena(
+    vdpau_driver_data_t *driver_data,
+    picture_arena_t     *arena
+) attribute_hidden;
+
+// Destroy picture arenas, or leave them to the VA buffers still using them
+void
+destroy_picture_arenas(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
 // Destroy dead VA buffers
 void
 destroy_dead_va_buffers(
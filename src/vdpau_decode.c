@@ -24,13 +24,46 @@
 #include "vdpau_buffer.h"
 #include "vdpau_video.h"
 #include "vdpau_dump.h"
+#include "vdpau_stats.h"
 #include "utils.h"
 #include "put_bits.h"
+#include "uasyncqueue.h"
+#include "ubitstream.h"
+#include "ulist.h"
+#include <pthread.h>
 
 #define DEBUG 1
 #include "debug.h"
 
 
+/*
+ * Decode backends
+ *
+ * Each codec provides its per-picture hooks and a table of VA buffer
+ * translators indexed by VABufferType. The backend is looked up once in
+ * vaCreateContext(), so that vaRenderPicture() dispatches each buffer
+ * with a single table lookup.
+ */
+#define DECODE_BACKEND_MAX_BUFFER_TYPES 16
+#define BUFFER_TYPE_BIT(TYPE) (1U << VA##TYPE##BufferType)
+
+typedef int
+(*translate_buffer_func_t)(vdpau_driver_data_t *driver_data,
+                           object_context_p    obj_context,
+                           object_buffer_p     obj_buffer);
+
+struct decode_backend {
+    VdpCodec                    codec;
+    void                      (*begin_picture)(object_context_p obj_context);
+    void                      (*end_picture)(object_context_p obj_context);
+    int                       (*get_num_ref_frames)(object_context_p obj_context);
+    /* VA buffers that must live until vaEndPicture() */
+    unsigned int                preserved_buffer_types;
+    /* VA buffers that need no translation if identical to the last one */
+    unsigned int                cached_buffer_types;
+    translate_buffer_func_t     translate[DECODE_BACKEND_MAX_BUFFER_TYPES];
+};
+
 // Translates VdpDecoderProfile to VdpCodec
 VdpCodec get_VdpCodec(VdpDecoderProfile profile)
 {
@@ -61,6 +94,20 @@ VdpCodec get_VdpCodec(VdpDecoderProfile profile)
     case VDP_DECODER_PROFILE_VC1_MAIN:
     case VDP_DECODER_PROFILE_VC1_ADVANCED:
         return VDP_CODEC_VC1;
+#if USE_VDPAU_HEVC
+    case VDP_DECODER_PROFILE_HEVC_MAIN:
+    case VDP_DECODER_PROFILE_HEVC_MAIN_10:
+        return VDP_CODEC_HEVC;
+#endif
+#if USE_VDPAU_VP9
+    case VDP_DECODER_PROFILE_VP9_PROFILE_0:
+    case VDP_DECODER_PROFILE_VP9_PROFILE_2:
+        return VDP_CODEC_VP9;
+#endif
+#if USE_VDPAU_AV1
+    case VDP_DECODER_PROFILE_AV1_MAIN:
+        return VDP_CODEC_AV1;
+#endif
     }
     return 0;
 }
@@ -81,6 +128,21 @@ VdpDecoderProfile get_VdpDecoderProfile(VAProfile profile)
     case VAProfileVC1Simple:    return VDP_DECODER_PROFILE_VC1_SIMPLE;
     case VAProfileVC1Main:      return VDP_DECODER_PROFILE_VC1_MAIN;
     case VAProfileVC1Advanced:  return VDP_DECODER_PROFILE_VC1_ADVANCED;
+#if USE_VDPAU_HEVC
+    case VAProfileHEVCMain:     return VDP_DECODER_PROFILE_HEVC_MAIN;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VAProfileHEVCMain10:   return VDP_DECODER_PROFILE_HEVC_MAIN_10;
+#endif
+#endif
+#if USE_VDPAU_VP9
+    case VAProfileVP9Profile0:  return VDP_DECODER_PROFILE_VP9_PROFILE_0;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VAProfileVP9Profile2:  return VDP_DECODER_PROFILE_VP9_PROFILE_2;
+#endif
+#endif
+#if USE_VDPAU_AV1
+    case VAProfileAV1Profile0:  return VDP_DECODER_PROFILE_AV1_MAIN;
+#endif
     default:                    break;
     }
     return (VdpDecoderProfile)-1;
@@ -132,6 +194,37 @@ check_decoder(
     return VA_STATUS_SUCCESS;
 }
 
+// Returns the VAConfigAttribMPEG1VDPAU value for configs of profile
+unsigned int
+get_mpeg1_attribute(vdpau_driver_data_t *driver_data, VAProfile profile)
+{
+    /* VA-API has no MPEG-1 profile, MPEG-1 comes as MPEG-2 */
+    switch (profile) {
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main:
+        if (is_supported_profile(driver_data, VDP_DECODER_PROFILE_MPEG1))
+            return 1;
+        break;
+    default:
+        break;
+    }
+    return VA_ATTRIB_NOT_SUPPORTED;
+}
+
+// Translates the profile of a config to VdpDecoderProfile
+VdpDecoderProfile
+get_config_VdpDecoderProfile(object_config_p obj_config)
+{
+    int i;
+
+    for (i = 0; i < obj_config->attrib_count; i++) {
+        const VAConfigAttrib * const attrib = &obj_config->attrib_list[i];
+        if (attrib->type == VAConfigAttribMPEG1VDPAU && attrib->value == 1)
+            return VDP_DECODER_PROFILE_MPEG1;
+    }
+    return get_VdpDecoderProfile(obj_config->profile);
+}
+
 // Computes value for VdpDecoderCreate()::max_references parameter
 static int
 get_max_ref_frames(
@@ -154,6 +247,26 @@ get_max_ref_frames(
             max_ref_frames = 16;
         break;
     }
+#if USE_VDPAU_HEVC
+    case VDP_DECODER_PROFILE_HEVC_MAIN:
+    case VDP_DECODER_PROFILE_HEVC_MAIN_10:
+        /* maximum DPB size */
+        max_ref_frames = 16;
+        break;
+#endif
+#if USE_VDPAU_VP9
+    case VDP_DECODER_PROFILE_VP9_PROFILE_0:
+    case VDP_DECODER_PROFILE_VP9_PROFILE_2:
+        /* reference frame slots */
+        max_ref_frames = 8;
+        break;
+#endif
+#if USE_VDPAU_AV1
+    case VDP_DECODER_PROFILE_AV1_MAIN:
+        /* reference frame slots */
+        max_ref_frames = 8;
+        break;
+#endif
     }
     return max_ref_frames;
 }
@@ -161,11 +274,559 @@ get_max_ref_frames(
 // Returns the maximum number of reference frames of a decode session
 static inline int get_num_ref_frames(object_context_p obj_context)
 {
-    if (obj_context->vdp_codec == VDP_CODEC_H264)
-        return obj_context->vdp_picture_info.h264.num_ref_frames;
+    if (obj_context->decode_backend->get_num_ref_frames)
+        return obj_context->decode_backend->get_num_ref_frames(obj_context);
     return 2;
 }
 
+/*
+ * Asynchronous decode submission (VDPAU_VIDEO_ASYNC_DECODE=yes)
+ *
+ * vaEndPicture() queues the picture slot it translated into to a
+ * per-context worker thread, which calls VdpDecoderRender() on its
+ * behalf, and the next picture is translated into the following slot.
+ * A slot keeps the picture arena, hence the slice data, alive until it
+ * comes round again. Pictures complete in submission order, so a slot
+ * or a surface only needs to remember the sequence number of the last
+ * picture that used it.
+ */
+
+typedef struct decode_worker decode_worker_t;
+struct decode_worker {
+    vdpau_driver_data_t        *driver_data;
+    UAsyncQueue                *queue;
+    pthread_t                   thread;
+    pthread_mutex_t             mutex;
+    pthread_cond_t              cond;
+    uint64_t                    num_submitted;
+    uint64_t                    num_completed;
+    VdpStatus                   vdp_status;
+};
+
+static void *
+decode_worker_thread(void *arg)
+{
+    decode_worker_t * const worker = arg;
+    vdpau_driver_data_t * const driver_data = worker->driver_data;
+
+    for (;;) {
+        picture_slot_t * const slot = async_queue_pop(worker->queue);
+        if (!slot) {
+            if (async_queue_is_closed(worker->queue))
+                break;
+            continue;
+        }
+
+        VdpStatus vdp_status;
+        vdp_status = vdpau_decoder_render(
+            driver_data,
+            slot->vdp_decoder,
+            slot->vdp_surface,
+            (VdpPictureInfo)&slot->vdp_picture_info,
+            slot->vdp_bitstream_buffers_count,
+            slot->vdp_bitstream_buffers
+        );
+
+        pthread_mutex_lock(&worker->mutex);
+        if (vdp_status != VDP_STATUS_OK && worker->vdp_status == VDP_STATUS_OK)
+            worker->vdp_status = vdp_status;
+        worker->num_completed++;
+        pthread_cond_broadcast(&worker->cond);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    return NULL;
+}
+
+// Create the asynchronous decode worker of a context
+int
+decode_worker_create(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    decode_worker_t *worker;
+
+    worker = calloc(1, sizeof(*worker));
+    if (!worker)
+        return -1;
+
+    worker->driver_data = driver_data;
+    worker->vdp_status  = VDP_STATUS_OK;
+    worker->queue       = async_queue_new();
+    if (!worker->queue)
+        goto error_queue;
+
+    pthread_mutex_init(&worker->mutex, NULL);
+    if (pthread_cond_init(&worker->cond, NULL) != 0)
+        goto error_cond;
+    if (pthread_create(&worker->thread, NULL, decode_worker_thread, worker) != 0)
+        goto error_thread;
+
+    obj_context->decode_worker = worker;
+    return 0;
+
+error_thread:
+    pthread_cond_destroy(&worker->cond);
+error_cond:
+    pthread_mutex_destroy(&worker->mutex);
+    async_queue_free(worker->queue);
+error_queue:
+    free(worker);
+    return -1;
+}
+
+// Wait for all pictures to be submitted and destroy the decode worker
+void
+decode_worker_destroy(object_context_p obj_context)
+{
+    decode_worker_t * const worker = obj_context->decode_worker;
+
+    if (!worker)
+        return;
+
+    /* The worker decodes what is left in the queue, then exits */
+    async_queue_close(worker->queue);
+    pthread_join(worker->thread, NULL);
+
+    pthread_cond_destroy(&worker->cond);
+    pthread_mutex_destroy(&worker->mutex);
+    async_queue_free(worker->queue);
+    free(worker);
+    obj_context->decode_worker = NULL;
+}
+
+// Wait for the first SEQ jobs to complete
+static void
+decode_worker_wait(decode_worker_t *worker, uint64_t seq)
+{
+    pthread_mutex_lock(&worker->mutex);
+    while (worker->num_completed < seq)
+        pthread_cond_wait(&worker->cond, &worker->mutex);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+// Wait for all queued jobs of a context to complete
+static inline void
+decode_worker_drain(object_context_p obj_context)
+{
+    decode_worker_t * const worker = obj_context->decode_worker;
+
+    if (worker)
+        decode_worker_wait(worker, worker->num_submitted);
+}
+
+// Wait until the decode worker is done with the picture slot
+static void
+reclaim_picture_slot(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    picture_slot_t      *slot
+)
+{
+    if (slot->decode_seq) {
+        decode_worker_wait(obj_context->decode_worker, slot->decode_seq);
+        slot->decode_seq = 0;
+    }
+    if (slot->picture_arena) {
+        release_picture_arena(driver_data, slot->picture_arena);
+        slot->picture_arena = NULL;
+    }
+}
+
+// Move on to the next picture slot if the current one is queued
+static void
+next_picture_slot(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    picture_slot_t * const prev_slot = obj_context->picture_slot;
+    picture_slot_t *slot;
+    unsigned int index;
+
+    if (!prev_slot->decode_seq)
+        return;
+
+    index = (obj_context->picture_slot_index + 1) % VDPAU_PICTURE_SLOTS;
+    slot  = &obj_context->picture_slots[index];
+    reclaim_picture_slot(driver_data, obj_context, slot);
+
+    /* Translations skipped by translate_buffer_cached() rely on
+       VdpPictureInfo carrying over from the previous picture */
+    slot->vdp_picture_info          = prev_slot->vdp_picture_info;
+    obj_context->picture_slot       = slot;
+    obj_context->picture_slot_index = index;
+}
+
+// Destroy the picture slots of a context, once its decode worker is gone
+void
+destroy_picture_slots(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    unsigned int i;
+
+    ASSERT(!obj_context->decode_worker);
+    for (i = 0; i < VDPAU_PICTURE_SLOTS; i++) {
+        picture_slot_t * const slot = &obj_context->picture_slots[i];
+
+        slot->decode_seq = 0;
+        reclaim_picture_slot(driver_data, obj_context, slot);
+        free(slot->vdp_bitstream_buffers);
+        slot->vdp_bitstream_buffers = NULL;
+        slot->vdp_bitstream_buffers_count = 0;
+        slot->vdp_bitstream_buffers_count_max = 0;
+        free(slot->coalesce_buffer);
+        slot->coalesce_buffer = NULL;
+        slot->coalesce_buffer_size_max = 0;
+        if (slot->gen_slice_arena) {
+            arena_free(slot->gen_slice_arena);
+            slot->gen_slice_arena = NULL;
+        }
+    }
+}
+
+// Queue the current picture slot for decoding into OBJ_SURFACE
+static VdpStatus
+decode_worker_submit(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    object_surface_p     obj_surface
+)
+{
+    decode_worker_t * const worker = obj_context->decode_worker;
+    picture_slot_t * const slot = obj_context->picture_slot;
+    VdpStatus vdp_status = VDP_STATUS_OK;
+
+    slot->vdp_decoder   = obj_context->vdp_decoder;
+    slot->vdp_surface   = obj_surface->vdp_surface;
+    slot->picture_arena = hold_picture_arena(obj_context);
+    slot->decode_seq    = ++worker->num_submitted;
+    if (async_queue_push(worker->queue, slot))
+        obj_surface->decode_seq = slot->decode_seq;
+    else {
+        /* Out of memory: decode the picture right away instead, after
+           the pictures queued before it, which it may reference */
+        slot->decode_seq = 0;
+        worker->num_submitted--;
+        decode_worker_wait(worker, worker->num_submitted);
+        vdp_status = vdpau_decoder_render(
+            driver_data,
+            slot->vdp_decoder,
+            slot->vdp_surface,
+            (VdpPictureInfo)&slot->vdp_picture_info,
+            slot->vdp_bitstream_buffers_count,
+            slot->vdp_bitstream_buffers
+        );
+        if (slot->picture_arena) {
+            release_picture_arena(driver_data, slot->picture_arena);
+            slot->picture_arena = NULL;
+        }
+    }
+
+    /* Report errors from earlier pictures, as there is no better place */
+    pthread_mutex_lock(&worker->mutex);
+    if (vdp_status == VDP_STATUS_OK)
+        vdp_status = worker->vdp_status;
+    worker->vdp_status = VDP_STATUS_OK;
+    pthread_mutex_unlock(&worker->mutex);
+    return vdp_status;
+}
+
+// Check whether the last picture decoded into surface is still queued
+int
+surface_decode_pending(
+    vdpau_driver_data_t *driver_data,
+    object_surface_p     obj_surface
+)
+{
+    const VAContextID context = surface_get_context(obj_surface);
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return 0;
+
+    /* The context lock keeps the worker alive and orders decode_seq
+       with decode_worker_submit(). The context may have been destroyed
+       while we waited for it */
+    int is_pending = 0;
+    pthread_mutex_lock(&obj_context->lock);
+    decode_worker_t * const worker =
+        context_is_alive(driver_data, obj_context, context) ?
+        obj_context->decode_worker : NULL;
+    if (worker) {
+        pthread_mutex_lock(&worker->mutex);
+        is_pending = worker->num_completed < obj_surface->decode_seq;
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    pthread_mutex_unlock(&obj_context->lock);
+    return is_pending;
+}
+
+// Wait for the last picture decoded into surface to be submitted to VDPAU
+void
+sync_surface_decode(
+    vdpau_driver_data_t *driver_data,
+    object_surface_p     obj_surface
+)
+{
+    const VAContextID context = surface_get_context(obj_surface);
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return;
+
+    /* The worker never takes the context lock, so waiting under it is
+       safe, and it keeps vaDestroyContext() from freeing the worker */
+    pthread_mutex_lock(&obj_context->lock);
+    if (context_is_alive(driver_data, obj_context, context) &&
+        obj_context->decode_worker)
+        decode_worker_wait(obj_context->decode_worker, obj_surface->decode_seq);
+    pthread_mutex_unlock(&obj_context->lock);
+}
+
+/*
+ * Idle decoder cache
+ *
+ * Decoders of destroyed contexts are kept in a driver-wide list, most
+ * recently used first, so that a new context with the same profile and
+ * size can skip VdpDecoderCreate(). The least recently used decoders are
+ * destroyed once their estimated footprint exceeds the configured limit.
+ * The list is shared by all contexts and guarded by decoder_cache_lock.
+ */
+typedef struct decoder_cache_entry decoder_cache_entry_t;
+struct decoder_cache_entry {
+    VdpDecoder                  vdp_decoder;
+    VdpDecoderProfile           vdp_profile;
+    unsigned int                width;
+    unsigned int                height;
+    int                         max_ref_frames;
+    uint64_t                    size;
+};
+
+// Destroy the least recently used decoders until the cache fits MAX_SIZE
+static void
+decoder_cache_trim(vdpau_driver_data_t *driver_data, uint64_t max_size)
+{
+    while (driver_data->decoder_cache_size > max_size) {
+        UList * const last = list_last(driver_data->decoder_cache);
+        decoder_cache_entry_t * const entry = last->data;
+
+        vdpau_decoder_destroy(driver_data, entry->vdp_decoder);
+        driver_data->decoder_cache_size -= entry->size;
+        driver_data->decoder_cache =
+            list_delete_link(driver_data->decoder_cache, last);
+        free(entry);
+    }
+}
+
+// Take a cached decoder suitable for OBJ_CONTEXT, if any
+static VdpDecoder
+decoder_cache_acquire(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    int                  max_ref_frames
+)
+{
+    VdpDecoder vdp_decoder = VDP_INVALID_HANDLE;
+    UList *l;
+
+    pthread_mutex_lock(&driver_data->decoder_cache_lock);
+    for (l = driver_data->decoder_cache; l != NULL; l = l->next) {
+        decoder_cache_entry_t * const entry = l->data;
+        if (entry->vdp_profile != obj_context->vdp_profile ||
+            entry->width != obj_context->picture_width ||
+            entry->height != obj_context->picture_height ||
+            entry->max_ref_frames < max_ref_frames)
+            continue;
+
+        vdp_decoder = entry->vdp_decoder;
+        obj_context->max_ref_frames = entry->max_ref_frames;
+        driver_data->decoder_cache_size -= entry->size;
+        driver_data->decoder_cache =
+            list_delete_link(driver_data->decoder_cache, l);
+        free(entry);
+        break;
+    }
+    if (vdp_decoder != VDP_INVALID_HANDLE)
+        driver_data->num_decoder_cache_hits++;
+    else
+        driver_data->num_decoder_cache_misses++;
+    pthread_mutex_unlock(&driver_data->decoder_cache_lock);
+    return vdp_decoder;
+}
+
+// Hand the decoder of a context over to the idle decoder cache
+void
+decoder_cache_release(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    decoder_cache_entry_t *entry;
+    UList *list;
+
+    if (driver_data->decoder_cache_max_size == 0)
+        goto error;
+
+    entry = malloc(sizeof(*entry));
+    if (!entry)
+        goto error;
+
+    /* Account for the reference frames, which dominate decoder memory */
+    entry->vdp_decoder    = obj_context->vdp_decoder;
+    entry->vdp_profile    = obj_context->vdp_profile;
+    entry->width          = obj_context->picture_width;
+    entry->height         = obj_context->picture_height;
+    entry->max_ref_frames = obj_context->max_ref_frames;
+    entry->size           = (uint64_t)(entry->max_ref_frames + 1) *
+        vdpau_video_surface_size(VDP_CHROMA_TYPE_420,
+                                 entry->width, entry->height);
+
+    pthread_mutex_lock(&driver_data->decoder_cache_lock);
+    list = list_prepend(driver_data->decoder_cache, entry);
+    if (!list) {
+        pthread_mutex_unlock(&driver_data->decoder_cache_lock);
+        free(entry);
+        goto error;
+    }
+    driver_data->decoder_cache = list;
+    driver_data->decoder_cache_size += entry->size;
+    decoder_cache_trim(driver_data, driver_data->decoder_cache_max_size);
+    pthread_mutex_unlock(&driver_data->decoder_cache_lock);
+    return;
+
+error:
+    vdpau_decoder_destroy(driver_data, obj_context->vdp_decoder);
+}
+
+// Destroy all idle decoders
+void
+decoder_cache_flush(vdpau_driver_data_t *driver_data)
+{
+    pthread_mutex_lock(&driver_data->decoder_cache_lock);
+    decoder_cache_trim(driver_data, 0);
+    pthread_mutex_unlock(&driver_data->decoder_cache_lock);
+}
+
+typedef struct decoder_warmup_args decoder_warmup_args_t;
+struct decoder_warmup_args {
+    vdpau_driver_data_t        *driver_data;
+    object_context_p            obj_context;
+};
+
+static void *
+decoder_warmup_thread(void *arg)
+{
+    decoder_warmup_args_t * const args = arg;
+    object_context_p const obj_context = args->obj_context;
+    VdpStatus vdp_status;
+
+    /* Only the context fields below are touched until decoder_warmup_wait() */
+    vdp_status = vdpau_decoder_create(
+        args->driver_data,
+        args->driver_data->vdp_device,
+        obj_context->vdp_profile,
+        obj_context->picture_width,
+        obj_context->picture_height,
+        obj_context->max_ref_frames,
+        &obj_context->vdp_decoder
+    );
+    if (vdp_status != VDP_STATUS_OK)
+        obj_context->vdp_decoder = VDP_INVALID_HANDLE;
+    free(args);
+    return NULL;
+}
+
+// Wait for the decoder warm-up thread of a context, if any
+void
+decoder_warmup_wait(object_context_p obj_context)
+{
+    if (!obj_context->warmup_pending)
+        return;
+
+    pthread_join(obj_context->warmup_thread, NULL);
+    obj_context->warmup_pending = 0;
+}
+
+// Create the decoder of a new context ahead of its first picture
+void
+decoder_warmup(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    decoder_warmup_args_t *args;
+
+    if (driver_data->decoder_warmup == VDPAU_DECODER_WARMUP_NONE)
+        return;
+
+    /* Size as get_max_ref_frames() does, i.e. level 4.1 DPB limits for
+       H.264, so that most streams need not recreate the decoder when
+       they reveal their num_ref_frames. Streams needing more reference
+       frames still recreate it on their first picture */
+    const int max_ref_frames =
+        get_max_ref_frames(obj_context->vdp_profile,
+                           obj_context->picture_width,
+                           obj_context->picture_height);
+
+    obj_context->vdp_decoder =
+        decoder_cache_acquire(driver_data, obj_context, max_ref_frames);
+    if (obj_context->vdp_decoder != VDP_INVALID_HANDLE)
+        return;
+    obj_context->max_ref_frames = max_ref_frames;
+
+    if (driver_data->decoder_warmup == VDPAU_DECODER_WARMUP_THREAD) {
+        args = malloc(sizeof(*args));
+        if (args) {
+            args->driver_data = driver_data;
+            args->obj_context = obj_context;
+            if (pthread_create(&obj_context->warmup_thread, NULL,
+                               decoder_warmup_thread, args) == 0) {
+                obj_context->warmup_pending = 1;
+                return;
+            }
+            free(args);
+        }
+    }
+
+    /* Synchronous warm-up, or failure to start the thread */
+    VdpStatus vdp_status;
+    vdp_status = vdpau_decoder_create(
+        driver_data,
+        driver_data->vdp_device,
+        obj_context->vdp_profile,
+        obj_context->picture_width,
+        obj_context->picture_height,
+        max_ref_frames,
+        &obj_context->vdp_decoder
+    );
+    if (!VDPAU_CHECK_STATUS(vdp_status, "VdpDecoderCreate()"))
+        obj_context->vdp_decoder = VDP_INVALID_HANDLE;
+}
+
+// Record the time taken to decode the first picture of a context
+static void
+update_first_picture_stats(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    const uint64_t elapsed = get_ticks_usec() - obj_context->first_picture_time;
+    uint64_t max_elapsed;
+
+    /* Contexts may be decoding concurrently */
+    __atomic_add_fetch(&driver_data->num_first_pictures, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&driver_data->first_picture_time_total, elapsed,
+                       __ATOMIC_RELAXED);
+    max_elapsed = __atomic_load_n(&driver_data->first_picture_time_max,
+                                  __ATOMIC_RELAXED);
+    while (max_elapsed < elapsed &&
+           !__atomic_compare_exchange_n(&driver_data->first_picture_time_max,
+                                        &max_elapsed, elapsed, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
 // Ensure VDPAU decoder is created for the specified number of reference frames
 static VdpStatus
 ensure_decoder_with_max_refs(
@@ -176,17 +837,28 @@ ensure_decoder_with_max_refs(
 {
     VdpStatus vdp_status;
 
+    decoder_warmup_wait(obj_context);
+
     if (max_ref_frames < 0)
         max_ref_frames =
             get_max_ref_frames(obj_context->vdp_profile,
                                obj_context->picture_width,
                                obj_context->picture_height);
 
+    if (obj_context->vdp_decoder == VDP_INVALID_HANDLE) {
+        obj_context->vdp_decoder =
+            decoder_cache_acquire(driver_data, obj_context, max_ref_frames);
+        if (obj_context->vdp_decoder != VDP_INVALID_HANDLE)
+            return VDP_STATUS_OK;
+    }
+
     if (obj_context->vdp_decoder == VDP_INVALID_HANDLE ||
         obj_context->max_ref_frames < max_ref_frames) {
         obj_context->max_ref_frames = max_ref_frames;
 
         if (obj_context->vdp_decoder != VDP_INVALID_HANDLE) {
+            /* Queued pictures still reference the old decoder */
+            decode_worker_drain(obj_context);
             vdpau_decoder_destroy(driver_data, obj_context->vdp_decoder);
             obj_context->vdp_decoder = VDP_INVALID_HANDLE;
         }
@@ -206,41 +878,71 @@ ensure_decoder_with_max_refs(
     return VDP_STATUS_OK;
 }
 
-// Lazy allocate (generated) slice data buffer. Buffer lives until vaDestroyContext()
-static uint8_t *
+// Reserved size per generated slice header (MPEG-2 slice_vertical_position,
+// rounded up to the arena alignment)
+#define GEN_SLICE_HEADER_SIZE 16
+
+// Allocate (generated) slice data buffer. Buffer lives until its picture slot is reused
+static inline uint8_t *
 alloc_gen_slice_data(object_context_p obj_context, unsigned int size)
 {
-    uint8_t *gen_slice_data = obj_context->gen_slice_data;
+    picture_slot_t * const slot = obj_context->picture_slot;
 
-    if (obj_context->gen_slice_data_size + size > obj_context->gen_slice_data_size_max) {
-        obj_context->gen_slice_data_size_max += size;
-        gen_slice_data = realloc(obj_context->gen_slice_data,
-                                 obj_context->gen_slice_data_size_max);
-        if (!gen_slice_data)
+    if (!slot->gen_slice_arena) {
+        slot->gen_slice_arena = arena_new(VDPAU_GEN_SLICE_ARENA_SIZE);
+        if (!slot->gen_slice_arena)
             return NULL;
-        obj_context->gen_slice_data = gen_slice_data;
     }
-    gen_slice_data += obj_context->gen_slice_data_size;
-    obj_context->gen_slice_data_size += size;
-    return gen_slice_data;
+    return arena_alloc(slot->gen_slice_arena, size);
+}
+
+// Prepare generated slice data and VdpBitstreamBuffers for a new picture
+static void
+reset_gen_slice_data(object_context_p obj_context)
+{
+    /* Size for the largest number of slices seen so far, so that
+       steady-state pictures never allocate */
+    const unsigned int max_slice_count = obj_context->max_slice_count;
+    picture_slot_t * const slot = obj_context->picture_slot;
+
+    obj_context->slice_count = 0;
+    slot->vdp_bitstream_buffers_count = 0;
+    if (max_slice_count == 0)
+        return;
+
+    /* MPEG-2 slices use up to 3 VdpBitstreamBuffers (start code,
+       generated slice_vertical_position, slice data) */
+    realloc_buffer(
+        (void **)&slot->vdp_bitstream_buffers,
+        &slot->vdp_bitstream_buffers_count_max,
+        3 * max_slice_count,
+        sizeof(*slot->vdp_bitstream_buffers)
+    );
+
+    if (slot->gen_slice_arena) {
+        arena_reset(slot->gen_slice_arena);
+        arena_reserve(slot->gen_slice_arena,
+                      max_slice_count * GEN_SLICE_HEADER_SIZE);
+    }
 }
 
 // Lazy allocate VdpBitstreamBuffer. Buffer lives until vaDestroyContext()
 static VdpBitstreamBuffer *
 alloc_VdpBitstreamBuffer(object_context_p obj_context)
 {
+    picture_slot_t * const slot = obj_context->picture_slot;
     VdpBitstreamBuffer *vdp_bitstream_buffers;
 
     vdp_bitstream_buffers = realloc_buffer(
-        (void **)&obj_context->vdp_bitstream_buffers,
-        &obj_context->vdp_bitstream_buffers_count_max,
-        1 + obj_context->vdp_bitstream_buffers_count,
-        sizeof(*obj_context->vdp_bitstream_buffers)
+        (void **)&slot->vdp_bitstream_buffers,
+        &slot->vdp_bitstream_buffers_count_max,
+        1 + slot->vdp_bitstream_buffers_count,
+        sizeof(*slot->vdp_bitstream_buffers)
     );
     if (!vdp_bitstream_buffers)
         return NULL;
 
-    return &vdp_bitstream_buffers[obj_context->vdp_bitstream_buffers_count++];
+    return &vdp_bitstream_buffers[slot->vdp_bitstream_buffers_count++];
 }
 
 // Append VASliceDataBuffer hunk into VDPAU buffer
@@ -263,6 +965,54 @@ append_VdpBitstreamBuffer(
     return 0;
 }
 
+// Merge all VdpBitstreamBuffers into a single contiguous buffer, if worthwhile
+static void
+coalesce_VdpBitstreamBuffers(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    picture_slot_t * const slot = obj_context->picture_slot;
+    VdpBitstreamBuffer * const vdp_bitstream_buffers =
+        slot->vdp_bitstream_buffers;
+    const unsigned int count = slot->vdp_bitstream_buffers_count;
+    unsigned int i, size;
+
+    /* The copy costs more than it saves unless VdpDecoderRender() has a
+       high cost per fragment, see tests/bench_coalesce.c */
+    if (driver_data->coalesce_min_fragments == 0 ||
+        count < driver_data->coalesce_min_fragments ||
+        count < 2)
+        return;
+
+    size = 0;
+    for (i = 0; i < count; i++) {
+        size += vdp_bitstream_buffers[i].bitstream_bytes;
+        if (size > driver_data->coalesce_max_bytes)
+            return;
+    }
+
+    if (!realloc_buffer(
+            (void **)&slot->coalesce_buffer,
+            &slot->coalesce_buffer_size_max,
+            size,
+            1))
+        return;
+
+    uint8_t *dst = slot->coalesce_buffer;
+    for (i = 0; i < count; i++) {
+        const unsigned int n = vdp_bitstream_buffers[i].bitstream_bytes;
+        memcpy(dst, vdp_bitstream_buffers[i].bitstream, n);
+        dst += n;
+    }
+
+    vdp_bitstream_buffers[0].struct_version  = VDP_BITSTREAM_BUFFER_VERSION;
+    vdp_bitstream_buffers[0].bitstream       = slot->coalesce_buffer;
+    vdp_bitstream_buffers[0].bitstream_bytes = size;
+    slot->vdp_bitstream_buffers_count = 1;
+    __atomic_add_fetch(&driver_data->num_coalesced_pictures, 1, __ATOMIC_RELAXED);
+}
+
 // Initialize VdpReferenceFrameH264 to default values
 static void init_VdpReferenceFrameH264(VdpReferenceFrameH264 *rf)
 {
@@ -341,6 +1091,25 @@ static const uint8_t ff_mpeg4_default_non_intra_matrix[64] = {
     23, 24, 25, 27, 28, 30, 31, 33,
 };
 
+#if USE_VDPAU_HEVC
+/* HEVC up-right diagonal scan, as raster positions (6.5.3) */
+static const uint8_t hevc_diag_scan_4x4[16] = {
+    0,   4,  1,  8,  5,  2, 12,  9,
+    6,   3, 13, 10,  7, 14, 11, 15
+};
+
+static const uint8_t hevc_diag_scan_8x8[64] = {
+    0,   8,  1, 16,  9,  2, 24, 17,
+    10,  3, 32, 25, 18, 11,  4, 40,
+    33, 26, 19, 12,  5, 48, 41, 34,
+    27, 20, 13,  6, 56, 49, 42, 35,
+    28, 21, 14,  7, 57, 50, 43, 36,
+    29, 22, 15, 58, 51, 44, 37, 30,
+    23, 59, 52, 45, 38, 31, 60, 53,
+    46, 39, 61, 54, 47, 62, 55, 63
+};
+#endif
+
 // Compute integer log2
 static inline int ilog2(uint32_t v)
 {
@@ -357,6 +1126,7 @@ static inline int ilog2(uint32_t v)
 static int
 translate_VASurfaceID(
     vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
     VASurfaceID          va_surface,
     VdpVideoSurface     *vdp_surface
 )
@@ -368,6 +1138,16 @@ translate_VASurfaceID(
         return 1;
     }
 
+    /* Render targets are resolved through the context surface map */
+    const unsigned int index = va_surface & OBJECT_HEAP_INDEX_MASK;
+    if (index < obj_context->surface_map_size) {
+        const context_surface_map_t * const m = &obj_context->surface_map[index];
+        if (m->va_surface == va_surface) {
+            *vdp_surface = m->vdp_surface;
+            return 1;
+        }
+    }
+
     obj_surface = VDPAU_SURFACE(va_surface);
     if (!obj_surface)
         return 0;
@@ -380,6 +1160,7 @@ translate_VASurfaceID(
 static int
 translate_VAPictureH264(
     vdpau_driver_data_t   *driver_data,
+    object_context_p       obj_context,
     const VAPictureH264   *va_pic,
     VdpReferenceFrameH264 *rf
 )
@@ -390,7 +1171,8 @@ translate_VAPictureH264(
         return 1;
     }
 
-    if (!translate_VASurfaceID(driver_data, va_pic->picture_id, &rf->surface))
+    if (!translate_VASurfaceID(driver_data, obj_context,
+                               va_pic->picture_id, &rf->surface))
         return 0;
     rf->is_long_term            = (va_pic->flags & VA_PICTURE_H264_LONG_TERM_REFERENCE) != 0;
     if ((va_pic->flags & (VA_PICTURE_H264_TOP_FIELD|VA_PICTURE_H264_BOTTOM_FIELD)) == 0) {
@@ -418,8 +1200,9 @@ translate_nothing(
     return 1;
 }
 
+// Translate VASliceDataBuffer for MPEG-2
 static int
-translate_VASliceDataBuffer_MPEG2(
+translate_VASliceDataBufferMPEG2(
     vdpau_driver_data_t *driver_data,
     object_context_p    obj_context,
     object_buffer_p     obj_buffer
@@ -462,40 +1245,181 @@ translate_VASliceDataBuffer(
     object_buffer_p     obj_buffer
 )
 {
-    if (obj_context->vdp_codec == VDP_CODEC_H264) {
-        /* Check we have the start code */
-        /* XXX: check for other codecs too? */
-        /* XXX: this assumes we get SliceParams before SliceData */
-        static const uint8_t start_code_prefix[3] = { 0x00, 0x00, 0x01 };
-        VASliceParameterBufferH264 * const slice_params = obj_context->last_slice_params;
-        unsigned int i;
-        for (i = 0; i < obj_context->last_slice_params_count; i++) {
-            VASliceParameterBufferH264 * const slice_param = &slice_params[i];
-            uint8_t *buf = (uint8_t *)obj_buffer->buffer_data + slice_param->slice_data_offset;
-            if (memcmp(buf, start_code_prefix, sizeof(start_code_prefix)) != 0) {
-                if (append_VdpBitstreamBuffer(obj_context,
-                                              start_code_prefix,
-                                              sizeof(start_code_prefix)) < 0)
-                    return 0;
-            }
-            if (append_VdpBitstreamBuffer(obj_context,
-                                          buf,
-                                          slice_param->slice_data_size) < 0)
-                return 0;
-        }
-        return 1;
+    if (append_VdpBitstreamBuffer(obj_context,
+                                  obj_buffer->buffer_data,
+                                  obj_buffer->buffer_size) < 0)
+        return 0;
+    return 1;
+}
+
+// Append NAL unit, prepending the start code if it is missing
+static int
+append_nal_unit(
+    object_context_p    obj_context,
+    const uint8_t      *buf,
+    unsigned int        buf_size
+)
+{
+    static const uint8_t start_code_prefix[3] = { 0x00, 0x00, 0x01 };
+
+    if (buf_size < sizeof(start_code_prefix) ||
+        memcmp(buf, start_code_prefix, sizeof(start_code_prefix)) != 0) {
+        if (append_VdpBitstreamBuffer(obj_context,
+                                      start_code_prefix,
+                                      sizeof(start_code_prefix)) < 0)
+            return 0;
     }
+    if (append_VdpBitstreamBuffer(obj_context, buf, buf_size) < 0)
+        return 0;
+    return 1;
+}
 
-    if (obj_context->vdp_codec == VDP_CODEC_MPEG2)
-        return translate_VASliceDataBuffer_MPEG2(driver_data,
-                                                 obj_context, obj_buffer);
+// Checks whether the H.264 NAL unit starting with header byte is a slice
+static inline int is_slice_nal_unit_H264(uint8_t header)
+{
+    const unsigned int nal_unit_type = header & 0x1f;
+    return nal_unit_type >= 1 && nal_unit_type <= 5;
+}
 
-#if USE_VDPAU_MPEG4
-    if (obj_context->vdp_codec == VDP_CODEC_MPEG4 &&
-        obj_context->vdp_bitstream_buffers_count == 0) {
-        PutBitContext pb;
-        uint8_t slice_header_buffer[32];
-        uint8_t *slice_header;
+// Append the slice NAL units of buf, split at start codes
+static int
+append_slice_nal_units_H264(
+    object_context_p    obj_context,
+    const uint8_t      *buf,
+    unsigned int        buf_size,
+    unsigned int       *num_slices_p
+)
+{
+    unsigned int i, pos, next;
+
+    /* Leading bytes are either a NAL unit without start code, or
+       zero_byte / trailing_zero_8bits that need not be submitted */
+    pos = bitstream_find_start_code(buf, buf_size);
+    for (i = 0; i < pos; i++) {
+        if (buf[i] != 0) {
+            if (is_slice_nal_unit_H264(buf[i])) {
+                if (!append_nal_unit(obj_context, buf + i, pos - i))
+                    return 0;
+                ++*num_slices_p;
+            }
+            break;
+        }
+    }
+
+    while (pos < buf_size) {
+        next = pos + 3;
+        next += bitstream_find_start_code(buf + next, buf_size - next);
+        if (pos + 3 < next && is_slice_nal_unit_H264(buf[pos + 3])) {
+            if (append_VdpBitstreamBuffer(obj_context, buf + pos, next - pos) < 0)
+                return 0;
+            ++*num_slices_p;
+        }
+        pos = next;
+    }
+    return 1;
+}
+
+// Translate VASliceDataBuffer for H.264, locating slices from start codes
+static int
+split_VASliceDataBufferH264(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    VASliceParameterBufferH264 * const slice_params = obj_context->last_slice_params;
+    const unsigned int num_slice_params = obj_context->last_slice_params_count;
+    const uint8_t * const buf = obj_buffer->buffer_data;
+    const unsigned int buf_size = obj_buffer->buffer_size;
+    unsigned int i, num_slices = 0;
+
+    /* Whole access units may come without any slice parameters */
+    if (num_slice_params == 0) {
+        if (!append_slice_nal_units_H264(obj_context, buf, buf_size, &num_slices))
+            return 0;
+    }
+
+    for (i = 0; i < num_slice_params; i++) {
+        VASliceParameterBufferH264 * const slice_param = &slice_params[i];
+        unsigned int offset = MIN(slice_param->slice_data_offset, buf_size);
+        unsigned int size   = MIN(slice_param->slice_data_size, buf_size - offset);
+        if (!append_slice_nal_units_H264(obj_context, buf + offset, size,
+                                         &num_slices))
+            return 0;
+    }
+
+    if (num_slices == 0) {
+        D(bug("ERROR: no H.264 slice found in %u bytes of slice data\n",
+              buf_size));
+        return 0;
+    }
+
+    /* Slice parameters may come before or after their slice data, so
+       the slice count is only settled by end_picture_H264(). Do not
+       apply these parameters to slice data that comes next */
+    obj_context->split_slice_count += num_slices;
+    obj_context->last_slice_params_count = 0;
+    return 1;
+}
+
+// Translate VASliceDataBuffer for H.264
+static int
+translate_VASliceDataBufferH264(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    if (driver_data->split_slices)
+        return split_VASliceDataBufferH264(driver_data, obj_context, obj_buffer);
+
+    /* XXX: this assumes we get SliceParams before SliceData */
+    VASliceParameterBufferH264 * const slice_params = obj_context->last_slice_params;
+    unsigned int i;
+    for (i = 0; i < obj_context->last_slice_params_count; i++) {
+        VASliceParameterBufferH264 * const slice_param = &slice_params[i];
+        uint8_t *buf = (uint8_t *)obj_buffer->buffer_data + slice_param->slice_data_offset;
+        if (!append_nal_unit(obj_context, buf, slice_param->slice_data_size))
+            return 0;
+    }
+    return 1;
+}
+
+#if USE_VDPAU_HEVC
+// Translate VASliceDataBuffer for HEVC
+static int
+translate_VASliceDataBufferHEVC(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    VASliceParameterBufferHEVC * const slice_params = obj_context->last_slice_params;
+    unsigned int i;
+    for (i = 0; i < obj_context->last_slice_params_count; i++) {
+        VASliceParameterBufferHEVC * const slice_param = &slice_params[i];
+        uint8_t *buf = (uint8_t *)obj_buffer->buffer_data + slice_param->slice_data_offset;
+        if (!append_nal_unit(obj_context, buf, slice_param->slice_data_size))
+            return 0;
+    }
+    return 1;
+}
+#endif
+
+#if USE_VDPAU_MPEG4
+// Translate VASliceDataBuffer for MPEG-4
+static int
+translate_VASliceDataBufferMPEG4(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    /* Only the first slice needs its VOP header reconstructed */
+    if (obj_context->picture_slot->vdp_bitstream_buffers_count == 0) {
+        PutBitContext pb;
+        uint8_t slice_header_buffer[32];
+        uint8_t *slice_header;
         int slice_header_size;
         const uint8_t *slice_data = obj_buffer->buffer_data;
         uint32_t slice_data_size = obj_buffer->buffer_size;
@@ -580,14 +1504,9 @@ translate_VASliceDataBuffer(
             return 0;
         return 1;
     }
-#endif
-
-    if (append_VdpBitstreamBuffer(obj_context,
-                                  obj_buffer->buffer_data,
-                                  obj_buffer->buffer_size) < 0)
-        return 0;
-    return 1;
+    return translate_VASliceDataBuffer(driver_data, obj_context, obj_buffer);
 }
+#endif
 
 // Translate VAPictureParameterBufferMPEG2
 static int
@@ -597,15 +1516,15 @@ translate_VAPictureParameterBufferMPEG2(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->vdp_picture_info.mpeg2;
+    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->picture_slot->vdp_picture_info.mpeg2;
     VAPictureParameterBufferMPEG2 * const pic_param = obj_buffer->buffer_data;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->forward_reference_picture,
                                &pic_info->forward_reference))
         return 0;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->backward_reference_picture,
                                &pic_info->backward_reference))
         return 0;
@@ -636,7 +1555,7 @@ translate_VAIQMatrixBufferMPEG2(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->vdp_picture_info.mpeg2;
+    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->picture_slot->vdp_picture_info.mpeg2;
     VAIQMatrixBufferMPEG2 * const iq_matrix = obj_buffer->buffer_data;
     const uint8_t *intra_matrix;
     const uint8_t *intra_matrix_lookup;
@@ -679,7 +1598,7 @@ translate_VASliceParameterBufferMPEG2(
     object_buffer_p     obj_buffer
     )
 {
-    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->vdp_picture_info.mpeg2;
+    VdpPictureInfoMPEG1Or2 * const pic_info = &obj_context->picture_slot->vdp_picture_info.mpeg2;
 
     pic_info->slice_count               += obj_buffer->num_elements;
     obj_context->last_slice_params       = obj_buffer->buffer_data;
@@ -696,19 +1615,19 @@ translate_VAPictureParameterBufferMPEG4(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoMPEG4Part2 * const pic_info = &obj_context->vdp_picture_info.mpeg4;
+    VdpPictureInfoMPEG4Part2 * const pic_info = &obj_context->picture_slot->vdp_picture_info.mpeg4;
     VAPictureParameterBufferMPEG4 * const pic_param = obj_buffer->buffer_data;
 
     /* XXX: we don't support short-video-header formats */
     if (pic_param->vol_fields.bits.short_video_header)
         return 0;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->forward_reference_picture,
                                &pic_info->forward_reference))
         return 0;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->backward_reference_picture,
                                &pic_info->backward_reference))
         return 0;
@@ -753,7 +1672,7 @@ translate_VAIQMatrixBufferMPEG4(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoMPEG4Part2 * const pic_info = &obj_context->vdp_picture_info.mpeg4;
+    VdpPictureInfoMPEG4Part2 * const pic_info = &obj_context->picture_slot->vdp_picture_info.mpeg4;
     VAIQMatrixBufferMPEG4 * const iq_matrix = obj_buffer->buffer_data;
     const uint8_t *intra_matrix;
     const uint8_t *intra_matrix_lookup;
@@ -810,7 +1729,7 @@ translate_VAPictureParameterBufferH264(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoH264 * const pic_info = &obj_context->vdp_picture_info.h264;
+    VdpPictureInfoH264 * const pic_info = &obj_context->picture_slot->vdp_picture_info.h264;
     VAPictureParameterBufferH264 * const pic_param = obj_buffer->buffer_data;
     VAPictureH264 * const CurrPic = &pic_param->CurrPic;
     unsigned int i;
@@ -843,7 +1762,7 @@ translate_VAPictureParameterBufferH264(
     pic_info->redundant_pic_cnt_present_flag    = pic_param->pic_fields.bits.redundant_pic_cnt_present_flag;
 
     for (i = 0; i < 16; i++) {
-        if (!translate_VAPictureH264(driver_data,
+        if (!translate_VAPictureH264(driver_data, obj_context,
                                      &pic_param->ReferenceFrames[i],
                                      &pic_info->referenceFrames[i]))
                 return 0;
@@ -859,7 +1778,7 @@ translate_VAIQMatrixBufferH264(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoH264 * const pic_info = &obj_context->vdp_picture_info.h264;
+    VdpPictureInfoH264 * const pic_info = &obj_context->picture_slot->vdp_picture_info.h264;
     VAIQMatrixBufferH264 * const iq_matrix = obj_buffer->buffer_data;
     int i, j;
 
@@ -893,7 +1812,7 @@ translate_VASliceParameterBufferH264(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoH264 * const pic_info = &obj_context->vdp_picture_info.h264;
+    VdpPictureInfoH264 * const pic_info = &obj_context->picture_slot->vdp_picture_info.h264;
     VASliceParameterBufferH264 * const slice_params = obj_buffer->buffer_data;
     VASliceParameterBufferH264 * const slice_param = &slice_params[obj_buffer->num_elements - 1];
 
@@ -913,16 +1832,16 @@ translate_VAPictureParameterBufferVC1(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoVC1 * const pic_info = &obj_context->vdp_picture_info.vc1;
+    VdpPictureInfoVC1 * const pic_info = &obj_context->picture_slot->vdp_picture_info.vc1;
     VAPictureParameterBufferVC1 * const pic_param = obj_buffer->buffer_data;
     int picture_type, major_version, minor_version;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->forward_reference_picture,
                                &pic_info->forward_reference))
         return 0;
 
-    if (!translate_VASurfaceID(driver_data,
+    if (!translate_VASurfaceID(driver_data, obj_context,
                                pic_param->backward_reference_picture,
                                &pic_info->backward_reference))
         return 0;
@@ -978,7 +1897,7 @@ translate_VASliceParameterBufferVC1(
     object_buffer_p     obj_buffer
 )
 {
-    VdpPictureInfoVC1 * const pic_info = &obj_context->vdp_picture_info.vc1;
+    VdpPictureInfoVC1 * const pic_info = &obj_context->picture_slot->vdp_picture_info.vc1;
 
     pic_info->slice_count               += obj_buffer->num_elements;
     obj_context->last_slice_params       = obj_buffer->buffer_data;
@@ -986,295 +1905,1511 @@ translate_VASliceParameterBufferVC1(
     return 1;
 }
 
-// Translate VA buffer
-typedef int
-(*translate_buffer_func_t)(vdpau_driver_data_t *driver_data,
-                           object_context_p    obj_context,
-                           object_buffer_p     obj_buffer);
-
-typedef struct translate_buffer_info translate_buffer_info_t;
-struct translate_buffer_info {
-    VdpCodec codec;
-    VABufferType type;
-    translate_buffer_func_t func;
-};
+#if USE_VDPAU_HEVC
+// Sort RefPicSet indices by PicOrderCntVal (ascending or descending)
+static void
+sort_ref_pic_set_HEVC(
+    const VdpPictureInfoHEVC *pic_info,
+    uint8_t                  *ref_pic_set,
+    unsigned int              count,
+    int                       descending
+)
+{
+    unsigned int i, j;
+
+    for (i = 1; i < count; i++) {
+        const uint8_t idx = ref_pic_set[i];
+        const int32_t poc = pic_info->PicOrderCntVal[idx];
+        for (j = i; j > 0; j--) {
+            const int32_t prev_poc = pic_info->PicOrderCntVal[ref_pic_set[j - 1]];
+            if (descending ? prev_poc >= poc : prev_poc <= poc)
+                break;
+            ref_pic_set[j] = ref_pic_set[j - 1];
+        }
+        ref_pic_set[j] = idx;
+    }
+}
 
+// Translate VAPictureParameterBufferHEVC
 static int
-translate_buffer(
+translate_VAPictureParameterBufferHEVC(
     vdpau_driver_data_t *driver_data,
     object_context_p    obj_context,
     object_buffer_p     obj_buffer
 )
 {
-    static const translate_buffer_info_t translate_info[] = {
-#define _(CODEC, TYPE)                                  \
-        { VDP_CODEC_##CODEC, VA##TYPE##BufferType,      \
-          translate_VA##TYPE##Buffer##CODEC }
-        _(MPEG2, PictureParameter),
-        _(MPEG2, IQMatrix),
-        _(MPEG2, SliceParameter),
-#if USE_VDPAU_MPEG4
-        _(MPEG4, PictureParameter),
-        _(MPEG4, IQMatrix),
-        _(MPEG4, SliceParameter),
-#endif
-        _(H264, PictureParameter),
-        _(H264, IQMatrix),
-        _(H264, SliceParameter),
-        _(VC1, PictureParameter),
-        _(VC1, SliceParameter),
-#undef _
-        { VDP_CODEC_VC1, VABitPlaneBufferType, translate_nothing },
-        { 0, VASliceDataBufferType, translate_VASliceDataBuffer },
-        { 0, 0, NULL }
-    };
-    const translate_buffer_info_t *tbip;
-    for (tbip = translate_info; tbip->func != NULL; tbip++) {
-        if (tbip->codec && tbip->codec != obj_context->vdp_codec)
-            continue;
-        if (tbip->type != obj_buffer->type)
+    VdpPictureInfoHEVC * const pic_info = &obj_context->picture_slot->vdp_picture_info.hevc;
+    VAPictureParameterBufferHEVC * const pic_param = obj_buffer->buffer_data;
+    unsigned int i, n;
+
+    /* Sequence parameters */
+    pic_info->chroma_format_idc                 = pic_param->pic_fields.bits.chroma_format_idc;
+    pic_info->separate_colour_plane_flag        = pic_param->pic_fields.bits.separate_colour_plane_flag;
+    pic_info->pic_width_in_luma_samples         = pic_param->pic_width_in_luma_samples;
+    pic_info->pic_height_in_luma_samples        = pic_param->pic_height_in_luma_samples;
+    pic_info->bit_depth_luma_minus8             = pic_param->bit_depth_luma_minus8;
+    pic_info->bit_depth_chroma_minus8           = pic_param->bit_depth_chroma_minus8;
+    pic_info->log2_max_pic_order_cnt_lsb_minus4 = pic_param->log2_max_pic_order_cnt_lsb_minus4;
+    pic_info->sps_max_dec_pic_buffering_minus1  = pic_param->sps_max_dec_pic_buffering_minus1;
+    pic_info->log2_min_luma_coding_block_size_minus3 = pic_param->log2_min_luma_coding_block_size_minus3;
+    pic_info->log2_diff_max_min_luma_coding_block_size = pic_param->log2_diff_max_min_luma_coding_block_size;
+    pic_info->log2_min_transform_block_size_minus2 = pic_param->log2_min_transform_block_size_minus2;
+    pic_info->log2_diff_max_min_transform_block_size = pic_param->log2_diff_max_min_transform_block_size;
+    pic_info->max_transform_hierarchy_depth_inter = pic_param->max_transform_hierarchy_depth_inter;
+    pic_info->max_transform_hierarchy_depth_intra = pic_param->max_transform_hierarchy_depth_intra;
+    pic_info->scaling_list_enabled_flag         = pic_param->pic_fields.bits.scaling_list_enabled_flag;
+    pic_info->amp_enabled_flag                  = pic_param->pic_fields.bits.amp_enabled_flag;
+    pic_info->sample_adaptive_offset_enabled_flag = pic_param->slice_parsing_fields.bits.sample_adaptive_offset_enabled_flag;
+    pic_info->pcm_enabled_flag                  = pic_param->pic_fields.bits.pcm_enabled_flag;
+    pic_info->pcm_sample_bit_depth_luma_minus1  = pic_param->pcm_sample_bit_depth_luma_minus1;
+    pic_info->pcm_sample_bit_depth_chroma_minus1 = pic_param->pcm_sample_bit_depth_chroma_minus1;
+    pic_info->log2_min_pcm_luma_coding_block_size_minus3 = pic_param->log2_min_pcm_luma_coding_block_size_minus3;
+    pic_info->log2_diff_max_min_pcm_luma_coding_block_size = pic_param->log2_diff_max_min_pcm_luma_coding_block_size;
+    pic_info->pcm_loop_filter_disabled_flag     = pic_param->pic_fields.bits.pcm_loop_filter_disabled_flag;
+    pic_info->num_short_term_ref_pic_sets       = pic_param->num_short_term_ref_pic_sets;
+    pic_info->long_term_ref_pics_present_flag   = pic_param->slice_parsing_fields.bits.long_term_ref_pics_present_flag;
+    pic_info->num_long_term_ref_pics_sps        = pic_param->num_long_term_ref_pic_sps;
+    pic_info->sps_temporal_mvp_enabled_flag     = pic_param->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag;
+    pic_info->strong_intra_smoothing_enabled_flag = pic_param->pic_fields.bits.strong_intra_smoothing_enabled_flag;
+
+    /* Picture parameters */
+    pic_info->dependent_slice_segments_enabled_flag = pic_param->slice_parsing_fields.bits.dependent_slice_segments_enabled_flag;
+    pic_info->output_flag_present_flag          = pic_param->slice_parsing_fields.bits.output_flag_present_flag;
+    pic_info->num_extra_slice_header_bits       = pic_param->num_extra_slice_header_bits;
+    pic_info->sign_data_hiding_enabled_flag     = pic_param->pic_fields.bits.sign_data_hiding_enabled_flag;
+    pic_info->cabac_init_present_flag           = pic_param->slice_parsing_fields.bits.cabac_init_present_flag;
+    pic_info->num_ref_idx_l0_default_active_minus1 = pic_param->num_ref_idx_l0_default_active_minus1;
+    pic_info->num_ref_idx_l1_default_active_minus1 = pic_param->num_ref_idx_l1_default_active_minus1;
+    pic_info->init_qp_minus26                   = pic_param->init_qp_minus26;
+    pic_info->constrained_intra_pred_flag       = pic_param->pic_fields.bits.constrained_intra_pred_flag;
+    pic_info->transform_skip_enabled_flag       = pic_param->pic_fields.bits.transform_skip_enabled_flag;
+    pic_info->cu_qp_delta_enabled_flag          = pic_param->pic_fields.bits.cu_qp_delta_enabled_flag;
+    pic_info->diff_cu_qp_delta_depth            = pic_param->diff_cu_qp_delta_depth;
+    pic_info->pps_cb_qp_offset                  = pic_param->pps_cb_qp_offset;
+    pic_info->pps_cr_qp_offset                  = pic_param->pps_cr_qp_offset;
+    pic_info->pps_slice_chroma_qp_offsets_present_flag = pic_param->slice_parsing_fields.bits.pps_slice_chroma_qp_offsets_present_flag;
+    pic_info->weighted_pred_flag                = pic_param->pic_fields.bits.weighted_pred_flag;
+    pic_info->weighted_bipred_flag              = pic_param->pic_fields.bits.weighted_bipred_flag;
+    pic_info->transquant_bypass_enabled_flag    = pic_param->pic_fields.bits.transquant_bypass_enabled_flag;
+    pic_info->tiles_enabled_flag                = pic_param->pic_fields.bits.tiles_enabled_flag;
+    pic_info->entropy_coding_sync_enabled_flag  = pic_param->pic_fields.bits.entropy_coding_sync_enabled_flag;
+    pic_info->num_tile_columns_minus1           = pic_param->num_tile_columns_minus1;
+    pic_info->num_tile_rows_minus1              = pic_param->num_tile_rows_minus1;
+
+    /* VA-API always provides explicit tile sizes */
+    pic_info->uniform_spacing_flag              = 0;
+    memset(pic_info->column_width_minus1, 0, sizeof(pic_info->column_width_minus1));
+    memset(pic_info->row_height_minus1, 0, sizeof(pic_info->row_height_minus1));
+    for (i = 0; i <= pic_param->num_tile_columns_minus1 &&
+             i < ARRAY_ELEMS(pic_param->column_width_minus1); i++)
+        pic_info->column_width_minus1[i] = pic_param->column_width_minus1[i];
+    for (i = 0; i <= pic_param->num_tile_rows_minus1 &&
+             i < ARRAY_ELEMS(pic_param->row_height_minus1); i++)
+        pic_info->row_height_minus1[i] = pic_param->row_height_minus1[i];
+
+    pic_info->loop_filter_across_tiles_enabled_flag = pic_param->pic_fields.bits.loop_filter_across_tiles_enabled_flag;
+    pic_info->pps_loop_filter_across_slices_enabled_flag = pic_param->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag;
+    pic_info->deblocking_filter_override_enabled_flag = pic_param->slice_parsing_fields.bits.deblocking_filter_override_enabled_flag;
+    pic_info->pps_deblocking_filter_disabled_flag = pic_param->slice_parsing_fields.bits.pps_disable_deblocking_filter_flag;
+    pic_info->pps_beta_offset_div2              = pic_param->pps_beta_offset_div2;
+    pic_info->pps_tc_offset_div2                = pic_param->pps_tc_offset_div2;
+    /* XXX: VA-API does not expose the flag, infer it from what it gates */
+    pic_info->deblocking_filter_control_present_flag = (
+        pic_info->deblocking_filter_override_enabled_flag ||
+        pic_info->pps_deblocking_filter_disabled_flag ||
+        pic_info->pps_beta_offset_div2 != 0 ||
+        pic_info->pps_tc_offset_div2 != 0);
+    pic_info->lists_modification_present_flag   = pic_param->slice_parsing_fields.bits.lists_modification_present_flag;
+    pic_info->log2_parallel_merge_level_minus2  = pic_param->log2_parallel_merge_level_minus2;
+    pic_info->slice_segment_header_extension_present_flag = pic_param->slice_parsing_fields.bits.slice_segment_header_extension_present_flag;
+
+    /* Flat scaling lists, unless a VAIQMatrixBuffer follows */
+    if (!pic_info->scaling_list_enabled_flag) {
+        memset(pic_info->ScalingList4x4, 16, sizeof(pic_info->ScalingList4x4));
+        memset(pic_info->ScalingList8x8, 16, sizeof(pic_info->ScalingList8x8));
+        memset(pic_info->ScalingList16x16, 16, sizeof(pic_info->ScalingList16x16));
+        memset(pic_info->ScalingList32x32, 16, sizeof(pic_info->ScalingList32x32));
+        memset(pic_info->ScalingListDCCoeff16x16, 16, sizeof(pic_info->ScalingListDCCoeff16x16));
+        memset(pic_info->ScalingListDCCoeff32x32, 16, sizeof(pic_info->ScalingListDCCoeff32x32));
+        obj_context->translated_buffers[VDPAU_TRANSLATED_IQ_MATRIX].size = 0;
+    }
+
+    /* Current picture */
+    pic_info->IDRPicFlag                        = pic_param->slice_parsing_fields.bits.IdrPicFlag;
+    pic_info->RAPPicFlag                        = pic_param->slice_parsing_fields.bits.RapPicFlag;
+    pic_info->CurrPicOrderCntVal                = pic_param->CurrPic.pic_order_cnt;
+    pic_info->NumShortTermPictureSliceHeaderBits = pic_param->st_rps_bits;
+    /* XXX: VA-API does not expose these slice header derived values */
+    pic_info->CurrRpsIdx                        = 0;
+    pic_info->NumDeltaPocsOfRefRpsIdx           = 0;
+    pic_info->NumLongTermPictureSliceHeaderBits = 0;
+
+    /* Reference pictures */
+    pic_info->NumPocStCurrBefore                = 0;
+    pic_info->NumPocStCurrAfter                 = 0;
+    pic_info->NumPocLtCurr                      = 0;
+    for (i = 0, n = 0; i < ARRAY_ELEMS(pic_param->ReferenceFrames); i++) {
+        const VAPictureHEVC * const va_pic = &pic_param->ReferenceFrames[i];
+        if (va_pic->picture_id == VA_INVALID_SURFACE ||
+            (va_pic->flags & VA_PICTURE_HEVC_INVALID))
             continue;
-        return tbip->func(driver_data, obj_context, obj_buffer);
+        if (!translate_VASurfaceID(driver_data, obj_context,
+                                   va_pic->picture_id, &pic_info->RefPics[n]))
+            return 0;
+        pic_info->PicOrderCntVal[n] = va_pic->pic_order_cnt;
+        pic_info->IsLongTerm[n] =
+            (va_pic->flags & VA_PICTURE_HEVC_LONG_TERM_REFERENCE) != 0;
+
+        if ((va_pic->flags & VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE) &&
+            pic_info->NumPocStCurrBefore < ARRAY_ELEMS(pic_info->RefPicSetStCurrBefore))
+            pic_info->RefPicSetStCurrBefore[pic_info->NumPocStCurrBefore++] = n;
+        else if ((va_pic->flags & VA_PICTURE_HEVC_RPS_ST_CURR_AFTER) &&
+                 pic_info->NumPocStCurrAfter < ARRAY_ELEMS(pic_info->RefPicSetStCurrAfter))
+            pic_info->RefPicSetStCurrAfter[pic_info->NumPocStCurrAfter++] = n;
+        else if ((va_pic->flags & VA_PICTURE_HEVC_RPS_LT_CURR) &&
+                 pic_info->NumPocLtCurr < ARRAY_ELEMS(pic_info->RefPicSetLtCurr))
+            pic_info->RefPicSetLtCurr[pic_info->NumPocLtCurr++] = n;
+        n++;
     }
-    D(bug("ERROR: no translate function found for %s%s\n",
-          string_of_VABufferType(obj_buffer->type),
-          obj_context->vdp_codec ? string_of_VdpCodec(obj_context->vdp_codec) : NULL));
-    return 0;
+    for (; n < ARRAY_ELEMS(pic_info->RefPics); n++) {
+        pic_info->RefPics[n]        = VDP_INVALID_HANDLE;
+        pic_info->PicOrderCntVal[n] = 0;
+        pic_info->IsLongTerm[n]     = 0;
+    }
+
+    /* VA-API only flags the sets, restore their order: closest first */
+    sort_ref_pic_set_HEVC(pic_info, pic_info->RefPicSetStCurrBefore,
+                          pic_info->NumPocStCurrBefore, 1);
+    sort_ref_pic_set_HEVC(pic_info, pic_info->RefPicSetStCurrAfter,
+                          pic_info->NumPocStCurrAfter, 0);
+    pic_info->NumPocTotalCurr = (pic_info->NumPocStCurrBefore +
+                                 pic_info->NumPocStCurrAfter +
+                                 pic_info->NumPocLtCurr);
+    return 1;
 }
 
-// vaQueryConfigProfiles
-VAStatus
-vdpau_QueryConfigProfiles(
-    VADriverContextP    ctx,
-    VAProfile          *profile_list,
-    int                *num_profiles
+// Translate VAIQMatrixBufferHEVC
+static int
+translate_VAIQMatrixBufferHEVC(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
 )
 {
-    VDPAU_DRIVER_DATA_INIT;
-
-    static const VAProfile va_profiles[] = {
-        VAProfileMPEG2Simple,
-        VAProfileMPEG2Main,
-        VAProfileMPEG4Simple,
-        VAProfileMPEG4AdvancedSimple,
-        VAProfileMPEG4Main,
-        VAProfileH264Baseline,
-        VAProfileH264Main,
-        VAProfileH264High,
-        VAProfileVC1Simple,
-        VAProfileVC1Main,
-        VAProfileVC1Advanced
-    };
+    VdpPictureInfoHEVC * const pic_info = &obj_context->picture_slot->vdp_picture_info.hevc;
+    VAIQMatrixBufferHEVC * const iq_matrix = obj_buffer->buffer_data;
+    int i, j;
 
-    int i, n = 0;
-    for (i = 0; i < ARRAY_ELEMS(va_profiles); i++) {
-        VAProfile profile = va_profiles[i];
-        VdpDecoderProfile vdp_profile = get_VdpDecoderProfile(profile);
-        if (is_supported_profile(driver_data, vdp_profile))
-            profile_list[n++] = profile;
+    /* VA-API lists are in raster order, VDPAU wants the diagonal scan */
+    for (j = 0; j < 6; j++) {
+        for (i = 0; i < 16; i++)
+            pic_info->ScalingList4x4[j][i] =
+                iq_matrix->ScalingList4x4[j][hevc_diag_scan_4x4[i]];
+        for (i = 0; i < 64; i++) {
+            pic_info->ScalingList8x8[j][i] =
+                iq_matrix->ScalingList8x8[j][hevc_diag_scan_8x8[i]];
+            pic_info->ScalingList16x16[j][i] =
+                iq_matrix->ScalingList16x16[j][hevc_diag_scan_8x8[i]];
+        }
+        pic_info->ScalingListDCCoeff16x16[j] = iq_matrix->ScalingListDC16x16[j];
     }
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < 64; i++)
+            pic_info->ScalingList32x32[j][i] =
+                iq_matrix->ScalingList32x32[j][hevc_diag_scan_8x8[i]];
+        pic_info->ScalingListDCCoeff32x32[j] = iq_matrix->ScalingListDC32x32[j];
+    }
+    return 1;
+}
 
-    /* If the assert fails then VDPAU_MAX_PROFILES needs to be bigger */
-    ASSERT(n <= VDPAU_MAX_PROFILES);
-    if (num_profiles)
-        *num_profiles = n;
-
-    return VA_STATUS_SUCCESS;
+// Translate VASliceParameterBufferHEVC
+static int
+translate_VASliceParameterBufferHEVC(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    /* Slice headers are parsed by VDPAU from the slice data */
+    obj_context->last_slice_params       = obj_buffer->buffer_data;
+    obj_context->last_slice_params_count = obj_buffer->num_elements;
+    return 1;
 }
+#endif
 
-// vaQueryConfigEntrypoints
-VAStatus
-vdpau_QueryConfigEntrypoints(
-    VADriverContextP    ctx,
-    VAProfile           profile,
-    VAEntrypoint       *entrypoint_list,
-    int                *num_entrypoints
+#if USE_VDPAU_VP9
+// Translate VADecPictureParameterBufferVP9
+static int
+translate_VAPictureParameterBufferVP9(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
 )
 {
-    VDPAU_DRIVER_DATA_INIT;
+    VdpPictureInfoVP9 * const pic_info = &obj_context->picture_slot->vdp_picture_info.vp9;
+    VADecPictureParameterBufferVP9 * const pic_param = obj_buffer->buffer_data;
+    const unsigned int ref_idx[3] = {
+        pic_param->pic_fields.bits.last_ref_frame,
+        pic_param->pic_fields.bits.golden_ref_frame,
+        pic_param->pic_fields.bits.alt_ref_frame
+    };
+    VdpVideoSurface * const ref_surfaces[3] = {
+        &pic_info->lastReference,
+        &pic_info->goldenReference,
+        &pic_info->altReference
+    };
+    unsigned int i;
 
-    VdpDecoderProfile vdp_profile = get_VdpDecoderProfile(profile);
-    if (!is_supported_profile(driver_data, vdp_profile))
-        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    pic_info->width                     = pic_param->frame_width;
+    pic_info->height                    = pic_param->frame_height;
+    pic_info->profile                   = pic_param->profile;
+    pic_info->frameContextIdx           = pic_param->pic_fields.bits.frame_context_idx;
+    pic_info->keyFrame                  = pic_param->pic_fields.bits.frame_type == 0;
+    pic_info->showFrame                 = pic_param->pic_fields.bits.show_frame;
+    pic_info->errorResilient            = pic_param->pic_fields.bits.error_resilient_mode;
+    pic_info->frameParallelDecoding     = pic_param->pic_fields.bits.frame_parallel_decoding_mode;
+    pic_info->subSamplingX              = pic_param->pic_fields.bits.subsampling_x;
+    pic_info->subSamplingY              = pic_param->pic_fields.bits.subsampling_y;
+    pic_info->intraOnly                 = pic_param->pic_fields.bits.intra_only;
+    pic_info->allowHighPrecisionMv      = !pic_info->keyFrame && pic_param->pic_fields.bits.allow_high_precision_mv;
+    pic_info->refreshEntropyProbs       = pic_param->pic_fields.bits.refresh_frame_context;
+    pic_info->resetFrameContext         = pic_param->pic_fields.bits.reset_frame_context;
+    pic_info->mcompFilterType           = pic_param->pic_fields.bits.mcomp_filter_type;
+    pic_info->bitDepthMinus8Luma        = pic_param->bit_depth > 8 ? pic_param->bit_depth - 8 : 0;
+    pic_info->bitDepthMinus8Chroma      = pic_info->bitDepthMinus8Luma;
+    pic_info->loopFilterLevel           = pic_param->filter_level;
+    pic_info->loopFilterSharpness       = pic_param->sharpness_level;
+    pic_info->log2TileColumns           = pic_param->log2_tile_columns;
+    pic_info->log2TileRows              = pic_param->log2_tile_rows;
+    pic_info->segmentEnabled            = pic_param->pic_fields.bits.segmentation_enabled;
+    pic_info->segmentMapUpdate          = pic_param->pic_fields.bits.segmentation_update_map;
+    pic_info->segmentMapTemporalUpdate  = pic_param->pic_fields.bits.segmentation_temporal_update;
+    pic_info->uncompressedHeaderSize    = pic_param->frame_header_length_in_bytes;
+    pic_info->compressedHeaderSize      = pic_param->first_partition_size;
+
+    for (i = 0; i < ARRAY_ELEMS(pic_info->mbSegmentTreeProbs); i++)
+        pic_info->mbSegmentTreeProbs[i] = pic_param->mb_segment_tree_probs[i];
+    for (i = 0; i < ARRAY_ELEMS(pic_info->segmentPredProbs); i++)
+        pic_info->segmentPredProbs[i] = pic_param->segment_pred_probs[i];
+
+    pic_info->refFrameSignBias[0]       = 0;
+    pic_info->refFrameSignBias[1]       = pic_param->pic_fields.bits.last_ref_frame_sign_bias;
+    pic_info->refFrameSignBias[2]       = pic_param->pic_fields.bits.golden_ref_frame_sign_bias;
+    pic_info->refFrameSignBias[3]       = pic_param->pic_fields.bits.alt_ref_frame_sign_bias;
+
+    for (i = 0; i < 3; i++) {
+        pic_info->activeRefIdx[i] = ref_idx[i];
+        if (pic_info->keyFrame || pic_info->intraOnly)
+            *ref_surfaces[i] = VDP_INVALID_HANDLE;
+        else if (!translate_VASurfaceID(driver_data, obj_context,
+                                        pic_param->reference_frames[ref_idx[i]],
+                                        ref_surfaces[i]))
+            return 0;
+    }
+    return 1;
+}
 
-    VAEntrypoint entrypoint;
-    switch (profile) {
-    case VAProfileMPEG2Simple:
-    case VAProfileMPEG2Main:
-        entrypoint = VAEntrypointVLD;
-        break;
-    case VAProfileMPEG4Simple:
-    case VAProfileMPEG4AdvancedSimple:
-    case VAProfileMPEG4Main:
-        entrypoint = VAEntrypointVLD;
-        break;
-    case VAProfileH264Baseline:
-    case VAProfileH264Main:
-    case VAProfileH264High:
-        entrypoint = VAEntrypointVLD;
-        break;
-    case VAProfileVC1Simple:
-    case VAProfileVC1Main:
-    case VAProfileVC1Advanced:
-        entrypoint = VAEntrypointVLD;
-        break;
-    default:
-        entrypoint = 0;
-        break;
+// Translate VASliceParameterBufferVP9
+static int
+translate_VASliceParameterBufferVP9(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    /* The per-segment values are derived from the frame header instead */
+    obj_context->last_slice_params       = obj_buffer->buffer_data;
+    obj_context->last_slice_params_count = obj_buffer->num_elements;
+    return 1;
+}
+
+/*
+ * VP9 uncompressed header
+ *
+ * VA-API only conveys the quantizer, loop filter and segmentation
+ * parameters as per-segment derived values, whereas VDPAU wants the
+ * syntax elements. The latter are parsed from the uncompressed header,
+ * which VA-API passes along with the frame data. Loop filter deltas and
+ * segmentation features persist across frames, so they are kept in the
+ * context VdpPictureInfoVP9.
+ */
+typedef struct {
+    const uint8_t *buf;
+    unsigned int   size_in_bits;
+    unsigned int   index;
+} vp9_bit_reader_t;
+
+static unsigned int
+vp9_read_bits(vp9_bit_reader_t *br, unsigned int n)
+{
+    unsigned int v = 0;
+
+    while (n-- > 0) {
+        unsigned int bit = 0;
+        if (br->index < br->size_in_bits)
+            bit = (br->buf[br->index >> 3] >> (7 - (br->index & 7))) & 1;
+        br->index++;
+        v = (v << 1) | bit;
     }
+    return v;
+}
 
-    if (entrypoint_list)
-        *entrypoint_list = entrypoint;
+static int
+vp9_read_signed(vp9_bit_reader_t *br, unsigned int n)
+{
+    const int v = vp9_read_bits(br, n);
+    return vp9_read_bits(br, 1) ? -v : v;
+}
 
-    if (num_entrypoints)
-        *num_entrypoints = entrypoint != 0;
+static int
+vp9_read_delta_q(vp9_bit_reader_t *br)
+{
+    return vp9_read_bits(br, 1) ? vp9_read_signed(br, 4) : 0;
+}
 
-    return VA_STATUS_SUCCESS;
+// Reset the VP9 state that is not carried over intra and error resilient frames
+static void
+vp9_setup_past_independence(VdpPictureInfoVP9 *pic_info)
+{
+    memset(pic_info->segmentFeatureEnable, 0, sizeof(pic_info->segmentFeatureEnable));
+    memset(pic_info->segmentFeatureData, 0, sizeof(pic_info->segmentFeatureData));
+    pic_info->segmentFeatureMode        = 0;
+    pic_info->mbRefLfDelta[0]           = 1;
+    pic_info->mbRefLfDelta[1]           = 0;
+    pic_info->mbRefLfDelta[2]           = -1;
+    pic_info->mbRefLfDelta[3]           = -1;
+    pic_info->mbModeLfDelta[0]          = 0;
+    pic_info->mbModeLfDelta[1]          = 0;
 }
 
-// vaBeginPicture
-VAStatus
-vdpau_BeginPicture(
-    VADriverContextP    ctx,
-    VAContextID         context,
-    VASurfaceID         render_target
+static void
+vp9_parse_color_config(
+    vp9_bit_reader_t  *br,
+    VdpPictureInfoVP9 *pic_info,
+    unsigned int       profile
 )
 {
-    VDPAU_DRIVER_DATA_INIT;
+    if (profile >= 2)
+        vp9_read_bits(br, 1);                   /* ten_or_twelve_bit */
+    pic_info->colorSpace = vp9_read_bits(br, 3);
+    if (pic_info->colorSpace != 7) {            /* CS_RGB */
+        vp9_read_bits(br, 1);                   /* color_range */
+        if (profile == 1 || profile == 3)
+            vp9_read_bits(br, 3);               /* subsampling_x/y, reserved */
+    }
+    else if (profile == 1 || profile == 3)
+        vp9_read_bits(br, 1);                   /* reserved_zero */
+}
 
-    object_context_p obj_context = VDPAU_CONTEXT(context);
-    if (!obj_context)
-        return VA_STATUS_ERROR_INVALID_CONTEXT;
+static void
+vp9_skip_frame_size(vp9_bit_reader_t *br)
+{
+    vp9_read_bits(br, 32);                      /* frame_{width,height}_minus_1 */
+}
 
-    object_surface_p obj_surface = VDPAU_SURFACE(render_target);
-    if (!obj_surface)
-        return VA_STATUS_ERROR_INVALID_SURFACE;
+static void
+vp9_skip_render_size(vp9_bit_reader_t *br)
+{
+    if (vp9_read_bits(br, 1))                   /* render_and_frame_size_different */
+        vp9_read_bits(br, 32);
+}
 
-    obj_surface->va_surface_status           = VASurfaceRendering;
-    obj_context->last_pic_param              = NULL;
-    obj_context->last_slice_params           = NULL;
-    obj_context->last_slice_params_count     = 0;
-    obj_context->current_render_target       = obj_surface->base.id;
-    obj_context->gen_slice_data_size         = 0;
-    obj_context->vdp_bitstream_buffers_count = 0;
+// Parse the VP9 uncompressed header up to the segmentation parameters
+static int
+vp9_parse_uncompressed_header(
+    VdpPictureInfoVP9 *pic_info,
+    const uint8_t     *buf,
+    unsigned int       buf_size
+)
+{
+    static const uint8_t feature_bits[4]   = { 8, 6, 2, 0 };
+    static const uint8_t feature_signed[4] = { 1, 1, 0, 0 };
+    vp9_bit_reader_t br = { buf, 8 * buf_size, 0 };
+    unsigned int i, j, profile, key_frame, show_frame, error_res, intra_only;
+
+    if (vp9_read_bits(&br, 2) != 2)             /* frame_marker */
+        return 0;
+    profile  = vp9_read_bits(&br, 1);
+    profile |= vp9_read_bits(&br, 1) << 1;
+    if (profile == 3)
+        vp9_read_bits(&br, 1);                  /* reserved_zero */
+    if (vp9_read_bits(&br, 1))                  /* show_existing_frame */
+        return 0;
+
+    key_frame  = vp9_read_bits(&br, 1) == 0;
+    show_frame = vp9_read_bits(&br, 1);
+    error_res  = vp9_read_bits(&br, 1);
+    intra_only = 0;
+
+    if (key_frame) {
+        vp9_read_bits(&br, 24);                 /* frame_sync_code */
+        vp9_parse_color_config(&br, pic_info, profile);
+        vp9_skip_frame_size(&br);
+        vp9_skip_render_size(&br);
+    }
+    else {
+        if (!show_frame)
+            intra_only = vp9_read_bits(&br, 1);
+        if (!error_res)
+            vp9_read_bits(&br, 2);              /* reset_frame_context */
+        if (intra_only) {
+            vp9_read_bits(&br, 24);             /* frame_sync_code */
+            if (profile > 0)
+                vp9_parse_color_config(&br, pic_info, profile);
+            else
+                pic_info->colorSpace = 1;       /* CS_BT_601 */
+            vp9_read_bits(&br, 8);              /* refresh_frame_flags */
+            vp9_skip_frame_size(&br);
+            vp9_skip_render_size(&br);
+        }
+        else {
+            vp9_read_bits(&br, 8);              /* refresh_frame_flags */
+            vp9_read_bits(&br, 3 * 4);          /* ref_frame_idx, sign_bias */
+            for (i = 0; i < 3; i++) {
+                if (vp9_read_bits(&br, 1))      /* found_ref */
+                    break;
+            }
+            if (i == 3)
+                vp9_skip_frame_size(&br);
+            vp9_skip_render_size(&br);
+            vp9_read_bits(&br, 1);              /* allow_high_precision_mv */
+            if (!vp9_read_bits(&br, 1))         /* is_filter_switchable */
+                vp9_read_bits(&br, 2);          /* raw_interpolation_filter */
+        }
+    }
+    if (!error_res)
+        vp9_read_bits(&br, 2);                  /* refresh_frame_context, parallel */
+    vp9_read_bits(&br, 2);                      /* frame_context_idx */
+
+    if (key_frame || intra_only || error_res)
+        vp9_setup_past_independence(pic_info);
+
+    /* loop_filter_params() */
+    vp9_read_bits(&br, 6 + 3);                  /* level, sharpness */
+    pic_info->modeRefLfEnabled = vp9_read_bits(&br, 1);
+    if (pic_info->modeRefLfEnabled && vp9_read_bits(&br, 1)) {
+        for (i = 0; i < ARRAY_ELEMS(pic_info->mbRefLfDelta); i++) {
+            if (vp9_read_bits(&br, 1))
+                pic_info->mbRefLfDelta[i] = vp9_read_signed(&br, 6);
+        }
+        for (i = 0; i < ARRAY_ELEMS(pic_info->mbModeLfDelta); i++) {
+            if (vp9_read_bits(&br, 1))
+                pic_info->mbModeLfDelta[i] = vp9_read_signed(&br, 6);
+        }
+    }
+
+    /* quantization_params() */
+    pic_info->qpYAc  = vp9_read_bits(&br, 8);   /* base_q_idx */
+    pic_info->qpYDc  = vp9_read_delta_q(&br);
+    pic_info->qpChDc = vp9_read_delta_q(&br);
+    pic_info->qpChAc = vp9_read_delta_q(&br);
+
+    /* segmentation_params() */
+    if (vp9_read_bits(&br, 1)) {                /* segmentation_enabled */
+        if (vp9_read_bits(&br, 1)) {            /* update_map */
+            for (i = 0; i < 7; i++) {
+                if (vp9_read_bits(&br, 1))
+                    vp9_read_bits(&br, 8);
+            }
+            if (vp9_read_bits(&br, 1)) {        /* temporal_update */
+                for (i = 0; i < 3; i++) {
+                    if (vp9_read_bits(&br, 1))
+                        vp9_read_bits(&br, 8);
+                }
+            }
+        }
+        if (vp9_read_bits(&br, 1)) {            /* update_data */
+            pic_info->segmentFeatureMode = vp9_read_bits(&br, 1);
+            for (i = 0; i < 8; i++) {
+                for (j = 0; j < 4; j++) {
+                    int value = 0;
+                    pic_info->segmentFeatureEnable[i][j] = vp9_read_bits(&br, 1);
+                    if (pic_info->segmentFeatureEnable[i][j]) {
+                        value = vp9_read_bits(&br, feature_bits[j]);
+                        if (feature_signed[j] && vp9_read_bits(&br, 1))
+                            value = -value;
+                    }
+                    pic_info->segmentFeatureData[i][j] = value;
+                }
+            }
+        }
+    }
+    return br.index <= br.size_in_bits;
+}
+
+// Translate VASliceDataBuffer for VP9
+static int
+translate_VASliceDataBufferVP9(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    static const uint8_t start_code_prefix[3] = { 0x00, 0x00, 0x01 };
+    VdpPictureInfoVP9 * const pic_info = &obj_context->picture_slot->vdp_picture_info.vp9;
+    VASliceParameterBufferVP9 * const slice_params = obj_context->last_slice_params;
+    unsigned int i;
+
+    /* XXX: this assumes we get SliceParams before SliceData */
+    for (i = 0; i < obj_context->last_slice_params_count; i++) {
+        VASliceParameterBufferVP9 * const slice_param = &slice_params[i];
+        uint8_t * const buf = (uint8_t *)obj_buffer->buffer_data + slice_param->slice_data_offset;
+
+        if (i == 0 && !vp9_parse_uncompressed_header(pic_info, buf,
+                                                     slice_param->slice_data_size))
+            return 0;
+        if (append_VdpBitstreamBuffer(obj_context,
+                                      start_code_prefix,
+                                      sizeof(start_code_prefix)) < 0)
+            return 0;
+        if (append_VdpBitstreamBuffer(obj_context,
+                                      buf,
+                                      slice_param->slice_data_size) < 0)
+            return 0;
+    }
+    return 1;
+}
+#endif
+
+#if USE_VDPAU_AV1
+// Returns the signed distance between two AV1 order hints (7.12.2)
+static int
+av1_get_relative_dist(
+    const VADecPictureParameterBufferAV1 *pic_param,
+    unsigned int                          a,
+    unsigned int                          b
+)
+{
+    int diff, m;
+
+    if (!pic_param->seq_info_fields.fields.enable_order_hint)
+        return 0;
+    diff = a - b;
+    m    = 1 << pic_param->order_hint_bits_minus_1;
+    return (diff & (m - 1)) - (diff & m);
+}
+
+// Compute SkipModeFrame[] from the reference order hints (5.9.22)
+static void
+av1_get_skip_mode_frames(
+    const VADecPictureParameterBufferAV1 *pic_param,
+    const unsigned int                    ref_order_hint[7],
+    VdpPictureInfoAV1                    *pic_info
+)
+{
+    const unsigned int order_hint = pic_param->order_hint;
+    int i, forward_idx = -1, backward_idx = -1, second_forward_idx = -1;
+    unsigned int forward_hint = 0, backward_hint = 0, second_forward_hint = 0;
+
+    pic_info->SkipModeFrame0 = 0;
+    pic_info->SkipModeFrame1 = 0;
+    if (!pic_param->mode_control_fields.bits.skip_mode_present)
+        return;
+
+    for (i = 0; i < 7; i++) {
+        const unsigned int ref_hint = ref_order_hint[i];
+        const int dist = av1_get_relative_dist(pic_param, ref_hint, order_hint);
+        if (dist < 0) {
+            if (forward_idx < 0 ||
+                av1_get_relative_dist(pic_param, ref_hint, forward_hint) > 0) {
+                forward_idx  = i;
+                forward_hint = ref_hint;
+            }
+        }
+        else if (dist > 0) {
+            if (backward_idx < 0 ||
+                av1_get_relative_dist(pic_param, ref_hint, backward_hint) < 0) {
+                backward_idx  = i;
+                backward_hint = ref_hint;
+            }
+        }
+    }
+    if (forward_idx < 0)
+        return;
+
+    if (backward_idx < 0) {
+        for (i = 0; i < 7; i++) {
+            const unsigned int ref_hint = ref_order_hint[i];
+            if (av1_get_relative_dist(pic_param, ref_hint, forward_hint) < 0 &&
+                (second_forward_idx < 0 ||
+                 av1_get_relative_dist(pic_param, ref_hint, second_forward_hint) > 0)) {
+                second_forward_idx  = i;
+                second_forward_hint = ref_hint;
+            }
+        }
+        if (second_forward_idx < 0)
+            return;
+        backward_idx = second_forward_idx;
+    }
+
+    /* LAST_FRAME + index */
+    pic_info->SkipModeFrame0 = 1 + MIN(forward_idx, backward_idx);
+    pic_info->SkipModeFrame1 = 1 + MAX(forward_idx, backward_idx);
+}
+
+// Check whether all segments are lossless (CodedLossless)
+static int
+av1_is_coded_lossless(const VADecPictureParameterBufferAV1 *pic_param)
+{
+    const VASegmentationStructAV1 * const seg = &pic_param->seg_info;
+    const unsigned int num_segments = seg->segment_info_fields.bits.enabled ? 8 : 1;
+    unsigned int i;
+
+    if (pic_param->y_dc_delta_q || pic_param->u_dc_delta_q ||
+        pic_param->u_ac_delta_q || pic_param->v_dc_delta_q ||
+        pic_param->v_ac_delta_q)
+        return 0;
+
+    for (i = 0; i < num_segments; i++) {
+        int qindex = pic_param->base_qindex;
+        if (seg->segment_info_fields.bits.enabled && (seg->feature_mask[i] & 1))
+            qindex += seg->feature_data[i][0];  /* SEG_LVL_ALT_Q */
+        if (qindex > 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Translate VADecPictureParameterBufferAV1
+static int
+translate_VAPictureParameterBufferAV1(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    VdpPictureInfoAV1 * const pic_info = &obj_context->picture_slot->vdp_picture_info.av1;
+    VADecPictureParameterBufferAV1 * const pic_param = obj_buffer->buffer_data;
+    const VASegmentationStructAV1 * const seg = &pic_param->seg_info;
+    const VAFilmGrainStructAV1 * const fg = &pic_param->film_grain_info;
+    object_surface_p obj_surface;
+    unsigned int ref_order_hint[7];
+    unsigned int i, j;
+
+    /* Large scale tile decoding (anchor frames) is not supported */
+    if (pic_param->pic_info_fields.bits.large_scale_tile)
+        return 0;
+
+    pic_info->width                     = pic_param->frame_width_minus1 + 1;
+    pic_info->height                    = pic_param->frame_height_minus1 + 1;
+    pic_info->frame_offset              = pic_param->order_hint;
+
+    /* Sequence header */
+    pic_info->profile                   = pic_param->profile;
+    pic_info->use_128x128_superblock    = pic_param->seq_info_fields.fields.use_128x128_superblock;
+    pic_info->subsampling_x             = pic_param->seq_info_fields.fields.subsampling_x;
+    pic_info->subsampling_y             = pic_param->seq_info_fields.fields.subsampling_y;
+    pic_info->mono_chrome               = pic_param->seq_info_fields.fields.mono_chrome;
+    pic_info->bit_depth_minus8          = 2 * pic_param->bit_depth_idx;
+    pic_info->enable_filter_intra       = pic_param->seq_info_fields.fields.enable_filter_intra;
+    pic_info->enable_intra_edge_filter  = pic_param->seq_info_fields.fields.enable_intra_edge_filter;
+    pic_info->enable_interintra_compound = pic_param->seq_info_fields.fields.enable_interintra_compound;
+    pic_info->enable_masked_compound    = pic_param->seq_info_fields.fields.enable_masked_compound;
+    pic_info->enable_dual_filter        = pic_param->seq_info_fields.fields.enable_dual_filter;
+    pic_info->enable_order_hint         = pic_param->seq_info_fields.fields.enable_order_hint;
+    pic_info->order_hint_bits_minus1    = pic_param->order_hint_bits_minus_1;
+    pic_info->enable_jnt_comp           = pic_param->seq_info_fields.fields.enable_jnt_comp;
+    pic_info->enable_cdef               = pic_param->seq_info_fields.fields.enable_cdef;
+    pic_info->enable_fgs                = pic_param->seq_info_fields.fields.film_grain_params_present;
+    /* XXX: VA-API only has the frame level flags for these tools */
+    pic_info->enable_superres           = pic_param->pic_info_fields.bits.use_superres;
+    pic_info->enable_restoration        = (
+        pic_param->loop_restoration_fields.bits.yframe_restoration_type ||
+        pic_param->loop_restoration_fields.bits.cbframe_restoration_type ||
+        pic_param->loop_restoration_fields.bits.crframe_restoration_type);
+
+    /* Frame header */
+    pic_info->frame_type                = pic_param->pic_info_fields.bits.frame_type;
+    pic_info->show_frame                = pic_param->pic_info_fields.bits.show_frame;
+    pic_info->disable_cdf_update        = pic_param->pic_info_fields.bits.disable_cdf_update;
+    pic_info->allow_screen_content_tools = pic_param->pic_info_fields.bits.allow_screen_content_tools;
+    pic_info->force_integer_mv          = pic_param->pic_info_fields.bits.force_integer_mv;
+    pic_info->use_superres              = pic_param->pic_info_fields.bits.use_superres;
+    pic_info->coded_denom               = pic_info->use_superres ? pic_param->superres_scale_denominator - 9 : 0;
+    pic_info->allow_intrabc             = pic_param->pic_info_fields.bits.allow_intrabc;
+    pic_info->allow_high_precision_mv   = pic_param->pic_info_fields.bits.allow_high_precision_mv;
+    pic_info->interp_filter             = pic_param->interp_filter;
+    pic_info->switchable_motion_mode    = pic_param->pic_info_fields.bits.is_motion_mode_switchable;
+    pic_info->use_ref_frame_mvs         = pic_param->pic_info_fields.bits.use_ref_frame_mvs;
+    pic_info->disable_frame_end_update_cdf = pic_param->pic_info_fields.bits.disable_frame_end_update_cdf;
+    pic_info->allow_warped_motion       = pic_param->pic_info_fields.bits.allow_warped_motion;
+    pic_info->delta_q_present           = pic_param->mode_control_fields.bits.delta_q_present_flag;
+    pic_info->delta_q_res               = pic_param->mode_control_fields.bits.log2_delta_q_res;
+    pic_info->delta_lf_present          = pic_param->mode_control_fields.bits.delta_lf_present_flag;
+    pic_info->delta_lf_res              = pic_param->mode_control_fields.bits.log2_delta_lf_res;
+    pic_info->delta_lf_multi            = pic_param->mode_control_fields.bits.delta_lf_multi;
+    pic_info->tx_mode                   = pic_param->mode_control_fields.bits.tx_mode;
+    pic_info->reference_mode            = pic_param->mode_control_fields.bits.reference_select;
+    pic_info->reduced_tx_set            = pic_param->mode_control_fields.bits.reduced_tx_set_used;
+    pic_info->skip_mode                 = pic_param->mode_control_fields.bits.skip_mode_present;
+    pic_info->temporal_layer_id         = 0;
+    pic_info->spatial_layer_id          = 0;
+
+    /* Tiling */
+    pic_info->num_tile_cols             = pic_param->tile_cols;
+    pic_info->num_tile_rows             = pic_param->tile_rows;
+    pic_info->context_update_tile_id    = pic_param->context_update_tile_id;
+    for (i = 0; i < pic_param->tile_cols && i < ARRAY_ELEMS(pic_param->width_in_sbs_minus_1); i++)
+        pic_info->tile_widths[i] = pic_param->width_in_sbs_minus_1[i] + 1;
+    for (i = 0; i < pic_param->tile_rows && i < ARRAY_ELEMS(pic_param->height_in_sbs_minus_1); i++)
+        pic_info->tile_heights[i] = pic_param->height_in_sbs_minus_1[i] + 1;
+
+    /* Quantization */
+    pic_info->base_qindex               = pic_param->base_qindex;
+    pic_info->qp_y_dc_delta_q           = pic_param->y_dc_delta_q;
+    pic_info->qp_u_dc_delta_q           = pic_param->u_dc_delta_q;
+    pic_info->qp_v_dc_delta_q           = pic_param->v_dc_delta_q;
+    pic_info->qp_u_ac_delta_q           = pic_param->u_ac_delta_q;
+    pic_info->qp_v_ac_delta_q           = pic_param->v_ac_delta_q;
+    pic_info->using_qmatrix             = pic_param->qmatrix_fields.bits.using_qmatrix;
+    pic_info->qm_y                      = pic_param->qmatrix_fields.bits.qm_y;
+    pic_info->qm_u                      = pic_param->qmatrix_fields.bits.qm_u;
+    pic_info->qm_v                      = pic_param->qmatrix_fields.bits.qm_v;
+    pic_info->coded_lossless            = av1_is_coded_lossless(pic_param);
+
+    /* Segmentation */
+    pic_info->segmentation_enabled      = seg->segment_info_fields.bits.enabled;
+    pic_info->segmentation_update_map   = seg->segment_info_fields.bits.update_map;
+    pic_info->segmentation_update_data  = seg->segment_info_fields.bits.update_data;
+    pic_info->segmentation_temporal_update = seg->segment_info_fields.bits.temporal_update;
+    for (i = 0; i < 8; i++) {
+        pic_info->segmentation_feature_mask[i] = seg->feature_mask[i];
+        for (j = 0; j < 8; j++)
+            pic_info->segmentation_feature_data[i][j] = seg->feature_data[i][j];
+    }
+
+    /* Loop filter */
+    pic_info->loop_filter_level[0]      = pic_param->filter_level[0];
+    pic_info->loop_filter_level[1]      = pic_param->filter_level[1];
+    pic_info->loop_filter_level_u       = pic_param->filter_level_u;
+    pic_info->loop_filter_level_v       = pic_param->filter_level_v;
+    pic_info->loop_filter_sharpness     = pic_param->loop_filter_info_fields.bits.sharpness_level;
+    pic_info->loop_filter_delta_enabled = pic_param->loop_filter_info_fields.bits.mode_ref_delta_enabled;
+    pic_info->loop_filter_delta_update  = pic_param->loop_filter_info_fields.bits.mode_ref_delta_update;
+    for (i = 0; i < 8; i++)
+        pic_info->loop_filter_ref_deltas[i] = pic_param->ref_deltas[i];
+    for (i = 0; i < 2; i++)
+        pic_info->loop_filter_mode_deltas[i] = pic_param->mode_deltas[i];
+
+    /* CDEF: VA-API packs (pri << 2) | sec, VDPAU (sec << 4) | pri */
+    pic_info->cdef_damping_minus_3      = pic_param->cdef_damping_minus_3;
+    pic_info->cdef_bits                 = pic_param->cdef_bits;
+    for (i = 0; i < 8; i++) {
+        pic_info->cdef_y_strength[i]  = ((pic_param->cdef_y_strengths[i] >> 2) |
+                                         ((pic_param->cdef_y_strengths[i] & 3) << 4));
+        pic_info->cdef_uv_strength[i] = ((pic_param->cdef_uv_strengths[i] >> 2) |
+                                         ((pic_param->cdef_uv_strengths[i] & 3) << 4));
+    }
+
+    /* Loop restoration */
+    pic_info->lr_type[0]                = pic_param->loop_restoration_fields.bits.yframe_restoration_type;
+    pic_info->lr_type[1]                = pic_param->loop_restoration_fields.bits.cbframe_restoration_type;
+    pic_info->lr_type[2]                = pic_param->loop_restoration_fields.bits.crframe_restoration_type;
+    pic_info->lr_unit_size[0]           = 1 + pic_param->loop_restoration_fields.bits.lr_unit_shift;
+    pic_info->lr_unit_size[1]           = pic_info->lr_unit_size[0] - pic_param->loop_restoration_fields.bits.lr_uv_shift;
+    pic_info->lr_unit_size[2]           = pic_info->lr_unit_size[1];
+
+    /* Film grain */
+    pic_info->apply_grain               = fg->film_grain_info_fields.bits.apply_grain;
+    pic_info->overlap_flag              = fg->film_grain_info_fields.bits.overlap_flag;
+    pic_info->scaling_shift_minus8      = fg->film_grain_info_fields.bits.grain_scaling_minus_8;
+    pic_info->chroma_scaling_from_luma  = fg->film_grain_info_fields.bits.chroma_scaling_from_luma;
+    pic_info->ar_coeff_lag              = fg->film_grain_info_fields.bits.ar_coeff_lag;
+    pic_info->ar_coeff_shift_minus6     = fg->film_grain_info_fields.bits.ar_coeff_shift_minus_6;
+    pic_info->grain_scale_shift         = fg->film_grain_info_fields.bits.grain_scale_shift;
+    pic_info->clip_to_restricted_range  = fg->film_grain_info_fields.bits.clip_to_restricted_range;
+    pic_info->random_seed               = fg->grain_seed;
+    pic_info->num_y_points              = fg->num_y_points;
+    pic_info->num_cb_points             = fg->num_cb_points;
+    pic_info->num_cr_points             = fg->num_cr_points;
+    pic_info->cb_mult                   = fg->cb_mult;
+    pic_info->cb_luma_mult              = fg->cb_luma_mult;
+    pic_info->cb_offset                 = fg->cb_offset;
+    pic_info->cr_mult                   = fg->cr_mult;
+    pic_info->cr_luma_mult              = fg->cr_luma_mult;
+    pic_info->cr_offset                 = fg->cr_offset;
+    for (i = 0; i < 14; i++) {
+        pic_info->scaling_points_y[i][0] = fg->point_y_value[i];
+        pic_info->scaling_points_y[i][1] = fg->point_y_scaling[i];
+    }
+    for (i = 0; i < 10; i++) {
+        pic_info->scaling_points_cb[i][0] = fg->point_cb_value[i];
+        pic_info->scaling_points_cb[i][1] = fg->point_cb_scaling[i];
+        pic_info->scaling_points_cr[i][0] = fg->point_cr_value[i];
+        pic_info->scaling_points_cr[i][1] = fg->point_cr_scaling[i];
+    }
+    for (i = 0; i < 24; i++)
+        pic_info->ar_coeffs_y[i] = fg->ar_coeffs_y[i];
+    for (i = 0; i < 25; i++) {
+        pic_info->ar_coeffs_cb[i] = fg->ar_coeffs_cb[i];
+        pic_info->ar_coeffs_cr[i] = fg->ar_coeffs_cr[i];
+    }
+
+    /* Reference frames */
+    for (i = 0; i < 8; i++) {
+        if (!translate_VASurfaceID(driver_data, obj_context,
+                                   pic_param->ref_frame_map[i],
+                                   &pic_info->ref_frame_map[i]))
+            return 0;
+    }
+    for (i = 0; i < 7; i++) {
+        const unsigned int ref_idx = pic_param->ref_frame_idx[i] & 7;
+        const VAWarpedMotionParamsAV1 * const wm = &pic_param->wm[i];
+
+        /* VA-API has no reference sizes and order hints, these are
+           recorded when the reference picture is decoded */
+        pic_info->ref_frame[i].index  = pic_info->ref_frame_map[ref_idx];
+        pic_info->ref_frame[i].width  = 0;
+        pic_info->ref_frame[i].height = 0;
+        ref_order_hint[i]             = 0;
+        obj_surface = VDPAU_SURFACE(pic_param->ref_frame_map[ref_idx]);
+        if (obj_surface) {
+            pic_info->ref_frame[i].width  = obj_surface->frame_width;
+            pic_info->ref_frame[i].height = obj_surface->frame_height;
+            ref_order_hint[i]             = obj_surface->order_hint;
+        }
+
+        pic_info->global_motion[i].invalid = wm->invalid;
+        pic_info->global_motion[i].wmtype  = wm->wmtype;
+        for (j = 0; j < 6; j++)
+            pic_info->global_motion[i].wmmat[j] = wm->wmmat[j];
+    }
+    if (pic_param->primary_ref_frame >= 7)      /* PRIMARY_REF_NONE */
+        pic_info->primary_ref_frame = VDP_INVALID_HANDLE;
+    else
+        pic_info->primary_ref_frame =
+            pic_info->ref_frame[pic_param->primary_ref_frame].index;
+    av1_get_skip_mode_frames(pic_param, ref_order_hint, pic_info);
+
+    obj_surface = VDPAU_SURFACE(obj_context->current_render_target);
+    if (obj_surface) {
+        obj_surface->frame_width  = pic_info->width;
+        obj_surface->frame_height = pic_info->height;
+        obj_surface->order_hint   = pic_param->order_hint;
+    }
+    return 1;
+}
+
+// Translate VASliceParameterBufferAV1
+static int
+translate_VASliceParameterBufferAV1(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    obj_context->last_slice_params       = obj_buffer->buffer_data;
+    obj_context->last_slice_params_count = obj_buffer->num_elements;
+    return 1;
+}
+
+// Translate VASliceDataBuffer for AV1
+static int
+translate_VASliceDataBufferAV1(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    VdpPictureInfoAV1 * const pic_info = &obj_context->picture_slot->vdp_picture_info.av1;
+    VASliceParameterBufferAV1 * const slice_params = obj_context->last_slice_params;
+    uint32_t offset = 0;
+    unsigned int i;
 
-    switch (obj_context->vdp_codec) {
+    /* Tiles are located by their offsets into the whole bitstream */
+    for (i = 0; i < obj_context->picture_slot->vdp_bitstream_buffers_count; i++)
+        offset += obj_context->picture_slot->vdp_bitstream_buffers[i].bitstream_bytes;
+
+    /* XXX: this assumes we get SliceParams before SliceData */
+    for (i = 0; i < obj_context->last_slice_params_count; i++) {
+        VASliceParameterBufferAV1 * const slice_param = &slice_params[i];
+        const unsigned int tile_idx = (slice_param->tile_row * pic_info->num_tile_cols +
+                                       slice_param->tile_column);
+        if (2 * tile_idx + 1 >= ARRAY_ELEMS(pic_info->tile_info))
+            return 0;
+        if (append_VdpBitstreamBuffer(obj_context,
+                                      (uint8_t *)obj_buffer->buffer_data + slice_param->slice_data_offset,
+                                      slice_param->slice_data_size) < 0)
+            return 0;
+        pic_info->tile_info[2 * tile_idx]     = offset;
+        pic_info->tile_info[2 * tile_idx + 1] = offset + slice_param->slice_data_size;
+        offset += slice_param->slice_data_size;
+    }
+    return 1;
+}
+#endif
+
+// Reset VdpPictureInfo for a new picture
+static void
+begin_picture_MPEG2(object_context_p obj_context)
+{
+    obj_context->picture_slot->vdp_picture_info.mpeg2.slice_count = 0;
+}
+
+static void
+begin_picture_H264(object_context_p obj_context)
+{
+    obj_context->picture_slot->vdp_picture_info.h264.slice_count = 0;
+    obj_context->split_slice_count = 0;
+}
+
+// Settle the slice count once all slice data is translated
+static void
+end_picture_H264(object_context_p obj_context)
+{
+    VdpPictureInfoH264 * const pic_info = &obj_context->picture_slot->vdp_picture_info.h264;
+
+    /* Slices located from start codes override the slice parameters */
+    if (obj_context->split_slice_count > 0 &&
+        obj_context->split_slice_count != pic_info->slice_count) {
+        D(bug("H.264 slice data holds %u slices for %u slice parameters\n",
+              obj_context->split_slice_count, pic_info->slice_count));
+        pic_info->slice_count = obj_context->split_slice_count;
+    }
+}
+
+static void
+begin_picture_VC1(object_context_p obj_context)
+{
+    obj_context->picture_slot->vdp_picture_info.vc1.slice_count = 0;
+}
+
+// Returns the number of reference frames of the current H.264 picture
+static int
+get_num_ref_frames_H264(object_context_p obj_context)
+{
+    return obj_context->picture_slot->vdp_picture_info.h264.num_ref_frames;
+}
+
+#if USE_VDPAU_HEVC
+// Returns the DPB size of the current HEVC sequence
+static int
+get_num_ref_frames_HEVC(object_context_p obj_context)
+{
+    return obj_context->picture_slot->vdp_picture_info.hevc.sps_max_dec_pic_buffering_minus1 + 1;
+}
+#endif
+
+#if USE_VDPAU_VP9
+// Returns the number of VP9 reference frame slots
+static int
+get_num_ref_frames_VP9(object_context_p obj_context)
+{
+    return 8;
+}
+#endif
+
+#if USE_VDPAU_AV1
+// Returns the number of AV1 reference frame slots
+static int
+get_num_ref_frames_AV1(object_context_p obj_context)
+{
+    return 8;
+}
+#endif
+
+#define TRANSLATE(CODEC, TYPE) \
+    [VA##TYPE##BufferType] = translate_VA##TYPE##Buffer##CODEC
+
+static const decode_backend_t decode_backend_MPEG2 = {
+    .codec                      = VDP_CODEC_MPEG2,
+    .begin_picture              = begin_picture_MPEG2,
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .cached_buffer_types        = (BUFFER_TYPE_BIT(PictureParameter) |
+                                   BUFFER_TYPE_BIT(IQMatrix)),
+    .translate                  = {
+        TRANSLATE(MPEG2, PictureParameter),
+        TRANSLATE(MPEG2, IQMatrix),
+        TRANSLATE(MPEG2, SliceParameter),
+        TRANSLATE(MPEG2, SliceData),
+    }
+};
+
+#if USE_VDPAU_MPEG4
+static const decode_backend_t decode_backend_MPEG4 = {
+    .codec                      = VDP_CODEC_MPEG4,
+    /* The VOP header is reconstructed from the picture parameters */
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(PictureParameter) |
+                                   BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .cached_buffer_types        = BUFFER_TYPE_BIT(IQMatrix),
+    .translate                  = {
+        TRANSLATE(MPEG4, PictureParameter),
+        TRANSLATE(MPEG4, IQMatrix),
+        TRANSLATE(MPEG4, SliceParameter),
+        TRANSLATE(MPEG4, SliceData),
+    }
+};
+#endif
+
+static const decode_backend_t decode_backend_H264 = {
+    .codec                      = VDP_CODEC_H264,
+    .begin_picture              = begin_picture_H264,
+    .end_picture                = end_picture_H264,
+    .get_num_ref_frames         = get_num_ref_frames_H264,
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .cached_buffer_types        = (BUFFER_TYPE_BIT(PictureParameter) |
+                                   BUFFER_TYPE_BIT(IQMatrix)),
+    .translate                  = {
+        TRANSLATE(H264, PictureParameter),
+        TRANSLATE(H264, IQMatrix),
+        TRANSLATE(H264, SliceParameter),
+        TRANSLATE(H264, SliceData),
+    }
+};
+
+static const decode_backend_t decode_backend_VC1 = {
+    .codec                      = VDP_CODEC_VC1,
+    .begin_picture              = begin_picture_VC1,
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .cached_buffer_types        = BUFFER_TYPE_BIT(PictureParameter),
+    .translate                  = {
+        TRANSLATE(VC1, PictureParameter),
+        TRANSLATE(VC1, SliceParameter),
+        [VABitPlaneBufferType]  = translate_nothing,
+        [VASliceDataBufferType] = translate_VASliceDataBuffer,
+    }
+};
+
+#if USE_VDPAU_HEVC
+static const decode_backend_t decode_backend_HEVC = {
+    .codec                      = VDP_CODEC_HEVC,
+    .get_num_ref_frames         = get_num_ref_frames_HEVC,
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .cached_buffer_types        = (BUFFER_TYPE_BIT(PictureParameter) |
+                                   BUFFER_TYPE_BIT(IQMatrix)),
+    .translate                  = {
+        TRANSLATE(HEVC, PictureParameter),
+        TRANSLATE(HEVC, IQMatrix),
+        TRANSLATE(HEVC, SliceParameter),
+        TRANSLATE(HEVC, SliceData),
+    }
+};
+#endif
+
+#if USE_VDPAU_VP9
+static const decode_backend_t decode_backend_VP9 = {
+    .codec                      = VDP_CODEC_VP9,
+    .get_num_ref_frames         = get_num_ref_frames_VP9,
+    /* The frame header is parsed from the slice data */
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .translate                  = {
+        TRANSLATE(VP9, PictureParameter),
+        TRANSLATE(VP9, SliceParameter),
+        TRANSLATE(VP9, SliceData),
+    }
+};
+#endif
+
+#if USE_VDPAU_AV1
+static const decode_backend_t decode_backend_AV1 = {
+    .codec                      = VDP_CODEC_AV1,
+    .get_num_ref_frames         = get_num_ref_frames_AV1,
+    .preserved_buffer_types     = (BUFFER_TYPE_BIT(SliceParameter) |
+                                   BUFFER_TYPE_BIT(SliceData)),
+    .translate                  = {
+        TRANSLATE(AV1, PictureParameter),
+        TRANSLATE(AV1, SliceParameter),
+        TRANSLATE(AV1, SliceData),
+    }
+};
+#endif
+
+#undef TRANSLATE
+
+// Returns the decode backend for the specified codec
+const decode_backend_t *
+get_decode_backend(VdpCodec codec)
+{
+    switch (codec) {
     case VDP_CODEC_MPEG1:
     case VDP_CODEC_MPEG2:
-        obj_context->vdp_picture_info.mpeg2.slice_count = 0;
-        break;
+        return &decode_backend_MPEG2;
+#if USE_VDPAU_MPEG4
     case VDP_CODEC_MPEG4:
-        break;
+        return &decode_backend_MPEG4;
+#endif
     case VDP_CODEC_H264:
-        obj_context->vdp_picture_info.h264.slice_count = 0;
-        break;
+        return &decode_backend_H264;
     case VDP_CODEC_VC1:
-        obj_context->vdp_picture_info.vc1.slice_count = 0;
-        break;
+        return &decode_backend_VC1;
+#if USE_VDPAU_HEVC
+    case VDP_CODEC_HEVC:
+        return &decode_backend_HEVC;
+#endif
+#if USE_VDPAU_VP9
+    case VDP_CODEC_VP9:
+        return &decode_backend_VP9;
+#endif
+#if USE_VDPAU_AV1
+    case VDP_CODEC_AV1:
+        return &decode_backend_AV1;
+#endif
     default:
-        return VA_STATUS_ERROR_UNKNOWN;
+        break;
     }
+    return NULL;
+}
+
+// Returns the translated_buffers[] slot for the VA buffer type
+static inline int
+get_translated_buffer_slot(VABufferType type)
+{
+    switch (type) {
+    case VAPictureParameterBufferType:  return VDPAU_TRANSLATED_PIC_PARAM;
+    case VAIQMatrixBufferType:          return VDPAU_TRANSLATED_IQ_MATRIX;
+    default:                            break;
+    }
+    return -1;
+}
+
+// Translate VA buffer, unless it repeats the previously translated one
+static int
+translate_buffer_cached(
+    vdpau_driver_data_t   *driver_data,
+    object_context_p       obj_context,
+    object_buffer_p        obj_buffer,
+    translate_buffer_func_t func
+)
+{
+    const int slot = get_translated_buffer_slot(obj_buffer->type);
+    if (slot < 0)
+        return func(driver_data, obj_context, obj_buffer);
+
+    translated_buffer_t * const tb = &obj_context->translated_buffers[slot];
+    const unsigned int size = obj_buffer->buffer_size;
+
+    /* VdpPictureInfo still holds the translation of identical data */
+    if (tb->size == size && size > 0 &&
+        memcmp(tb->data, obj_buffer->buffer_data, size) == 0) {
+        __atomic_add_fetch(&driver_data->num_translations_skipped[slot], 1,
+                           __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    __atomic_add_fetch(&driver_data->num_translations[slot], 1, __ATOMIC_RELAXED);
+    tb->size = 0;
+    if (!func(driver_data, obj_context, obj_buffer))
+        return 0;
+
+    if (realloc_buffer(&tb->data, &tb->size_max, size, 1)) {
+        memcpy(tb->data, obj_buffer->buffer_data, size);
+        tb->size = size;
+    }
+    return 1;
+}
+
+// Translate VA buffer
+static int
+translate_buffer(
+    vdpau_driver_data_t *driver_data,
+    object_context_p    obj_context,
+    object_buffer_p     obj_buffer
+)
+{
+    const decode_backend_t * const backend = obj_context->decode_backend;
+    translate_buffer_func_t func = NULL;
+
+    if ((unsigned int)obj_buffer->type < DECODE_BACKEND_MAX_BUFFER_TYPES)
+        func = backend->translate[obj_buffer->type];
+    if (func) {
+        if (backend->cached_buffer_types & (1U << obj_buffer->type))
+            return translate_buffer_cached(driver_data, obj_context,
+                                           obj_buffer, func);
+        return func(driver_data, obj_context, obj_buffer);
+    }
+
+    D(bug("ERROR: no translate function found for %s%s\n",
+          string_of_VABufferType(obj_buffer->type),
+          string_of_VdpCodec(obj_context->vdp_codec)));
+    return 0;
+}
+
+// vaQueryConfigProfiles
+VAStatus
+vdpau_QueryConfigProfiles(
+    VADriverContextP    ctx,
+    VAProfile          *profile_list,
+    int                *num_profiles
+)
+{
+    VDPAU_DRIVER_DATA_INIT;
+
+    static const VAProfile va_profiles[] = {
+        VAProfileMPEG2Simple,
+        VAProfileMPEG2Main,
+        VAProfileMPEG4Simple,
+        VAProfileMPEG4AdvancedSimple,
+        VAProfileMPEG4Main,
+        VAProfileH264Baseline,
+        VAProfileH264Main,
+        VAProfileH264High,
+        VAProfileVC1Simple,
+        VAProfileVC1Main,
+        VAProfileVC1Advanced,
+#if USE_VDPAU_HEVC
+        VAProfileHEVCMain,
+        VAProfileHEVCMain10,
+#endif
+#if USE_VDPAU_VP9
+        VAProfileVP9Profile0,
+        VAProfileVP9Profile2,
+#endif
+#if USE_VDPAU_AV1
+        VAProfileAV1Profile0,
+#endif
+    };
+
+    int i, n = 0;
+    for (i = 0; i < ARRAY_ELEMS(va_profiles); i++) {
+        VAProfile profile = va_profiles[i];
+        VdpDecoderProfile vdp_profile = get_VdpDecoderProfile(profile);
+        if (is_supported_profile(driver_data, vdp_profile))
+            profile_list[n++] = profile;
+    }
+
+    /* If the assert fails then VDPAU_MAX_PROFILES needs to be bigger */
+    ASSERT(n <= VDPAU_MAX_PROFILES);
+    if (num_profiles)
+        *num_profiles = n;
 
-    destroy_dead_va_buffers(driver_data, obj_context);
     return VA_STATUS_SUCCESS;
 }
 
-// vaRenderPicture
+// vaQueryConfigEntrypoints
 VAStatus
-vdpau_RenderPicture(
+vdpau_QueryConfigEntrypoints(
     VADriverContextP    ctx,
-    VAContextID         context,
-    VABufferID         *buffers,
-    int                 num_buffers
+    VAProfile           profile,
+    VAEntrypoint       *entrypoint_list,
+    int                *num_entrypoints
 )
 {
     VDPAU_DRIVER_DATA_INIT;
-    int i;
 
-    object_context_p obj_context = VDPAU_CONTEXT(context);
-    if (!obj_context)
-        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    VdpDecoderProfile vdp_profile = get_VdpDecoderProfile(profile);
+    if (!is_supported_profile(driver_data, vdp_profile))
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
 
-    object_surface_p obj_surface = VDPAU_SURFACE(obj_context->current_render_target);
-    if (!obj_surface)
-        return VA_STATUS_ERROR_INVALID_SURFACE;
+    VAEntrypoint entrypoint;
+    switch (profile) {
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main:
+        entrypoint = VAEntrypointVLD;
+        break;
+    case VAProfileMPEG4Simple:
+    case VAProfileMPEG4AdvancedSimple:
+    case VAProfileMPEG4Main:
+        entrypoint = VAEntrypointVLD;
+        break;
+    case VAProfileH264Baseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:
+        entrypoint = VAEntrypointVLD;
+        break;
+    case VAProfileVC1Simple:
+    case VAProfileVC1Main:
+    case VAProfileVC1Advanced:
+        entrypoint = VAEntrypointVLD;
+        break;
+#if USE_VDPAU_HEVC
+    case VAProfileHEVCMain:
+    case VAProfileHEVCMain10:
+        entrypoint = VAEntrypointVLD;
+        break;
+#endif
+#if USE_VDPAU_VP9
+    case VAProfileVP9Profile0:
+    case VAProfileVP9Profile2:
+        entrypoint = VAEntrypointVLD;
+        break;
+#endif
+#if USE_VDPAU_AV1
+    case VAProfileAV1Profile0:
+        entrypoint = VAEntrypointVLD;
+        break;
+#endif
+    default:
+        entrypoint = 0;
+        break;
+    }
+
+    if (entrypoint_list)
+        *entrypoint_list = entrypoint;
+
+    if (num_entrypoints)
+        *num_entrypoints = entrypoint != 0;
+
+    return VA_STATUS_SUCCESS;
+}
+
+// Starts decoding a picture into obj_surface
+static void
+begin_picture(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    object_surface_p     obj_surface
+)
+{
+    obj_surface->va_surface_status           = VASurfaceRendering;
+    obj_context->last_pic_param              = NULL;
+    obj_context->last_slice_params           = NULL;
+    obj_context->last_slice_params_count     = 0;
+    obj_context->current_render_target       = obj_surface->base.id;
+    next_picture_slot(driver_data, obj_context);
+    reset_gen_slice_data(obj_context);
+    if (obj_context->picture_count == 0)
+        obj_context->first_picture_time = get_ticks_usec();
+
+    if (obj_context->decode_backend->begin_picture)
+        obj_context->decode_backend->begin_picture(obj_context);
+
+    destroy_dead_va_buffers(driver_data, obj_context);
+}
+
+// Translates the VA buffers of the current picture, then releases them
+static VAStatus
+render_picture(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    VABufferID          *buffers,
+    int                  num_buffers
+)
+{
+    int i;
 
-    /* Verify that we got valid buffer references */
     for (i = 0; i < num_buffers; i++) {
         object_buffer_p obj_buffer = VDPAU_BUFFER(buffers[i]);
         if (!obj_buffer)
             return VA_STATUS_ERROR_INVALID_BUFFER;
-    }
-
-    /* Translate buffers */
-    for (i = 0; i < num_buffers; i++) {
-        object_buffer_p obj_buffer = VDPAU_BUFFER(buffers[i]);
         if (!translate_buffer(driver_data, obj_context, obj_buffer))
             return VA_STATUS_ERROR_UNSUPPORTED_BUFFERTYPE;
-        /* Release any buffer that is not VASliceDataBuffer */
-        /* VASliceParameterBuffer is also needed to check for start_codes */
-        switch (obj_buffer->type) {
-        case VASliceParameterBufferType:
-        case VASliceDataBufferType:
+        if (obj_buffer->type == VASliceParameterBufferType)
+            obj_context->slice_count += obj_buffer->num_elements;
+        /* Release any buffer the decode backend does not reference
+           until vaEndPicture(), e.g. slice data and parameters used to
+           check for start codes */
+        if (obj_context->decode_backend->preserved_buffer_types &
+            (1U << obj_buffer->type))
             schedule_destroy_va_buffer(driver_data, obj_buffer);
-            break;
-        case VAPictureParameterBufferType:
-            /* Preserve VAPictureParameterBufferMPEG4 */
-            if (obj_context->vdp_codec == VDP_CODEC_MPEG4) {
-                schedule_destroy_va_buffer(driver_data, obj_buffer);
-                break;
-            }
-            /* fall-through */
-        default:
+        else
             destroy_va_buffer(driver_data, obj_buffer);
-            break;
-        }
         buffers[i] = VA_INVALID_BUFFER;
     }
-
     return VA_STATUS_SUCCESS;
 }
 
-// vaEndPicture
-VAStatus
-vdpau_EndPicture(
-    VADriverContextP    ctx,
-    VAContextID         context
+// Checks that all buffers are valid VA buffers
+static inline int
+check_buffers(
+    vdpau_driver_data_t *driver_data,
+    const VABufferID    *buffers,
+    int                  num_buffers
 )
 {
-    VDPAU_DRIVER_DATA_INIT;
-    unsigned int i;
+    int i;
 
-    object_context_p obj_context = VDPAU_CONTEXT(context);
-    if (!obj_context)
-        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    for (i = 0; i < num_buffers; i++) {
+        if (!VDPAU_BUFFER(buffers[i]))
+            return 0;
+    }
+    return 1;
+}
 
-    object_surface_p obj_surface = VDPAU_SURFACE(obj_context->current_render_target);
-    if (!obj_surface)
+// Orders contexts by address, the order in which batches lock them
+static int
+compare_contexts(const void *a, const void *b)
+{
+    const uintptr_t x = (uintptr_t)*(const object_context_p *)a;
+    const uintptr_t y = (uintptr_t)*(const object_context_p *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Checks a picture of the batch, with the lock of its context held.
+// Buffers are destroyed once consumed, so they can only be used once
+static VAStatus
+check_batch_picture(
+    vdpau_driver_data_t        *driver_data,
+    object_context_p            obj_context,
+    const VADecodePictureVDPAU *picture,
+    uint64_t                    batch
+)
+{
+    int i;
+
+    if (!context_is_alive(driver_data, obj_context, picture->context))
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    if (!VDPAU_SURFACE(picture->render_target))
         return VA_STATUS_ERROR_INVALID_SURFACE;
+    if (picture->num_buffers > 0 && !picture->buffers)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < picture->num_buffers; i++) {
+        object_buffer_p obj_buffer = VDPAU_BUFFER(picture->buffers[i]);
+        if (!obj_buffer || obj_buffer->decode_batch == batch)
+            return VA_STATUS_ERROR_INVALID_BUFFER;
+        obj_buffer->decode_batch = batch;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+// Submits the current picture for decoding into obj_surface
+static VAStatus
+end_picture(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    object_surface_p     obj_surface
+)
+{
+    picture_slot_t * const slot = obj_context->picture_slot;
+    unsigned int i;
+
+    if (obj_context->decode_backend->end_picture)
+        obj_context->decode_backend->end_picture(obj_context);
 
     if (trace_enabled()) {
         switch (obj_context->vdp_codec) {
         case VDP_CODEC_MPEG1:
         case VDP_CODEC_MPEG2:
-            dump_VdpPictureInfoMPEG1Or2(&obj_context->vdp_picture_info.mpeg2);
+            dump_VdpPictureInfoMPEG1Or2(&slot->vdp_picture_info.mpeg2);
             break;
 #if HAVE_VDPAU_MPEG4
         case VDP_CODEC_MPEG4:
-            dump_VdpPictureInfoMPEG4Part2(&obj_context->vdp_picture_info.mpeg4);
+            dump_VdpPictureInfoMPEG4Part2(&slot->vdp_picture_info.mpeg4);
             break;
 #endif
         case VDP_CODEC_H264:
-            dump_VdpPictureInfoH264(&obj_context->vdp_picture_info.h264);
+            dump_VdpPictureInfoH264(&slot->vdp_picture_info.h264);
             break;
         case VDP_CODEC_VC1:
-            dump_VdpPictureInfoVC1(&obj_context->vdp_picture_info.vc1);
+            dump_VdpPictureInfoVC1(&slot->vdp_picture_info.vc1);
+            break;
+#if USE_VDPAU_HEVC
+        case VDP_CODEC_HEVC:
+            dump_VdpPictureInfoHEVC(&slot->vdp_picture_info.hevc);
+            break;
+#endif
+#if USE_VDPAU_VP9
+        case VDP_CODEC_VP9:
+            dump_VdpPictureInfoVP9(&slot->vdp_picture_info.vp9);
+            break;
+#endif
+#if USE_VDPAU_AV1
+        case VDP_CODEC_AV1:
+            dump_VdpPictureInfoAV1(&slot->vdp_picture_info.av1);
             break;
+#endif
         default:
             break;
         }
-        for (i = 0; i < obj_context->vdp_bitstream_buffers_count; i++)
-            dump_VdpBitstreamBuffer(&obj_context->vdp_bitstream_buffers[i]);
+        for (i = 0; i < slot->vdp_bitstream_buffers_count; i++)
+            dump_VdpBitstreamBuffer(&slot->vdp_bitstream_buffers[i]);
     }
 
     VAStatus va_status;
@@ -1284,22 +3419,224 @@ vdpau_EndPicture(
         obj_context,
         get_num_ref_frames(obj_context)
     );
-    if (vdp_status == VDP_STATUS_OK)
-        vdp_status = vdpau_decoder_render(
-            driver_data,
-            obj_context->vdp_decoder,
-            obj_surface->vdp_surface,
-            (VdpPictureInfo)&obj_context->vdp_picture_info,
-            obj_context->vdp_bitstream_buffers_count,
-            obj_context->vdp_bitstream_buffers
-        );
+    if (vdp_status == VDP_STATUS_OK) {
+        coalesce_VdpBitstreamBuffers(driver_data, obj_context);
+        if (obj_context->decode_worker)
+            vdp_status = decode_worker_submit(driver_data, obj_context, obj_surface);
+        else
+            vdp_status = vdpau_decoder_render(
+                driver_data,
+                obj_context->vdp_decoder,
+                obj_surface->vdp_surface,
+                (VdpPictureInfo)&slot->vdp_picture_info,
+                slot->vdp_bitstream_buffers_count,
+                slot->vdp_bitstream_buffers
+            );
+    }
     va_status = vdpau_get_VAStatus(vdp_status);
 
+    if (obj_context->max_slice_count < obj_context->slice_count)
+        obj_context->max_slice_count = obj_context->slice_count;
+
     /* XXX: assume we are done with rendering right away */
     obj_context->current_render_target = VA_INVALID_SURFACE;
 
-    /* Release pending buffers */
+    /* Release pending buffers, and everything allocated for the picture */
     destroy_dead_va_buffers(driver_data, obj_context);
+    rotate_picture_arena(driver_data, obj_context);
+
+    if (obj_context->picture_count++ == 0)
+        update_first_picture_stats(driver_data, obj_context);
+    return va_status;
+}
+
+// vaBeginPicture
+VAStatus
+vdpau_BeginPicture(
+    VADriverContextP    ctx,
+    VAContextID         context,
+    VASurfaceID         render_target
+)
+{
+    VDPAU_DRIVER_DATA_INIT;
+
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    object_surface_p obj_surface = VDPAU_SURFACE(render_target);
+    if (!obj_surface)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    pthread_mutex_lock(&obj_context->lock);
+    if (!context_is_alive(driver_data, obj_context, context))
+        va_status = VA_STATUS_ERROR_INVALID_CONTEXT;
+    else
+        begin_picture(driver_data, obj_context, obj_surface);
+    pthread_mutex_unlock(&obj_context->lock);
+    return va_status;
+}
+
+// vaRenderPicture
+VAStatus
+vdpau_RenderPicture(
+    VADriverContextP    ctx,
+    VAContextID         context,
+    VABufferID         *buffers,
+    int                 num_buffers
+)
+{
+    VDPAU_DRIVER_DATA_INIT;
+    VAStatus va_status;
+
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    pthread_mutex_lock(&obj_context->lock);
+    object_surface_p obj_surface = VDPAU_SURFACE(obj_context->current_render_target);
+    if (!context_is_alive(driver_data, obj_context, context))
+        va_status = VA_STATUS_ERROR_INVALID_CONTEXT;
+    else if (!obj_surface)
+        va_status = VA_STATUS_ERROR_INVALID_SURFACE;
+    else if (!check_buffers(driver_data, buffers, num_buffers))
+        va_status = VA_STATUS_ERROR_INVALID_BUFFER;
+    else
+        va_status = render_picture(driver_data, obj_context,
+                                   buffers, num_buffers);
+    pthread_mutex_unlock(&obj_context->lock);
+    return va_status;
+}
+
+// vaEndPicture
+VAStatus
+vdpau_EndPicture(
+    VADriverContextP    ctx,
+    VAContextID         context
+)
+{
+    VDPAU_DRIVER_DATA_INIT;
+
+    VAStatus va_status;
+
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    pthread_mutex_lock(&obj_context->lock);
+    object_surface_p obj_surface = VDPAU_SURFACE(obj_context->current_render_target);
+    if (!context_is_alive(driver_data, obj_context, context))
+        va_status = VA_STATUS_ERROR_INVALID_CONTEXT;
+    else if (!obj_surface)
+        va_status = VA_STATUS_ERROR_INVALID_SURFACE;
+    else
+        va_status = end_picture(driver_data, obj_context, obj_surface);
+    pthread_mutex_unlock(&obj_context->lock);
+
+    vdpau_stats_dump_periodic(driver_data);
+    return va_status;
+}
+
+// vdpau_ext_DecodePictures() implementation
+VAStatus
+vdpau_DecodePictures(
+    VADriverContextP            ctx,
+    VADecodePictureVDPAU       *pictures,
+    unsigned int                num_pictures
+)
+{
+    VDPAU_DRIVER_DATA_INIT;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    object_context_p contexts_buf[8], *contexts = contexts_buf;
+    object_context_p obj_context = NULL;
+    unsigned int i, n, num_contexts = 0;
+    uint64_t batch;
+
+    if (num_pictures > 0 && !pictures)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* One lookup per run of pictures sharing a context */
+    for (i = 0; i < num_pictures; i++) {
+        pictures[i].status = VA_STATUS_ERROR_UNKNOWN;
+        if (i == 0 || pictures[i].context != pictures[i - 1].context)
+            num_contexts++;
+    }
+    if (num_contexts > ARRAY_ELEMS(contexts_buf)) {
+        contexts = malloc(num_contexts * sizeof(*contexts));
+        if (!contexts)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    num_contexts = 0;
+    for (i = 0; i < num_pictures; i++) {
+        if (i > 0 && pictures[i].context == pictures[i - 1].context)
+            continue;
+        if ((obj_context = VDPAU_CONTEXT(pictures[i].context)) == NULL) {
+            pictures[i].status = VA_STATUS_ERROR_INVALID_CONTEXT;
+            va_status = VA_STATUS_ERROR_INVALID_CONTEXT;
+            goto end;
+        }
+        contexts[num_contexts++] = obj_context;
+    }
+
+    /* The whole batch is validated, then submitted, with the locks of
+       all its contexts held, so that no other thread can destroy its
+       objects in between. Batches take them in the same order, and
+       nothing else holds two context locks, so this cannot deadlock */
+    qsort(contexts, num_contexts, sizeof(*contexts), compare_contexts);
+    for (i = 0, n = 0; i < num_contexts; i++) {
+        if (n == 0 || contexts[i] != contexts[n - 1])
+            contexts[n++] = contexts[i];
+    }
+    num_contexts = n;
+    for (i = 0; i < num_contexts; i++)
+        pthread_mutex_lock(&contexts[i]->lock);
+
+    /* Buffers are marked with the batch number as they are checked, so
+       that a buffer used twice is found in a single pass */
+    batch = __atomic_add_fetch(&driver_data->decode_batch_seq, 1,
+                               __ATOMIC_RELAXED);
+    for (i = 0; i < num_pictures; i++) {
+        VADecodePictureVDPAU * const picture = &pictures[i];
+        if (i == 0 || picture->context != pictures[i - 1].context)
+            obj_context = VDPAU_CONTEXT(picture->context);
+        if (!obj_context)
+            va_status = VA_STATUS_ERROR_INVALID_CONTEXT;
+        else
+            va_status = check_batch_picture(driver_data, obj_context,
+                                            picture, batch);
+        if (va_status != VA_STATUS_SUCCESS) {
+            picture->status = va_status;
+            goto unlock;
+        }
+    }
+
+    for (i = 0; i < num_pictures; i++) {
+        VADecodePictureVDPAU * const picture = &pictures[i];
+        object_surface_p const obj_surface =
+            VDPAU_SURFACE(picture->render_target);
+        if (i == 0 || picture->context != pictures[i - 1].context)
+            obj_context = VDPAU_CONTEXT(picture->context);
+
+        begin_picture(driver_data, obj_context, obj_surface);
+        va_status = render_picture(driver_data, obj_context,
+                                   picture->buffers, picture->num_buffers);
+        if (va_status == VA_STATUS_SUCCESS)
+            va_status = end_picture(driver_data, obj_context, obj_surface);
+        else
+            obj_context->current_render_target = VA_INVALID_SURFACE;
+        picture->status = va_status;
+        if (va_status != VA_STATUS_SUCCESS)
+            break;
+    }
+
+unlock:
+    for (i = num_contexts; i-- > 0;)
+        pthread_mutex_unlock(&contexts[i]->lock);
+end:
+    if (contexts != contexts_buf)
+        free(contexts);
 
+    vdpau_stats_dump_periodic(driver_data);
     return va_status;
 }
@@ -22,19 +22,30 @@
 #define VDPAU_DECODE_H
 
 #include "vdpau_driver.h"
+#include "vdpau_ext.h"
 
 typedef enum {
     VDP_CODEC_MPEG1 = 1,
     VDP_CODEC_MPEG2,
     VDP_CODEC_MPEG4,
     VDP_CODEC_H264,
-    VDP_CODEC_VC1
+    VDP_CODEC_VC1,
+    VDP_CODEC_HEVC,
+    VDP_CODEC_VP9,
+    VDP_CODEC_AV1
 } VdpCodec;
 
+typedef struct decode_backend decode_backend_t;
+
 // Translates VdpDecoderProfile to VdpCodec
 VdpCodec get_VdpCodec(VdpDecoderProfile profile)
     attribute_hidden;
 
+// Returns the decode backend for the specified codec
+const decode_backend_t *
+get_decode_backend(VdpCodec codec)
+    attribute_hidden;
+
 // Translates VAProfile to VdpDecoderProfile
 VdpDecoderProfile get_VdpDecoderProfile(VAProfile profile)
     attribute_hidden;
@@ -47,6 +58,73 @@ check_decoder(
     VAEntrypoint         entrypoint
 ) attribute_hidden;
 
+// Returns the VAConfigAttribMPEG1VDPAU value for configs of profile
+unsigned int
+get_mpeg1_attribute(vdpau_driver_data_t *driver_data, VAProfile profile)
+    attribute_hidden;
+
+// Translates the profile of a config to VdpDecoderProfile
+VdpDecoderProfile
+get_config_VdpDecoderProfile(object_config_p obj_config)
+    attribute_hidden;
+
+// Create the asynchronous decode worker of a context
+int
+decode_worker_create(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
+// Wait for all pictures to be submitted and destroy the decode worker
+void
+decode_worker_destroy(object_context_p obj_context)
+    attribute_hidden;
+
+// Destroy the picture slots of a context, once its decode worker is gone
+void
+destroy_picture_slots(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
+// Check whether the last picture decoded into surface is still queued
+int
+surface_decode_pending(
+    vdpau_driver_data_t *driver_data,
+    object_surface_p     obj_surface
+) attribute_hidden;
+
+// Wait for the last picture decoded into surface to be submitted to VDPAU
+void
+sync_surface_decode(
+    vdpau_driver_data_t *driver_data,
+    object_surface_p     obj_surface
+) attribute_hidden;
+
+// Hand the decoder of a context over to the idle decoder cache
+void
+decoder_cache_release(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
+// Destroy all idle decoders
+void
+decoder_cache_flush(vdpau_driver_data_t *driver_data)
+    attribute_hidden;
+
+// Create the decoder of a new context ahead of its first picture
+void
+decoder_warmup(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
+// Wait for the decoder warm-up thread of a context, if any
+void
+decoder_warmup_wait(object_context_p obj_context)
+    attribute_hidden;
+
 // vaQueryConfigProfiles
 VAStatus
 vdpau_QueryConfigProfiles(
@@ -88,4 +166,12 @@ vdpau_EndPicture(
     VAContextID         context
 ) attribute_hidden;
 
+// vdpau_ext_DecodePictures() implementation
+VAStatus
+vdpau_DecodePictures(
+    VADriverContextP            ctx,
+    VADecodePictureVDPAU       *pictures,
+    unsigned int                num_pictures
+) attribute_hidden;
+
 #endif /* VDPAU_DECODE_H */
@@ -26,8 +26,11 @@
 #include "vdpau_image.h"
 #include "vdpau_subpic.h"
 #include "vdpau_mixer.h"
+#include "vdpau_stats.h"
 #include "vdpau_video.h"
 #include "vdpau_video_x11.h"
+#include "utils.h"
+#include "ubitstream.h"
 #if USE_GLX
 #include "vdpau_video_glx.h"
 #include <va/va_backend_glx.h>
@@ -100,6 +103,15 @@ static void destroy_buffer_cb(object_base_p obj, void *user_data)
     destroy_va_buffer(driver_data, obj_buffer);
 }
 
+// Destroy CONTEXT objects
+static void destroy_context_cb(object_base_p obj, void *user_data)
+{
+    object_context_p const obj_context = (object_context_p)obj;
+    vdpau_driver_data_t * const driver_data = user_data;
+
+    destroy_context(driver_data, obj_context);
+}
+
 // Destroy MIXER objects
 static void destroy_mixer_cb(object_base_p obj, void *user_data)
 {
@@ -112,6 +124,26 @@ static void destroy_mixer_cb(object_base_p obj, void *user_data)
 // Destroy object heap
 typedef void (*destroy_heap_func_t)(object_base_p obj, void *user_data);
 
+typedef struct {
+    const char         *name;
+    object_heap_p       heap;
+    destroy_heap_func_t destroy_func;
+    void               *user_data;
+} destroy_heap_args_t;
+
+static int
+destroy_heap_object(object_base_p obj, void *user_data)
+{
+    destroy_heap_args_t * const args = user_data;
+
+    vdpau_information_message("vaTerminate(): %s ID 0x%08x is still allocated, destroying\n", args->name, obj->id);
+    if (args->destroy_func)
+        args->destroy_func(obj, args->user_data);
+    else
+        object_heap_free(args->heap, obj);
+    return 0;
+}
+
 static void
 destroy_heap(
     const char         *name,
@@ -120,33 +152,29 @@ destroy_heap(
     void               *user_data
 )
 {
-    object_base_p obj;
-    object_heap_iterator iter;
+    destroy_heap_args_t args;
 
     if (!heap)
         return;
 
-    obj = object_heap_first(heap, &iter);
-    while (obj) {
-        vdpau_information_message("vaTerminate(): %s ID 0x%08x is still allocated, destroying\n", name, obj->id);
-        if (destroy_func)
-            destroy_func(obj, user_data);
-        else
-            object_heap_free(heap, obj);
-        obj = object_heap_next(heap, &iter);
-    }
+    args.name         = name;
+    args.heap         = heap;
+    args.destroy_func = destroy_func;
+    args.user_data    = user_data;
+    object_heap_foreach(heap, destroy_heap_object, &args);
     object_heap_destroy(heap);
 }
 
 #define DESTROY_HEAP(heap, func) \
         destroy_heap(#heap, &driver_data->heap##_heap, func, driver_data)
 
-#define CREATE_HEAP(type, id) do {              \
+#define CREATE_HEAP(type, id, prealloc) do {    \
         int result;                             \
-        result = object_heap_init(              \
+        result = object_heap_init_full(         \
             &driver_data->type##_heap,          \
             sizeof(struct object_##type),       \
-            VDPAU_##id##_ID_OFFSET              \
+            VDPAU_##id##_ID_OFFSET,             \
+            prealloc                            \
         );                                      \
         if (result != 0)                        \
             return VA_STATUS_ERROR_UNKNOWN;     \
@@ -156,17 +184,26 @@ destroy_heap(
 static void
 vdpau_common_Terminate(vdpau_driver_data_t *driver_data)
 {
+    vdpau_stats_report(driver_data);
+
+    /* Contexts go first: their decode workers may still be rendering
+       into surfaces, and they hold buffers, arenas and decoders */
+    DESTROY_HEAP(context,     destroy_context_cb);
     DESTROY_HEAP(buffer,      destroy_buffer_cb);
+    pool_free(driver_data->buffer_pool);
+    driver_data->buffer_pool = NULL;
     DESTROY_HEAP(image,       NULL);
     DESTROY_HEAP(subpicture,  NULL);
     DESTROY_HEAP(output,      NULL);
     DESTROY_HEAP(surface,     NULL);
-    DESTROY_HEAP(context,     NULL);
     DESTROY_HEAP(config,      NULL);
     DESTROY_HEAP(mixer,       destroy_mixer_cb);
 #if USE_GLX
     DESTROY_HEAP(glx_surface, NULL);
 #endif
+    decoder_cache_flush(driver_data);
+    pthread_mutex_destroy(&driver_data->decoder_cache_lock);
+    pthread_mutex_destroy(&driver_data->mixer_lock);
 
     if (driver_data->vdp_device != VDP_INVALID_HANDLE) {
         vdpau_device_destroy(driver_data, driver_data->vdp_device);
@@ -184,6 +221,9 @@ vdpau_common_Terminate(vdpau_driver_data_t *driver_data)
 static VAStatus
 vdpau_common_Initialize(vdpau_driver_data_t *driver_data)
 {
+    pthread_mutex_init(&driver_data->decoder_cache_lock, NULL);
+    pthread_mutex_init(&driver_data->mixer_lock, NULL);
+
     /* Create a dedicated X11 display for VDPAU purposes */
     const char * const x11_dpy_name = XDisplayString(driver_data->x11_dpy);
     driver_data->vdp_dpy = XOpenDisplay(x11_dpy_name);
@@ -249,20 +289,104 @@ vdpau_common_Initialize(vdpau_driver_data_t *driver_data)
         sprintf(&driver_data->va_vendor[len], ".pre%d", VDPAU_VIDEO_PRE_VERSION);
     }
 
-    CREATE_HEAP(config,         CONFIG);
-    CREATE_HEAP(context,        CONTEXT);
-    CREATE_HEAP(surface,        SURFACE);
-    CREATE_HEAP(buffer,         BUFFER);
-    CREATE_HEAP(output,         OUTPUT);
-    CREATE_HEAP(image,          IMAGE);
-    CREATE_HEAP(subpicture,     SUBPICTURE);
-    CREATE_HEAP(mixer,          MIXER);
+    /* Advertise driver-private extensions, see vdpau_ext.h */
+    strcat(driver_data->va_vendor,
+           " [" VDPAU_EXT_DECODE_PICTURES "] [" VDPAU_EXT_MPEG1 "]");
+
+    vdpau_stats_init(driver_data);
+
+    /* Preallocation hints are sized for a couple of decode sessions */
+    CREATE_HEAP(config,         CONFIG,         16);
+    CREATE_HEAP(context,        CONTEXT,        16);
+    CREATE_HEAP(surface,        SURFACE,        64);
+    CREATE_HEAP(buffer,         BUFFER,         512);
+    CREATE_HEAP(output,         OUTPUT,         16);
+    CREATE_HEAP(image,          IMAGE,          16);
+    CREATE_HEAP(subpicture,     SUBPICTURE,     16);
+    CREATE_HEAP(mixer,          MIXER,          16);
 #if USE_GLX
-    CREATE_HEAP(glx_surface,    GLX_SURFACE);
+    CREATE_HEAP(glx_surface,    GLX_SURFACE,    16);
 #endif
+
+    /* VA buffers are created and destroyed several times per frame */
+    if (object_heap_enable_magazines(&driver_data->buffer_heap) < 0)
+        return VA_STATUS_ERROR_UNKNOWN;
+
+    /* ... and so are image buffer payloads, which may be megabytes
+       large. Decode buffers use per-picture arenas instead */
+    int pool_size;
+    if (getenv_int("VDPAU_VIDEO_BUFFER_POOL", &pool_size) < 0 || pool_size < 0)
+        pool_size = VDPAU_BUFFER_POOL_SIZE;
+    if (pool_size > 0) {
+        driver_data->buffer_pool = pool_new((size_t)pool_size << 20);
+        if (!driver_data->buffer_pool)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    /* Heavily sliced pictures may be submitted as one contiguous buffer */
+    int coalesce_fragments, coalesce_max_bytes;
+    if (getenv_int("VDPAU_VIDEO_COALESCE", &coalesce_fragments) < 0 ||
+        coalesce_fragments < 0)
+        coalesce_fragments = 0;
+    if (getenv_int("VDPAU_VIDEO_COALESCE_MAX_BYTES", &coalesce_max_bytes) < 0 ||
+        coalesce_max_bytes <= 0)
+        coalesce_max_bytes = VDPAU_COALESCE_MAX_BYTES;
+    driver_data->coalesce_min_fragments = coalesce_fragments;
+    driver_data->coalesce_max_bytes     = coalesce_max_bytes;
+
+    /* Keep decoders of destroyed contexts around for the next context */
+    int decoder_cache_size;
+    if (getenv_int("VDPAU_VIDEO_DECODER_CACHE", &decoder_cache_size) < 0 ||
+        decoder_cache_size < 0)
+        decoder_cache_size = VDPAU_DECODER_CACHE_SIZE;
+    driver_data->decoder_cache_max_size = (uint64_t)decoder_cache_size << 20;
+
+    /* Take decoder creation off the first frame */
+    int decoder_warmup;
+    if (getenv_int("VDPAU_VIDEO_DECODER_WARMUP", &decoder_warmup) < 0 ||
+        decoder_warmup < VDPAU_DECODER_WARMUP_NONE ||
+        decoder_warmup > VDPAU_DECODER_WARMUP_THREAD)
+        decoder_warmup = VDPAU_DECODER_WARMUP;
+    driver_data->decoder_warmup = decoder_warmup;
+
+    /* Let vaEndPicture() return before VDPAU accepted the picture */
+    if (getenv_yesno("VDPAU_VIDEO_ASYNC_DECODE", &driver_data->async_decode) < 0)
+        driver_data->async_decode = 0;
+
+    /* Locate H.264 slices from start codes rather than slice parameters */
+    if (getenv_yesno("VDPAU_VIDEO_SPLIT_SLICES", &driver_data->split_slices) < 0)
+        driver_data->split_slices = 0;
+    if (driver_data->split_slices) {
+        D(bug("Using %s start code scanner\n", bitstream_get_scanner_name()));
+    }
     return VA_STATUS_SUCCESS;
 }
 
+// Decodes several pictures at once (VDPAU_EXT_decode_pictures)
+VAStatus
+vdpau_ext_DecodePictures(
+    VADisplay               dpy,
+    VADecodePictureVDPAU   *pictures,
+    unsigned int            num_pictures
+)
+{
+    static const char vendor[] =
+        VDPAU_STR_DRIVER_VENDOR " " VDPAU_STR_DRIVER_NAME;
+    VADisplayContextP const pDisplayContext = dpy;
+    VADriverContextP ctx;
+
+    if (!pDisplayContext)
+        return VA_STATUS_ERROR_INVALID_DISPLAY;
+
+    /* Make sure the display is actually driven by this driver */
+    ctx = pDisplayContext->pDriverContext;
+    if (!ctx || !ctx->pDriverData || !ctx->str_vendor ||
+        strncmp(ctx->str_vendor, vendor, sizeof(vendor) - 1) != 0)
+        return VA_STATUS_ERROR_INVALID_DISPLAY;
+
+    return vdpau_DecodePictures(ctx, pictures, num_pictures);
+}
+
 #if VA_MAJOR_VERSION == 0 && VA_MINOR_VERSION >= 31
 #define VA_INIT_VERSION_MAJOR   0
 #define VA_INIT_VERSION_MINOR   31
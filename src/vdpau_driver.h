@@ -25,6 +25,7 @@
 #include "vaapi_compat.h"
 #include "vdpau_gate.h"
 #include "object_heap.h"
+#include "upool.h"
 
 
 #define VDPAU_DRIVER_DATA_INIT                           \
@@ -44,24 +45,32 @@
 #define VDPAU_SUBPICTURE(id)            VDPAU_OBJECT(id, subpicture)
 #define VDPAU_MIXER(id)                 VDPAU_OBJECT(id, mixer)
 
-#define VDPAU_CONFIG_ID_OFFSET          0x01000000
-#define VDPAU_CONTEXT_ID_OFFSET         0x02000000
-#define VDPAU_SURFACE_ID_OFFSET         0x03000000
-#define VDPAU_BUFFER_ID_OFFSET          0x04000000
-#define VDPAU_OUTPUT_ID_OFFSET          0x05000000
-#define VDPAU_IMAGE_ID_OFFSET           0x06000000
-#define VDPAU_SUBPICTURE_ID_OFFSET      0x07000000
-#define VDPAU_GLX_SURFACE_ID_OFFSET     0x08000000
-#define VDPAU_MIXER_ID_OFFSET           0x09000000
-
-#define VDPAU_MAX_PROFILES              12
+/* Object types live in bits 27-30 of IDs (see object_heap.h) */
+#define VDPAU_CONFIG_ID_OFFSET          0x08000000
+#define VDPAU_CONTEXT_ID_OFFSET         0x10000000
+#define VDPAU_SURFACE_ID_OFFSET         0x18000000
+#define VDPAU_BUFFER_ID_OFFSET          0x20000000
+#define VDPAU_OUTPUT_ID_OFFSET          0x28000000
+#define VDPAU_IMAGE_ID_OFFSET           0x30000000
+#define VDPAU_SUBPICTURE_ID_OFFSET      0x38000000
+#define VDPAU_GLX_SURFACE_ID_OFFSET     0x40000000
+#define VDPAU_MIXER_ID_OFFSET           0x48000000
+
+#define VDPAU_MAX_PROFILES              16
 #define VDPAU_MAX_ENTRYPOINTS           5
 #define VDPAU_MAX_CONFIG_ATTRIBUTES     10
-#define VDPAU_MAX_IMAGE_FORMATS         10
+#define VDPAU_MAX_IMAGE_FORMATS         16
 #define VDPAU_MAX_SUBPICTURES           8
 #define VDPAU_MAX_SUBPICTURE_FORMATS    6
 #define VDPAU_MAX_DISPLAY_ATTRIBUTES    6
 #define VDPAU_MAX_OUTPUT_SURFACES       2
+#define VDPAU_BUFFER_POOL_SIZE          64 /* MB */
+#define VDPAU_PICTURE_ARENA_SIZE        (256 * 1024)
+#define VDPAU_GEN_SLICE_ARENA_SIZE      4096
+#define VDPAU_PICTURE_SLOTS             3
+#define VDPAU_COALESCE_MAX_BYTES        (1024 * 1024)
+#define VDPAU_DECODER_CACHE_SIZE        64 /* MB */
+#define VDPAU_DECODER_WARMUP            VDPAU_DECODER_WARMUP_SYNC
 #define VDPAU_STR_DRIVER_VENDOR         "Splitted-Desktop Systems"
 #define VDPAU_STR_DRIVER_NAME           "VDPAU backend for VA-API"
 
@@ -71,10 +80,47 @@
      (VA_CHECK_VERSION(0,31,1) ||                               \
       (VA_CHECK_VERSION(0,31,0) && VA_SDS_VERSION >= 4)))
 
+/* Check we have HEVC support in VDPAU and the necessary VAAPI extensions */
+#define USE_VDPAU_HEVC                                          \
+    (HAVE_VDPAU_HEVC && VA_CHECK_VERSION(0,35,0))
+
+/* Check we have VP9 support in VDPAU and the necessary VAAPI extensions */
+#define USE_VDPAU_VP9                                           \
+    (HAVE_VDPAU_VP9 && VA_CHECK_VERSION(0,38,0))
+
+/* Check we have AV1 support in VDPAU and the necessary VAAPI extensions */
+#define USE_VDPAU_AV1                                           \
+    (HAVE_VDPAU_AV1 && VA_CHECK_VERSION(1,8,0))
+
+/* Check we have 10-bit (P010) surfaces in VDPAU and VAAPI */
+#define USE_VDPAU_HIGH_BIT_DEPTH                                \
+    (HAVE_VDPAU_HIGH_BIT_DEPTH && VA_CHECK_VERSION(0,38,0))
+
 typedef enum {
     VDP_IMPLEMENTATION_NVIDIA = 1,
 } VdpImplementation;
 
+typedef struct vdpau_mem_stats vdpau_mem_stats_t;
+struct vdpau_mem_stats {
+    uint64_t                    num_bytes;
+    uint64_t                    max_bytes;
+    unsigned int                num_live;
+};
+
+/* Decoder creation policy at vaCreateContext() time */
+enum {
+    VDPAU_DECODER_WARMUP_NONE = 0,  /* at the first vaEndPicture() */
+    VDPAU_DECODER_WARMUP_SYNC,      /* in vaCreateContext() */
+    VDPAU_DECODER_WARMUP_THREAD     /* on a thread started by vaCreateContext() */
+};
+
+/* VA buffers whose translation is skipped when their contents repeat */
+enum {
+    VDPAU_TRANSLATED_PIC_PARAM = 0,
+    VDPAU_TRANSLATED_IQ_MATRIX,
+    VDPAU_TRANSLATED_BUFFERS
+};
+
 typedef struct vdpau_driver_data vdpau_driver_data_t;
 struct vdpau_driver_data {
     VADriverContextP            va_context;
@@ -100,6 +146,34 @@ struct vdpau_driver_data {
     uint64_t                    va_display_attrs_mtime[VDPAU_MAX_DISPLAY_ATTRIBUTES];
     unsigned int                va_display_attrs_count;
     char                        va_vendor[256];
+    UPool                      *buffer_pool;
+    unsigned int                coalesce_min_fragments;
+    unsigned int                coalesce_max_bytes;
+    int                         async_decode;
+    int                         split_slices;
+    uint64_t                    decode_batch_seq;
+    pthread_mutex_t             decoder_cache_lock;
+    pthread_mutex_t             mixer_lock;
+    int                         decoder_warmup;
+    /* Decoder cache state and counters, guarded by decoder_cache_lock */
+    struct _UList              *decoder_cache;
+    uint64_t                    decoder_cache_size;
+    uint64_t                    decoder_cache_max_size;
+    unsigned int                num_decoder_cache_hits;
+    unsigned int                num_decoder_cache_misses;
+    /* Statistics updated and read with atomic builtins */
+    unsigned int                num_coalesced_pictures;
+    unsigned int                num_first_pictures;
+    uint64_t                    first_picture_time_total;
+    uint64_t                    first_picture_time_max;
+    unsigned int                num_translations[VDPAU_TRANSLATED_BUFFERS];
+    unsigned int                num_translations_skipped[VDPAU_TRANSLATED_BUFFERS];
+    vdpau_mem_stats_t           buffer_data_stats;
+    vdpau_mem_stats_t           video_surface_stats;
+    vdpau_mem_stats_t           output_surface_stats;
+    const char                 *stats_path;
+    uint64_t                    stats_interval;
+    uint64_t                    stats_dump_time;
 };
 
 typedef struct object_config   *object_config_p;
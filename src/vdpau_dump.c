@@ -89,6 +89,9 @@ const char *string_of_VdpCodec(VdpCodec codec)
         _(MPEG4);
         _(H264);
         _(VC1);
+        _(HEVC);
+        _(VP9);
+        _(AV1);
 #undef _
     }
     return str;
@@ -305,6 +308,155 @@ void dump_VdpPictureInfoVC1(VdpPictureInfoVC1 *pic_info)
     INDENT(-1);
 }
 
+// Dumps VdpPictureInfoHEVC
+#if HAVE_VDPAU_HEVC
+void dump_VdpPictureInfoHEVC(VdpPictureInfoHEVC *pic_info)
+{
+    int i;
+
+    INDENT(1);
+    TRACE("VdpPictureInfoHEVC = {\n");
+    INDENT(1);
+    DUMPi(pic_info, chroma_format_idc);
+    DUMPi(pic_info, pic_width_in_luma_samples);
+    DUMPi(pic_info, pic_height_in_luma_samples);
+    DUMPi(pic_info, bit_depth_luma_minus8);
+    DUMPi(pic_info, bit_depth_chroma_minus8);
+    DUMPi(pic_info, log2_max_pic_order_cnt_lsb_minus4);
+    DUMPi(pic_info, sps_max_dec_pic_buffering_minus1);
+    DUMPi(pic_info, log2_min_luma_coding_block_size_minus3);
+    DUMPi(pic_info, log2_diff_max_min_luma_coding_block_size);
+    DUMPi(pic_info, scaling_list_enabled_flag);
+    DUMPi(pic_info, sample_adaptive_offset_enabled_flag);
+    DUMPi(pic_info, pcm_enabled_flag);
+    DUMPi(pic_info, num_short_term_ref_pic_sets);
+    DUMPi(pic_info, long_term_ref_pics_present_flag);
+    DUMPi(pic_info, sps_temporal_mvp_enabled_flag);
+    DUMPi(pic_info, init_qp_minus26);
+    DUMPi(pic_info, tiles_enabled_flag);
+    DUMPi(pic_info, num_tile_columns_minus1);
+    DUMPi(pic_info, num_tile_rows_minus1);
+    DUMPi(pic_info, entropy_coding_sync_enabled_flag);
+    DUMPi(pic_info, deblocking_filter_control_present_flag);
+    DUMPi(pic_info, IDRPicFlag);
+    DUMPi(pic_info, RAPPicFlag);
+    DUMPi(pic_info, CurrPicOrderCntVal);
+    DUMPi(pic_info, NumPocTotalCurr);
+    DUMPi(pic_info, NumShortTermPictureSliceHeaderBits);
+    for (i = 0; i < 16; i++) {
+        TRACE(".RefPics[%d] = { 0x%08x, %d, %d },\n", i,
+              pic_info->RefPics[i], pic_info->PicOrderCntVal[i],
+              pic_info->IsLongTerm[i]);
+    }
+    DUMPi(pic_info, NumPocStCurrBefore);
+    DUMPi(pic_info, NumPocStCurrAfter);
+    DUMPi(pic_info, NumPocLtCurr);
+    DUMPm(pic_info, ScalingList4x4, 6, 16);
+    INDENT(-1);
+    TRACE("};\n");
+    INDENT(-1);
+}
+#endif
+
+// Dumps VdpPictureInfoVP9
+#if HAVE_VDPAU_VP9
+void dump_VdpPictureInfoVP9(VdpPictureInfoVP9 *pic_info)
+{
+    INDENT(1);
+    TRACE("VdpPictureInfoVP9 = {\n");
+    INDENT(1);
+    DUMPi(pic_info, width);
+    DUMPi(pic_info, height);
+    DUMPx(pic_info, lastReference);
+    DUMPx(pic_info, goldenReference);
+    DUMPx(pic_info, altReference);
+    DUMPi(pic_info, colorSpace);
+    DUMPi(pic_info, profile);
+    DUMPi(pic_info, frameContextIdx);
+    DUMPi(pic_info, keyFrame);
+    DUMPi(pic_info, showFrame);
+    DUMPi(pic_info, errorResilient);
+    DUMPi(pic_info, frameParallelDecoding);
+    DUMPi(pic_info, intraOnly);
+    DUMPi(pic_info, allowHighPrecisionMv);
+    DUMPi(pic_info, refreshEntropyProbs);
+    DUMPi(pic_info, bitDepthMinus8Luma);
+    DUMPi(pic_info, loopFilterLevel);
+    DUMPi(pic_info, loopFilterSharpness);
+    DUMPi(pic_info, modeRefLfEnabled);
+    DUMPi(pic_info, log2TileColumns);
+    DUMPi(pic_info, log2TileRows);
+    DUMPi(pic_info, segmentEnabled);
+    DUMPi(pic_info, segmentMapUpdate);
+    DUMPi(pic_info, segmentMapTemporalUpdate);
+    DUMPi(pic_info, segmentFeatureMode);
+    DUMPi(pic_info, qpYAc);
+    DUMPi(pic_info, qpYDc);
+    DUMPi(pic_info, qpChDc);
+    DUMPi(pic_info, qpChAc);
+    TRACE(".activeRefIdx = { %d, %d, %d },\n", pic_info->activeRefIdx[0],
+          pic_info->activeRefIdx[1], pic_info->activeRefIdx[2]);
+    TRACE(".mbRefLfDelta = { %d, %d, %d, %d },\n",
+          (int)pic_info->mbRefLfDelta[0], (int)pic_info->mbRefLfDelta[1],
+          (int)pic_info->mbRefLfDelta[2], (int)pic_info->mbRefLfDelta[3]);
+    TRACE(".mbModeLfDelta = { %d, %d },\n",
+          (int)pic_info->mbModeLfDelta[0], (int)pic_info->mbModeLfDelta[1]);
+    DUMPi(pic_info, resetFrameContext);
+    DUMPi(pic_info, mcompFilterType);
+    DUMPi(pic_info, uncompressedHeaderSize);
+    DUMPi(pic_info, compressedHeaderSize);
+    INDENT(-1);
+    TRACE("};\n");
+    INDENT(-1);
+}
+#endif
+
+// Dumps VdpPictureInfoAV1
+#if HAVE_VDPAU_AV1
+void dump_VdpPictureInfoAV1(VdpPictureInfoAV1 *pic_info)
+{
+    int i;
+
+    INDENT(1);
+    TRACE("VdpPictureInfoAV1 = {\n");
+    INDENT(1);
+    DUMPi(pic_info, width);
+    DUMPi(pic_info, height);
+    DUMPi(pic_info, frame_offset);
+    DUMPi(pic_info, profile);
+    DUMPi(pic_info, bit_depth_minus8);
+    DUMPi(pic_info, frame_type);
+    DUMPi(pic_info, show_frame);
+    DUMPi(pic_info, use_superres);
+    DUMPi(pic_info, coded_denom);
+    DUMPi(pic_info, tx_mode);
+    DUMPi(pic_info, reference_mode);
+    DUMPi(pic_info, skip_mode);
+    DUMPi(pic_info, SkipModeFrame0);
+    DUMPi(pic_info, SkipModeFrame1);
+    DUMPi(pic_info, num_tile_cols);
+    DUMPi(pic_info, num_tile_rows);
+    DUMPi(pic_info, base_qindex);
+    DUMPi(pic_info, coded_lossless);
+    DUMPi(pic_info, segmentation_enabled);
+    DUMPi(pic_info, loop_filter_level[0]);
+    DUMPi(pic_info, loop_filter_level[1]);
+    DUMPi(pic_info, cdef_bits);
+    DUMPi(pic_info, apply_grain);
+    DUMPi(pic_info, random_seed);
+    DUMPx(pic_info, primary_ref_frame);
+    for (i = 0; i < 8; i++)
+        TRACE(".ref_frame_map[%d] = 0x%08x,\n", i, pic_info->ref_frame_map[i]);
+    for (i = 0; i < 7; i++)
+        TRACE(".ref_frame[%d] = { 0x%08x, %d, %d },\n", i,
+              pic_info->ref_frame[i].index, pic_info->ref_frame[i].width,
+              pic_info->ref_frame[i].height);
+    INDENT(-1);
+    TRACE("};\n");
+    INDENT(-1);
+}
+#endif
+
 // Dumps VdpBitstreamBuffer
 void dump_VdpBitstreamBuffer(VdpBitstreamBuffer *bitstream_buffer)
 {
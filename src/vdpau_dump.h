@@ -54,6 +54,24 @@ void dump_VdpPictureInfoH264(VdpPictureInfoH264 *pic_info)
 void dump_VdpPictureInfoVC1(VdpPictureInfoVC1 *pic_info)
     attribute_hidden;
 
+// Dumps VdpPictureInfoHEVC
+#if HAVE_VDPAU_HEVC
+void dump_VdpPictureInfoHEVC(VdpPictureInfoHEVC *pic_info)
+    attribute_hidden;
+#endif
+
+// Dumps VdpPictureInfoVP9
+#if HAVE_VDPAU_VP9
+void dump_VdpPictureInfoVP9(VdpPictureInfoVP9 *pic_info)
+    attribute_hidden;
+#endif
+
+// Dumps VdpPictureInfoAV1
+#if HAVE_VDPAU_AV1
+void dump_VdpPictureInfoAV1(VdpPictureInfoAV1 *pic_info)
+    attribute_hidden;
+#endif
+
 // Dumps VdpBitstreamBuffer
 void dump_VdpBitstreamBuffer(VdpBitstreamBuffer *bitstream_buffer)
     attribute_hidden;
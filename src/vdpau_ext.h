@@ -0,0 +1,92 @@
+/*
+ *  vdpau_ext.h - VDPAU backend for VA-API (driver-private extensions)
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef VDPAU_EXT_H
+#define VDPAU_EXT_H
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Extensions are advertised in the vaQueryVendorString() string, as
+ * space-separated names enclosed in brackets. Their entry points are
+ * exported by the driver and can be looked up with dlsym().
+ */
+
+/*
+ * VDPAU_EXT_decode_pictures
+ *
+ * Decodes several pictures in one call, which is equivalent to calling
+ * vaBeginPicture(), vaRenderPicture() and vaEndPicture() for each of
+ * them in order. The contexts, surfaces and buffers of the whole batch
+ * are validated before any picture is submitted, and a buffer may only
+ * appear once in the batch. Decoding stops at the first picture that
+ * fails. Its status field holds the error, and the status fields of the
+ * remaining pictures hold VA_STATUS_ERROR_UNKNOWN.
+ * As with vaRenderPicture(), buffers are destroyed once consumed.
+ */
+#define VDPAU_EXT_DECODE_PICTURES       "VDPAU_EXT_decode_pictures"
+#define VDPAU_EXT_DECODE_PICTURES_FUNC  "vdpau_ext_DecodePictures"
+
+typedef struct _VADecodePictureVDPAU {
+    VAContextID         context;
+    VASurfaceID         render_target;
+    VABufferID         *buffers;
+    int                 num_buffers;
+    VAStatus            status;         /* out */
+} VADecodePictureVDPAU;
+
+typedef VAStatus (*vdpau_ext_DecodePictures_func)(
+    VADisplay               dpy,
+    VADecodePictureVDPAU   *pictures,
+    unsigned int            num_pictures
+);
+
+VAStatus
+vdpau_ext_DecodePictures(
+    VADisplay               dpy,
+    VADecodePictureVDPAU   *pictures,
+    unsigned int            num_pictures
+);
+
+/*
+ * VDPAU_EXT_mpeg1
+ *
+ * VA-API has no MPEG-1 profile. Configs of MPEG-2 profiles created with
+ * the VAConfigAttribMPEG1VDPAU attribute set to 1 decode MPEG-1 streams
+ * instead, from the same picture, IQ matrix and slice buffers. Other
+ * configs of the same profile still decode MPEG-2.
+ * vaGetConfigAttributes() reports 1 if the VDPAU implementation decodes
+ * MPEG-1, and VA_ATTRIB_NOT_SUPPORTED otherwise, in which case
+ * vaCreateConfig() fails with VA_STATUS_ERROR_ATTR_NOT_SUPPORTED.
+ */
+#define VDPAU_EXT_MPEG1                 "VDPAU_EXT_mpeg1"
+
+/* Out of the range of VAConfigAttribType values libva defines */
+#define VAConfigAttribMPEG1VDPAU        ((VAConfigAttribType)0x10000)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VDPAU_EXT_H */
@@ -120,6 +120,8 @@ int vdpau_gate_init(vdpau_driver_data_t *driver_data)
                   decoder_render);
     VDP_INIT_PROC(DECODER_QUERY_CAPABILITIES,
                   decoder_query_capabilities);
+    VDP_INIT_PROC(VIDEO_SURFACE_QUERY_CAPABILITIES,
+                  video_surface_query_caps);
     VDP_INIT_PROC(VIDEO_SURFACE_QUERY_GET_PUT_BITS_Y_CB_CR_CAPABILITIES,
                   video_surface_query_ycbcr_caps);
     VDP_INIT_PROC(OUTPUT_SURFACE_QUERY_GET_PUT_BITS_NATIVE_CAPABILITIES,
@@ -844,6 +846,25 @@ vdpau_decoder_query_capabilities(
                         max_height);
 }
 
+// VdpVideoSurfaceQueryCapabilities
+VdpStatus
+vdpau_video_surface_query_caps(
+    vdpau_driver_data_t *driver_data,
+    VdpDevice            device,
+    VdpChromaType        surface_chroma_type,
+    VdpBool             *is_supported,
+    uint32_t            *max_width,
+    uint32_t            *max_height
+)
+{
+    return VDPAU_INVOKE(video_surface_query_caps,
+                        device,
+                        surface_chroma_type,
+                        is_supported,
+                        max_width,
+                        max_height);
+}
+
 // VdpVideoSurfaceQueryGetPutBitsYCbCrCapabilities
 VdpStatus
 vdpau_video_surface_query_ycbcr_caps(
@@ -70,6 +70,7 @@ struct vdpau_vtable {
     VdpDecoderDestroy                   *vdp_decoder_destroy;
     VdpDecoderRender                    *vdp_decoder_render;
     VdpDecoderQueryCapabilities         *vdp_decoder_query_capabilities;
+    VdpVideoSurfaceQueryCapabilities    *vdp_video_surface_query_caps;
     VdpVideoSurfaceQueryGetPutBitsYCbCrCapabilities *vdp_video_surface_query_ycbcr_caps;
     VdpOutputSurfaceQueryGetPutBitsNativeCapabilities *vdp_output_surface_query_rgba_caps;
     VdpGetApiVersion                    *vdp_get_api_version;
@@ -514,6 +515,17 @@ vdpau_decoder_query_capabilities(
     uint32_t            *max_height
 ) attribute_hidden;
 
+// VdpVideoSurfaceQueryCapabilities
+VdpStatus
+vdpau_video_surface_query_caps(
+    vdpau_driver_data_p  driver_data,
+    VdpDevice            device,
+    VdpChromaType        surface_chroma_type,
+    VdpBool             *is_supported,
+    uint32_t            *max_width,
+    uint32_t            *max_height
+) attribute_hidden;
+
 // VdpVideoSurfaceQueryGetPutBitsYCbCrCapabilities
 VdpStatus
 vdpau_video_surface_query_ycbcr_caps(
@@ -23,6 +23,7 @@
 #include "vdpau_video.h"
 #include "vdpau_buffer.h"
 #include "vdpau_mixer.h"
+#include "vdpau_stats.h"
 
 #define DEBUG 1
 #include "debug.h"
@@ -54,6 +55,9 @@ static const vdpau_image_format_map_t vdpau_image_formats_map[] = {
     DEF_YUV(YCBCR, UYVY,        ('U','Y','V','Y'), LSB, 16),
     DEF_YUV(YCBCR, YUYV,        ('Y','U','Y','V'), LSB, 16),
     DEF_YUV(YCBCR, V8U8Y8A8,    ('A','Y','U','V'), LSB, 32),
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    DEF_YUV(YCBCR, P010,        ('P','0','1','0'), LSB, 24),
+#endif
 #ifdef WORDS_BIGENDIAN
     DEF_RGB(RGBA, B8G8R8A8,     ('A','R','G','B'), MSB, 32,
             32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000),
@@ -97,6 +101,26 @@ static const vdpau_image_format_map_t *get_format(const VAImageFormat *format)
     return NULL;
 }
 
+// Checks whether VDPAU transfers the YCbCr format to/from surfaces of chroma_type
+static inline VdpBool
+is_supported_ycbcr_format(
+    vdpau_driver_data_t *driver_data,
+    VdpChromaType        chroma_type,
+    uint32_t             format
+)
+{
+    VdpBool is_supported = VDP_FALSE;
+    VdpStatus vdp_status;
+
+    vdp_status =
+        vdpau_video_surface_query_ycbcr_caps(driver_data,
+                                             driver_data->vdp_device,
+                                             chroma_type,
+                                             format,
+                                             &is_supported);
+    return vdp_status == VDP_STATUS_OK && is_supported;
+}
+
 // Checks whether the VDPAU implementation supports the specified image format
 static inline VdpBool
 is_supported_format(
@@ -110,13 +134,16 @@ is_supported_format(
 
     switch (type) {
     case VDP_IMAGE_FORMAT_TYPE_YCBCR:
-        vdp_status =
-            vdpau_video_surface_query_ycbcr_caps(driver_data,
-                                                 driver_data->vdp_device,
-                                                 VDP_CHROMA_TYPE_420,
-                                                 format,
-                                                 &is_supported);
-        break;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+        if (format == VDP_YCBCR_FORMAT_P010)
+            return is_supported_ycbcr_format(driver_data,
+                                             VDP_CHROMA_TYPE_420_16, format);
+#endif
+        /* Packed 4:2:2 formats may only be usable with 4:2:2 surfaces */
+        return (is_supported_ycbcr_format(driver_data,
+                                          VDP_CHROMA_TYPE_420, format) ||
+                is_supported_ycbcr_format(driver_data,
+                                          VDP_CHROMA_TYPE_422, format));
     case VDP_IMAGE_FORMAT_TYPE_RGBA:
         vdp_status =
             vdpau_output_surface_query_rgba_caps(driver_data,
@@ -219,6 +246,16 @@ vdpau_CreateImage(
         image->offsets[1] = size;
         image->data_size  = size + 2 * size2;
         break;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VA_FOURCC('P','0','1','0'):
+        image->num_planes = 2;
+        image->pitches[0] = width * 2;
+        image->offsets[0] = 0;
+        image->pitches[1] = width * 2;
+        image->offsets[1] = size * 2;
+        image->data_size  = (size + 2 * size2) * 2;
+        break;
+#endif
     case VA_FOURCC('Y','V','1','2'):
     case VA_FOURCC('I','4','2','0'):
         image->num_planes = 3;
@@ -234,10 +271,15 @@ vdpau_CreateImage(
     case VA_FOURCC('A','B','G','R'):
     case VA_FOURCC('B','G','R','A'):
     case VA_FOURCC('R','G','B','A'):
+        image->num_planes = 1;
+        image->pitches[0] = width * 4;
+        image->offsets[0] = 0;
+        image->data_size  = image->offsets[0] + image->pitches[0] * height;
+        break;
     case VA_FOURCC('U','Y','V','Y'):
     case VA_FOURCC('Y','U','Y','V'):
         image->num_planes = 1;
-        image->pitches[0] = width * 4;
+        image->pitches[0] = width2 * 4;
         image->offsets[0] = 0;
         image->data_size  = image->offsets[0] + image->pitches[0] * height;
         break;
@@ -317,9 +359,16 @@ vdpau_DestroyImage(
     if (!obj_image)
         return VA_STATUS_ERROR_INVALID_IMAGE;
 
-    if (obj_image->vdp_rgba_output_surface != VDP_INVALID_HANDLE)
+    if (obj_image->vdp_rgba_output_surface != VDP_INVALID_HANDLE) {
         vdpau_output_surface_destroy(driver_data,
                                      obj_image->vdp_rgba_output_surface);
+        vdpau_mem_stats_remove(
+            &driver_data->output_surface_stats,
+            vdpau_output_surface_size(obj_image->vdp_format,
+                                      obj_image->image.width,
+                                      obj_image->image.height)
+        );
+    }
 
     if (obj_image->vdp_palette) {
         free(obj_image->vdp_palette);
@@ -402,6 +451,8 @@ get_image(
     unsigned int src_stride[3];
     int i;
 
+    sync_surface_decode(driver_data, obj_surface);
+
     object_buffer_p obj_buffer = VDPAU_BUFFER(image->buf);
     if (!obj_buffer)
         return VA_STATUS_ERROR_INVALID_BUFFER;
@@ -432,6 +483,11 @@ get_image(
             obj_surface->height != rect->height)
             return VA_STATUS_ERROR_OPERATION_FAILED;
 
+        if (!is_supported_ycbcr_format(driver_data,
+                                       obj_surface->vdp_chroma_type,
+                                       obj_image->vdp_format))
+            return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
         vdp_status = vdpau_video_surface_get_bits_ycbcr(
             driver_data,
             obj_surface->vdp_surface,
@@ -452,6 +508,12 @@ get_image(
             );
             if (vdp_status != VDP_STATUS_OK)
                 return vdpau_get_VAStatus(vdp_status);
+            vdpau_mem_stats_add(
+                &driver_data->output_surface_stats,
+                vdpau_output_surface_size(obj_image->vdp_format,
+                                          obj_image->image.width,
+                                          obj_image->image.height)
+            );
         }
 
         VdpRect vdp_rect;
@@ -532,6 +594,8 @@ put_image(
     unsigned int src_stride[3];
     int i;
 
+    sync_surface_decode(driver_data, obj_surface);
+
 #if 0
     /* Don't do anything if the surface is used for rendering for example */
     /* XXX: VDPAU has no API to inform when decoding is completed... */
@@ -582,6 +646,10 @@ put_image(
     /* XXX: only support YCbCr surfaces for now */
     if (obj_image->vdp_format_type != VDP_IMAGE_FORMAT_TYPE_YCBCR)
         return VA_STATUS_ERROR_OPERATION_FAILED;
+    if (!is_supported_ycbcr_format(driver_data,
+                                   obj_surface->vdp_chroma_type,
+                                   obj_image->vdp_format))
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
 
     vdp_status = vdpau_video_surface_put_bits_ycbcr(
         driver_data,
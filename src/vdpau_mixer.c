@@ -134,26 +134,35 @@ video_mixer_create(
     return obj_mixer;
 }
 
+static int
+video_mixer_match_params(object_base_p obj, void *user_data)
+{
+    return video_mixer_check_params((object_mixer_p)obj, user_data);
+}
+
 object_mixer_p
 video_mixer_create_cached(
     vdpau_driver_data_t *driver_data,
     object_surface_p     obj_surface
 )
 {
-    object_mixer_p obj_mixer = obj_surface->video_mixer;
+    object_mixer_p obj_mixer;
 
+    /* Surfaces of any thread may share the mixer */
+    pthread_mutex_lock(&driver_data->mixer_lock);
+    obj_mixer = obj_surface->video_mixer;
+    if (!obj_mixer)
+        obj_mixer = (object_mixer_p)object_heap_foreach(
+            &driver_data->mixer_heap,
+            video_mixer_match_params,
+            obj_surface
+        );
     if (obj_mixer)
-        return video_mixer_ref(driver_data, obj_mixer);
-
-    object_heap_iterator iter;
-    object_base_p obj = object_heap_first(&driver_data->mixer_heap, &iter);
-    while (obj) {
-        obj_mixer = (object_mixer_p)obj;
-        if (video_mixer_check_params(obj_mixer, obj_surface))
-            return video_mixer_ref(driver_data, obj_mixer);
-        obj = object_heap_next(&driver_data->mixer_heap, &iter);
-    }
-    return video_mixer_create(driver_data, obj_surface);
+        ++obj_mixer->refcount;
+    else
+        obj_mixer = video_mixer_create(driver_data, obj_surface);
+    pthread_mutex_unlock(&driver_data->mixer_lock);
+    return obj_mixer;
 }
 
 void
@@ -178,8 +187,11 @@ video_mixer_ref(
     object_mixer_p       obj_mixer
 )
 {
-    if (obj_mixer)
+    if (obj_mixer) {
+        pthread_mutex_lock(&driver_data->mixer_lock);
         ++obj_mixer->refcount;
+        pthread_mutex_unlock(&driver_data->mixer_lock);
+    }
     return obj_mixer;
 }
 
@@ -189,8 +201,13 @@ video_mixer_unref(
     object_mixer_p       obj_mixer
 )
 {
-    if (obj_mixer && --obj_mixer->refcount == 0)
+    if (!obj_mixer)
+        return;
+
+    pthread_mutex_lock(&driver_data->mixer_lock);
+    if (--obj_mixer->refcount == 0)
         video_mixer_destroy(driver_data, obj_mixer);
+    pthread_mutex_unlock(&driver_data->mixer_lock);
 }
 
 static VdpStatus
@@ -384,6 +401,9 @@ video_mixer_render(
     unsigned int         flags
 )
 {
+    /* The picture must have reached VDPAU before it can be displayed */
+    sync_surface_decode(driver_data, obj_surface);
+
     VdpColorStandard vdp_colorspace;
     if (flags & VA_SRC_SMPTE_240)
         vdp_colorspace = VDP_COLOR_STANDARD_SMPTE_240M;
@@ -0,0 +1,286 @@
+/*
+ *  vdpau_stats.c - Memory and object accounting
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include <stddef.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "vdpau_stats.h"
+#include "utils.h"
+#include "ulist.h"
+
+#define DEBUG 1
+#include "debug.h"
+
+#define HEAP(name) { #name, offsetof(vdpau_driver_data_t, name##_heap) }
+
+static const struct {
+    const char *name;
+    size_t      offset;
+} heaps[] = {
+    HEAP(config),
+    HEAP(context),
+    HEAP(surface),
+    HEAP(buffer),
+    HEAP(output),
+    HEAP(image),
+    HEAP(subpicture),
+    HEAP(mixer),
+#if USE_GLX
+    HEAP(glx_surface),
+#endif
+};
+
+#undef HEAP
+
+static inline object_heap_p
+get_heap(vdpau_driver_data_t *driver_data, unsigned int i)
+{
+    return (object_heap_p)((uint8_t *)driver_data + heaps[i].offset);
+}
+
+// Accounts for an allocation of SIZE bytes
+void
+vdpau_mem_stats_add(vdpau_mem_stats_t *stats, uint64_t size)
+{
+    uint64_t num_bytes, max_bytes;
+
+    __atomic_add_fetch(&stats->num_live, 1, __ATOMIC_RELAXED);
+    num_bytes = __atomic_add_fetch(&stats->num_bytes, size, __ATOMIC_RELAXED);
+    max_bytes = __atomic_load_n(&stats->max_bytes, __ATOMIC_RELAXED);
+    while (num_bytes > max_bytes &&
+           !__atomic_compare_exchange_n(&stats->max_bytes, &max_bytes, num_bytes,
+                                        1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// Accounts for the release of an allocation of SIZE bytes
+void
+vdpau_mem_stats_remove(vdpau_mem_stats_t *stats, uint64_t size)
+{
+    __atomic_sub_fetch(&stats->num_live, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&stats->num_bytes, size, __ATOMIC_RELAXED);
+}
+
+// Returns the estimated GPU memory used by a VdpVideoSurface
+uint64_t
+vdpau_video_surface_size(
+    VdpChromaType        chroma_type,
+    unsigned int         width,
+    unsigned int         height
+)
+{
+    /* Assume 16x16 macroblock alignment, as implementations generally do */
+    const uint64_t luma_size = (uint64_t)((width + 15) & -16) * ((height + 15) & -16);
+
+    switch (chroma_type) {
+    case VDP_CHROMA_TYPE_420: return luma_size + luma_size / 2;
+    case VDP_CHROMA_TYPE_422: return luma_size * 2;
+    case VDP_CHROMA_TYPE_444: return luma_size * 3;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VDP_CHROMA_TYPE_420_16: return (luma_size + luma_size / 2) * 2;
+#endif
+    }
+    return luma_size * 3;
+}
+
+// Returns the estimated GPU memory used by a VdpOutputSurface
+uint64_t
+vdpau_output_surface_size(
+    VdpRGBAFormat        rgba_format,
+    unsigned int         width,
+    unsigned int         height
+)
+{
+    /* All VdpRGBAFormat but A8 use 32 bits per pixel */
+    const uint64_t num_pixels = (uint64_t)width * height;
+
+    if (rgba_format == VDP_RGBA_FORMAT_A8)
+        return num_pixels;
+    return num_pixels * 4;
+}
+
+static void
+dump_mem_stats(FILE *fp, const char *name, const vdpau_mem_stats_t *stats)
+{
+    fprintf(fp, "%-16s %8u %14" PRIu64 " %14" PRIu64 "\n", name,
+            __atomic_load_n(&stats->num_live, __ATOMIC_RELAXED),
+            __atomic_load_n(&stats->num_bytes, __ATOMIC_RELAXED),
+            __atomic_load_n(&stats->max_bytes, __ATOMIC_RELAXED));
+}
+
+/* Reads a counter that decode threads update with atomic adds */
+#define load_counter(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+static void
+dump_stats(vdpau_driver_data_t *driver_data, FILE *fp)
+{
+    object_heap_stats_t heap_stats;
+    unsigned int i;
+
+    fprintf(fp, "# %s statistics, pid %d, time %" PRIu64 " us\n",
+            PACKAGE_NAME, (int)getpid(), get_ticks_usec());
+
+    fprintf(fp, "%-16s %8s %8s %12s %8s %12s\n",
+            "heap", "live", "peak", "allocations", "slots", "bytes");
+    for (i = 0; i < ARRAY_ELEMS(heaps); i++) {
+        object_heap_get_stats(get_heap(driver_data, i), &heap_stats);
+        fprintf(fp, "%-16s %8d %8d %12lu %8d %12lu\n", heaps[i].name,
+                heap_stats.num_live, heap_stats.max_live,
+                heap_stats.num_allocations, heap_stats.capacity,
+                heap_stats.num_bytes);
+    }
+
+    fprintf(fp, "%-16s %8s %14s %14s\n", "memory", "live", "bytes", "peak");
+    dump_mem_stats(fp, "buffer_data",    &driver_data->buffer_data_stats);
+    dump_mem_stats(fp, "video_surface",  &driver_data->video_surface_stats);
+    dump_mem_stats(fp, "output_surface", &driver_data->output_surface_stats);
+
+    /* Only image buffers go through the pool, decode buffers live in
+       picture arenas. Blocks over 64 MB are not counted at all */
+    UPoolStats pool_stats;
+    pool_get_stats(driver_data->buffer_pool, &pool_stats);
+    fprintf(fp, "%-16s %8s %8s %8s %14s %14s\n",
+            "pool", "hits", "misses", "trimmed", "cached", "max");
+    fprintf(fp, "%-16s %8lu %8lu %8lu %14zu %14zu\n", "image_data",
+            pool_stats.num_hits, pool_stats.num_misses,
+            pool_stats.num_trimmed, pool_stats.cached_bytes,
+            pool_stats.max_cached_bytes);
+    fprintf(fp, "%-16s %8u\n", "coalesced",
+            load_counter(driver_data->num_coalesced_pictures));
+
+    /* Other threads add and evict decoders while we read the cache */
+    unsigned int cache_hits, cache_misses, cache_idle;
+    uint64_t cache_size;
+    pthread_mutex_lock(&driver_data->decoder_cache_lock);
+    cache_hits   = driver_data->num_decoder_cache_hits;
+    cache_misses = driver_data->num_decoder_cache_misses;
+    cache_idle   = list_size(driver_data->decoder_cache);
+    cache_size   = driver_data->decoder_cache_size;
+    pthread_mutex_unlock(&driver_data->decoder_cache_lock);
+    fprintf(fp, "%-16s %8s %8s %8s %14s\n",
+            "decoder_cache", "hits", "misses", "idle", "bytes");
+    fprintf(fp, "%-16s %8u %8u %8u %14" PRIu64 "\n", "",
+            cache_hits, cache_misses, cache_idle, cache_size);
+
+    fprintf(fp, "%-16s %8s %8s\n", "translation", "done", "skipped");
+    fprintf(fp, "%-16s %8u %8u\n", "pic_param",
+            load_counter(driver_data->num_translations[VDPAU_TRANSLATED_PIC_PARAM]),
+            load_counter(driver_data->num_translations_skipped[VDPAU_TRANSLATED_PIC_PARAM]));
+    fprintf(fp, "%-16s %8u %8u\n", "iq_matrix",
+            load_counter(driver_data->num_translations[VDPAU_TRANSLATED_IQ_MATRIX]),
+            load_counter(driver_data->num_translations_skipped[VDPAU_TRANSLATED_IQ_MATRIX]));
+
+    const unsigned int num_first_pictures =
+        load_counter(driver_data->num_first_pictures);
+    fprintf(fp, "%-16s %8s %14s %14s\n",
+            "first_picture", "count", "avg_us", "max_us");
+    fprintf(fp, "%-16s %8u %14" PRIu64 " %14" PRIu64 "\n", "",
+            num_first_pictures,
+            num_first_pictures ?
+            load_counter(driver_data->first_picture_time_total) /
+            num_first_pictures : 0,
+            load_counter(driver_data->first_picture_time_max));
+    fprintf(fp, "\n");
+    fflush(fp);
+}
+
+static void
+dump_stats_to_file(vdpau_driver_data_t *driver_data)
+{
+    FILE *fp;
+
+    if (!driver_data->stats_path)
+        return;
+
+    fp = fopen(driver_data->stats_path, "a");
+    if (!fp) {
+        vdpau_error_message("could not open statistics file %s\n",
+                            driver_data->stats_path);
+        driver_data->stats_path = NULL;
+        return;
+    }
+    dump_stats(driver_data, fp);
+    fclose(fp);
+}
+
+// Initializes statistics reporting from VDPAU_VIDEO_STATS* variables
+void
+vdpau_stats_init(vdpau_driver_data_t *driver_data)
+{
+    int interval;
+
+    driver_data->stats_path      = getenv("VDPAU_VIDEO_STATS");
+    driver_data->stats_interval  = 0;
+    driver_data->stats_dump_time = get_ticks_usec();
+
+    if (driver_data->stats_path && driver_data->stats_path[0] == '\0')
+        driver_data->stats_path = NULL;
+    if (getenv_int("VDPAU_VIDEO_STATS_INTERVAL", &interval) == 0 && interval > 0)
+        driver_data->stats_interval = (uint64_t)interval * 1000000;
+}
+
+// Dumps statistics to the VDPAU_VIDEO_STATS file, if the interval elapsed
+void
+vdpau_stats_dump_periodic(vdpau_driver_data_t *driver_data)
+{
+    uint64_t now, dump_time;
+
+    if (!driver_data->stats_path || !driver_data->stats_interval)
+        return;
+
+    now = get_ticks_usec();
+    dump_time = driver_data->stats_dump_time;
+    if (now < dump_time + driver_data->stats_interval)
+        return;
+
+    /* Only one thread gets to dump statistics for this interval */
+    if (!__atomic_compare_exchange_n(&driver_data->stats_dump_time, &dump_time,
+                                     now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+    dump_stats_to_file(driver_data);
+}
+
+// Dumps statistics to the VDPAU_VIDEO_STATS file and reports leaks
+void
+vdpau_stats_report(vdpau_driver_data_t *driver_data)
+{
+    object_heap_stats_t heap_stats;
+    unsigned int i;
+
+    dump_stats_to_file(driver_data);
+
+    for (i = 0; i < ARRAY_ELEMS(heaps); i++) {
+        object_heap_get_stats(get_heap(driver_data, i), &heap_stats);
+        if (heap_stats.num_live > 0)
+            vdpau_information_message("vaTerminate(): %d %s objects leaked "
+                                      "(peak %d, %lu allocations)\n",
+                                      heap_stats.num_live, heaps[i].name,
+                                      heap_stats.max_live,
+                                      heap_stats.num_allocations);
+    }
+
+    if (driver_data->buffer_data_stats.num_live > 0)
+        vdpau_information_message("vaTerminate(): %u buffer data blocks leaked "
+                                  "(%" PRIu64 " bytes)\n",
+                                  driver_data->buffer_data_stats.num_live,
+                                  driver_data->buffer_data_stats.num_bytes);
+}
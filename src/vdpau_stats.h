@@ -0,0 +1,67 @@
+/*
+ *  vdpau_stats.h - Memory and object accounting
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef VDPAU_STATS_H
+#define VDPAU_STATS_H
+
+#include "vdpau_driver.h"
+
+// Accounts for an allocation of SIZE bytes
+void
+vdpau_mem_stats_add(vdpau_mem_stats_t *stats, uint64_t size)
+    attribute_hidden;
+
+// Accounts for the release of an allocation of SIZE bytes
+void
+vdpau_mem_stats_remove(vdpau_mem_stats_t *stats, uint64_t size)
+    attribute_hidden;
+
+// Returns the estimated GPU memory used by a VdpVideoSurface
+uint64_t
+vdpau_video_surface_size(
+    VdpChromaType        chroma_type,
+    unsigned int         width,
+    unsigned int         height
+) attribute_hidden;
+
+// Returns the estimated GPU memory used by a VdpOutputSurface
+uint64_t
+vdpau_output_surface_size(
+    VdpRGBAFormat        rgba_format,
+    unsigned int         width,
+    unsigned int         height
+) attribute_hidden;
+
+// Initializes statistics reporting from VDPAU_VIDEO_STATS* variables
+void
+vdpau_stats_init(vdpau_driver_data_t *driver_data)
+    attribute_hidden;
+
+// Dumps statistics to the VDPAU_VIDEO_STATS file, if the interval elapsed
+void
+vdpau_stats_dump_periodic(vdpau_driver_data_t *driver_data)
+    attribute_hidden;
+
+// Dumps statistics to the VDPAU_VIDEO_STATS file and reports leaks
+void
+vdpau_stats_report(vdpau_driver_data_t *driver_data)
+    attribute_hidden;
+
+#endif /* VDPAU_STATS_H */
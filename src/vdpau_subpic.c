@@ -23,6 +23,7 @@
 #include "vdpau_video.h"
 #include "vdpau_image.h"
 #include "vdpau_buffer.h"
+#include "vdpau_stats.h"
 #include "utils.h"
 
 #define DEBUG 1
@@ -443,6 +444,13 @@ create_subpicture(
             obj_subpicture->height,
             &obj_subpicture->vdp_output_surface
         );
+        if (vdp_status == VDP_STATUS_OK)
+            vdpau_mem_stats_add(
+                &driver_data->output_surface_stats,
+                vdpau_output_surface_size(VDP_RGBA_FORMAT_B8G8R8A8,
+                                          obj_subpicture->width,
+                                          obj_subpicture->height)
+            );
         break;
     default:
         vdp_status = VDP_STATUS_ERROR;
@@ -499,6 +507,12 @@ destroy_subpicture(
             obj_subpicture->vdp_output_surface
         );
         obj_subpicture->vdp_output_surface = VDP_INVALID_HANDLE;
+        vdpau_mem_stats_remove(
+            &driver_data->output_surface_stats,
+            vdpau_output_surface_size(VDP_RGBA_FORMAT_B8G8R8A8,
+                                      obj_subpicture->width,
+                                      obj_subpicture->height)
+        );
     }
 
     obj_subpicture->image_id = VA_INVALID_ID;
@@ -25,6 +25,7 @@
 #include "vdpau_subpic.h"
 #include "vdpau_mixer.h"
 #include "vdpau_buffer.h"
+#include "vdpau_stats.h"
 #include "utils.h"
 
 #define DEBUG 1
@@ -42,10 +43,65 @@ static VdpChromaType get_VdpChromaType(int format)
     case VA_RT_FORMAT_YUV420: return VDP_CHROMA_TYPE_420;
     case VA_RT_FORMAT_YUV422: return VDP_CHROMA_TYPE_422;
     case VA_RT_FORMAT_YUV444: return VDP_CHROMA_TYPE_444;
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VA_RT_FORMAT_YUV420_10BPP: return VDP_CHROMA_TYPE_420_16;
+#endif
     }
     return (VdpChromaType)-1;
 }
 
+// Checks whether VDPAU video surfaces can hold chroma_type
+static int
+is_supported_chroma_type(
+    vdpau_driver_data_t *driver_data,
+    VdpChromaType        chroma_type
+)
+{
+    VdpBool is_supported = VDP_FALSE;
+    VdpStatus vdp_status;
+    uint32_t max_width, max_height;
+
+    vdp_status = vdpau_video_surface_query_caps(
+        driver_data,
+        driver_data->vdp_device,
+        chroma_type,
+        &is_supported,
+        &max_width,
+        &max_height
+    );
+    return (VDPAU_CHECK_STATUS(vdp_status, "VdpVideoSurfaceQueryCapabilities()") &&
+            is_supported);
+}
+
+// Returns the VA-API render target format decoded by profile
+static unsigned int
+get_rt_format(vdpau_driver_data_t *driver_data, VAProfile profile)
+{
+    switch (profile) {
+    case VAProfileMPEG2Main:
+        /* 4:2:2 streams are decoded through the Main profile too */
+        if (is_supported_chroma_type(driver_data, VDP_CHROMA_TYPE_422))
+            return VA_RT_FORMAT_YUV420 | VA_RT_FORMAT_YUV422;
+        break;
+#if USE_VDPAU_HEVC && USE_VDPAU_HIGH_BIT_DEPTH
+    case VAProfileHEVCMain10:
+        return VA_RT_FORMAT_YUV420_10BPP;
+#endif
+#if USE_VDPAU_VP9 && USE_VDPAU_HIGH_BIT_DEPTH
+    case VAProfileVP9Profile2:
+        return VA_RT_FORMAT_YUV420_10BPP;
+#endif
+#if USE_VDPAU_AV1 && USE_VDPAU_HIGH_BIT_DEPTH
+    case VAProfileAV1Profile0:
+        /* Main profile streams are either 8-bit or 10-bit */
+        return VA_RT_FORMAT_YUV420 | VA_RT_FORMAT_YUV420_10BPP;
+#endif
+    default:
+        break;
+    }
+    return VA_RT_FORMAT_YUV420;
+}
+
 
 /* ====================================================================== */
 /* === VA-API Implementation with VDPAU                               === */
@@ -113,7 +169,10 @@ vdpau_GetConfigAttributes(
     for (i = 0; i < num_attribs; i++) {
         switch (attrib_list[i].type) {
         case VAConfigAttribRTFormat:
-            attrib_list[i].value = VA_RT_FORMAT_YUV420;
+            attrib_list[i].value = get_rt_format(driver_data, profile);
+            break;
+        case VAConfigAttribMPEG1VDPAU:
+            attrib_list[i].value = get_mpeg1_attribute(driver_data, profile);
             break;
         default:
             attrib_list[i].value = VA_ATTRIB_NOT_SUPPORTED;
@@ -129,7 +188,7 @@ vdpau_update_attribute(object_config_p obj_config, VAConfigAttrib *attrib)
     int i;
 
     /* Check existing attrbiutes */
-    for (i = 0; obj_config->attrib_count < i; i++) {
+    for (i = 0; i < obj_config->attrib_count; i++) {
         if (obj_config->attrib_list[i].type == attrib->type) {
             /* Update existing attribute */
             obj_config->attrib_list[i].value = attrib->value;
@@ -189,11 +248,17 @@ vdpau_CreateConfig(
     obj_config->profile = profile;
     obj_config->entrypoint = entrypoint;
     obj_config->attrib_list[0].type = VAConfigAttribRTFormat;
-    obj_config->attrib_list[0].value = VA_RT_FORMAT_YUV420;
+    obj_config->attrib_list[0].value = get_rt_format(driver_data, profile);
     obj_config->attrib_count = 1;
 
     for(i = 0; i < num_attribs; i++) {
-        va_status = vdpau_update_attribute(obj_config, &attrib_list[i]);
+        /* MPEG-1 decoding must be available for that profile */
+        if (attrib_list[i].type == VAConfigAttribMPEG1VDPAU &&
+            attrib_list[i].value != 0 &&
+            attrib_list[i].value != get_mpeg1_attribute(driver_data, profile))
+            va_status = VA_STATUS_ERROR_ATTR_NOT_SUPPORTED;
+        else
+            va_status = vdpau_update_attribute(obj_config, &attrib_list[i]);
         if (va_status != VA_STATUS_SUCCESS) {
             vdpau_DestroyConfig(ctx, configID);
             return va_status;
@@ -326,9 +391,33 @@ vdpau_DestroySurfaces(
         if (!obj_surface)
             continue;
 
+        const VAContextID context = surface_get_context(obj_surface);
+        object_context_p obj_context = VDPAU_CONTEXT(context);
+        if (obj_context) {
+            const unsigned int index =
+                obj_surface->base.id & OBJECT_HEAP_INDEX_MASK;
+            pthread_mutex_lock(&obj_context->lock);
+            if (context_is_alive(driver_data, obj_context, context)) {
+                if (index < obj_context->surface_map_size &&
+                    obj_context->surface_map[index].va_surface == obj_surface->base.id)
+                    obj_context->surface_map[index].va_surface = VA_INVALID_ID;
+
+                /* Picture parameters may reference that surface */
+                obj_context->translated_buffers[VDPAU_TRANSLATED_PIC_PARAM].size = 0;
+            }
+            pthread_mutex_unlock(&obj_context->lock);
+        }
+
         if (obj_surface->vdp_surface != VDP_INVALID_HANDLE) {
+            sync_surface_decode(driver_data, obj_surface);
             vdpau_video_surface_destroy(driver_data, obj_surface->vdp_surface);
             obj_surface->vdp_surface = VDP_INVALID_HANDLE;
+            vdpau_mem_stats_remove(
+                &driver_data->video_surface_stats,
+                vdpau_video_surface_size(obj_surface->vdp_chroma_type,
+                                         obj_surface->width,
+                                         obj_surface->height)
+            );
         }
 
         for (j = 0; j < obj_surface->output_surfaces_count; j++) {
@@ -396,9 +485,19 @@ vdpau_CreateSurfaces(
     VdpStatus vdp_status;
     int i;
 
-    /* We only support one format */
-    if (format != VA_RT_FORMAT_YUV420)
+    switch (format) {
+    case VA_RT_FORMAT_YUV420:
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    case VA_RT_FORMAT_YUV420_10BPP:
+#endif
+        break;
+    case VA_RT_FORMAT_YUV422:
+        if (!is_supported_chroma_type(driver_data, vdp_chroma_type))
+            return VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT;
+        break;
+    default:
         return VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT;
+    }
 
     for (i = 0; i < num_surfaces; i++) {
         vdp_status = vdpau_video_surface_create(
@@ -424,6 +523,10 @@ vdpau_CreateSurfaces(
         obj_surface->vdp_surface                = vdp_surface;
         obj_surface->width                      = width;
         obj_surface->height                     = height;
+        obj_surface->decode_seq                 = 0;
+        obj_surface->frame_width                = width;
+        obj_surface->frame_height               = height;
+        obj_surface->order_hint                 = 0;
         obj_surface->assocs                     = NULL;
         obj_surface->assocs_count               = 0;
         obj_surface->assocs_count_max           = 0;
@@ -435,6 +538,11 @@ vdpau_CreateSurfaces(
         surfaces[i]                             = va_surface;
         vdp_surface                             = VDP_INVALID_HANDLE;
 
+        vdpau_mem_stats_add(
+            &driver_data->video_surface_stats,
+            vdpau_video_surface_size(vdp_chroma_type, width, height)
+        );
+
         object_mixer_p obj_mixer;
         obj_mixer = video_mixer_create_cached(driver_data, obj_surface);
         if (!obj_mixer) {
@@ -453,32 +561,37 @@ vdpau_CreateSurfaces(
     return va_status;
 }
 
-// vaDestroyContext
-VAStatus vdpau_DestroyContext(VADriverContextP ctx, VAContextID context)
+// Check whether context still designates obj_context, with its lock held
+int
+context_is_alive(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    VAContextID          context
+)
 {
-    VDPAU_DRIVER_DATA_INIT;
-    int i;
-
-    object_context_p obj_context = VDPAU_CONTEXT(context);
-    if (!obj_context)
-        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    /* destroy_context() clears context_id before it drops the lock, and
+       only frees the object afterwards */
+    return (VDPAU_CONTEXT(context) == obj_context &&
+            obj_context->context_id == context);
+}
 
-    if (obj_context->gen_slice_data) {
-        free(obj_context->gen_slice_data);
-        obj_context->gen_slice_data = NULL;
-        obj_context->gen_slice_data_size = 0;
-        obj_context->gen_slice_data_size_max = 0;
-    }
+// Destroy context, its decode worker and everything it still holds
+void
+destroy_context(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+)
+{
+    int i;
 
-    if (obj_context->vdp_bitstream_buffers) {
-        free(obj_context->vdp_bitstream_buffers);
-        obj_context->vdp_bitstream_buffers = NULL;
-        obj_context->vdp_bitstream_buffers_count = 0;
-        obj_context->vdp_bitstream_buffers_count_max = 0;
-    }
+    /* Wait for any decode call still running on another thread */
+    pthread_mutex_lock(&obj_context->lock);
+    decode_worker_destroy(obj_context);
+    decoder_warmup_wait(obj_context);
+    destroy_picture_slots(driver_data, obj_context);
 
     if (obj_context->vdp_decoder != VDP_INVALID_HANDLE) {
-        vdpau_decoder_destroy(driver_data, obj_context->vdp_decoder);
+        decoder_cache_release(driver_data, obj_context);
         obj_context->vdp_decoder = VDP_INVALID_HANDLE;
     }
 
@@ -487,18 +600,35 @@ VAStatus vdpau_DestroyContext(VADriverContextP ctx, VAContextID context)
         free(obj_context->dead_buffers);
         obj_context->dead_buffers = NULL;
     }
+    destroy_picture_arenas(driver_data, obj_context);
 
     if (obj_context->render_targets) {
         for (i = 0; i < obj_context->num_render_targets; i++) {
             object_surface_p obj_surface;
             obj_surface = VDPAU_SURFACE(obj_context->render_targets[i]);
-            if (obj_surface)
-                obj_surface->va_context = VA_INVALID_ID;
+            if (obj_surface) {
+                surface_set_context(obj_surface, VA_INVALID_ID);
+                obj_surface->decode_seq = 0;
+            }
         }
         free(obj_context->render_targets);
         obj_context->render_targets = NULL;
     }
 
+    if (obj_context->surface_map) {
+        free(obj_context->surface_map);
+        obj_context->surface_map = NULL;
+        obj_context->surface_map_size = 0;
+    }
+
+    for (i = 0; i < VDPAU_TRANSLATED_BUFFERS; i++) {
+        translated_buffer_t * const tb = &obj_context->translated_buffers[i];
+        free(tb->data);
+        tb->data     = NULL;
+        tb->size     = 0;
+        tb->size_max = 0;
+    }
+
     obj_context->context_id             = VA_INVALID_ID;
     obj_context->config_id              = VA_INVALID_ID;
     obj_context->current_render_target  = VA_INVALID_SURFACE;
@@ -509,7 +639,20 @@ VAStatus vdpau_DestroyContext(VADriverContextP ctx, VAContextID context)
     obj_context->dead_buffers_count     = 0;
     obj_context->dead_buffers_count_max = 0;
 
+    pthread_mutex_unlock(&obj_context->lock);
     object_heap_free(&driver_data->context_heap, (object_base_p)obj_context);
+}
+
+// vaDestroyContext
+VAStatus vdpau_DestroyContext(VADriverContextP ctx, VAContextID context)
+{
+    VDPAU_DRIVER_DATA_INIT;
+
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (!obj_context)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+
+    destroy_context(driver_data, obj_context);
     return VA_STATUS_SUCCESS;
 }
 
@@ -540,7 +683,7 @@ vdpau_CreateContext(
     VdpDecoderProfile vdp_profile;
     uint32_t max_width, max_height;
     int i;
-    vdp_profile = get_VdpDecoderProfile(obj_config->profile);
+    vdp_profile = get_config_VdpDecoderProfile(obj_config);
     if (!get_max_surface_size(driver_data, vdp_profile, &max_width, &max_height))
         return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
     if (picture_width > max_width || picture_height > max_height)
@@ -556,6 +699,14 @@ vdpau_CreateContext(
     if (context)
         *context = context_id;
 
+    if (!obj_context->is_lock_initialized) {
+        pthread_mutex_init(&obj_context->lock, NULL);
+        obj_context->is_lock_initialized = 1;
+    }
+
+    /* Threads that looked up the previous context in this slot may still
+       check it with the lock held */
+    pthread_mutex_lock(&obj_context->lock);
     obj_context->context_id             = context_id;
     obj_context->config_id              = config_id;
     obj_context->current_render_target  = VA_INVALID_SURFACE;
@@ -566,24 +717,68 @@ vdpau_CreateContext(
     obj_context->max_ref_frames         = -1;
     obj_context->render_targets         = (VASurfaceID *)
         calloc(num_render_targets, sizeof(VASurfaceID));
+    obj_context->surface_map            = NULL;
+    obj_context->surface_map_size       = 0;
+    memset(obj_context->translated_buffers, 0,
+           sizeof(obj_context->translated_buffers));
     obj_context->dead_buffers           = NULL;
     obj_context->dead_buffers_count     = 0;
     obj_context->dead_buffers_count_max = 0;
     obj_context->vdp_codec              = get_VdpCodec(vdp_profile);
+    obj_context->decode_backend         = get_decode_backend(obj_context->vdp_codec);
     obj_context->vdp_profile            = vdp_profile;
     obj_context->vdp_decoder            = VDP_INVALID_HANDLE;
-    obj_context->gen_slice_data = NULL;
-    obj_context->gen_slice_data_size = 0;
-    obj_context->gen_slice_data_size_max = 0;
-    obj_context->vdp_bitstream_buffers = NULL;
-    obj_context->vdp_bitstream_buffers_count = 0;
-    obj_context->vdp_bitstream_buffers_count_max = 0;
+    obj_context->picture_arena          = NULL;
+    obj_context->spare_picture_arena    = NULL;
+    obj_context->slice_count            = 0;
+    obj_context->split_slice_count      = 0;
+    obj_context->max_slice_count        = 0;
+    obj_context->decode_worker          = NULL;
+    obj_context->warmup_pending         = 0;
+    obj_context->picture_count          = 0;
+    obj_context->first_picture_time     = 0;
+    obj_context->picture_slot           = &obj_context->picture_slots[0];
+    obj_context->picture_slot_index     = 0;
+    memset(obj_context->picture_slots, 0,
+           sizeof(obj_context->picture_slots));
+    pthread_mutex_unlock(&obj_context->lock);
 
     if (!obj_context->render_targets) {
         vdpau_DestroyContext(ctx, context_id);
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
 
+    if (!obj_context->decode_backend) {
+        vdpau_DestroyContext(ctx, context_id);
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    }
+
+    decoder_warmup(driver_data, obj_context);
+
+    if (driver_data->async_decode &&
+        decode_worker_create(driver_data, obj_context) < 0) {
+        vdpau_DestroyContext(ctx, context_id);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    /* Reference frames are render targets, so resolve them through a
+       table indexed like the surface heap */
+    for (i = 0; i < num_render_targets; i++) {
+        const unsigned int index = render_targets[i] & OBJECT_HEAP_INDEX_MASK;
+        if (obj_context->surface_map_size <= index)
+            obj_context->surface_map_size = index + 1;
+    }
+    obj_context->surface_map = malloc(obj_context->surface_map_size *
+                                      sizeof(*obj_context->surface_map));
+    if (!obj_context->surface_map && obj_context->surface_map_size > 0) {
+        vdpau_DestroyContext(ctx, context_id);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    for (i = 0; i < obj_context->surface_map_size; i++) {
+        obj_context->surface_map[i].va_surface  = VA_INVALID_ID;
+        obj_context->surface_map[i].vdp_surface = VDP_INVALID_HANDLE;
+    }
+
     for (i = 0; i < num_render_targets; i++) {
         object_surface_t *obj_surface;
         if ((obj_surface = VDPAU_SURFACE(render_targets[i])) == NULL) {
@@ -591,10 +786,24 @@ vdpau_CreateContext(
             return VA_STATUS_ERROR_INVALID_SURFACE;
         }
         obj_context->render_targets[i] = render_targets[i];
+        context_surface_map_t * const m = &obj_context->surface_map[
+            render_targets[i] & OBJECT_HEAP_INDEX_MASK];
+        m->va_surface  = render_targets[i];
+        m->vdp_surface = obj_surface->vdp_surface;
+    }
+
+    /* Binding the render targets comes last, as it is what makes the
+       context visible to threads syncing these surfaces */
+    for (i = 0; i < num_render_targets; i++) {
+        object_surface_p obj_surface = VDPAU_SURFACE(render_targets[i]);
+        /* Sequence numbers are only meaningful to the decode worker of
+           the context that issued them */
+        obj_surface->decode_seq = 0;
         /* XXX: assume we can only associate a surface to a single context */
-        ASSERT(obj_surface->va_context == VA_INVALID_ID);
-        obj_surface->va_context = context_id;
+        ASSERT(surface_get_context(obj_surface) == VA_INVALID_ID);
+        surface_set_context(obj_surface, context_id);
     }
+
     return VA_STATUS_SUCCESS;
 }
 
@@ -608,6 +817,12 @@ query_surface_status(
 {
     VAStatus va_status = VA_STATUS_SUCCESS;
 
+    if (surface_decode_pending(driver_data, obj_surface)) {
+        if (status)
+            *status = VASurfaceRendering;
+        return VA_STATUS_SUCCESS;
+    }
+
     if (obj_surface->va_surface_status == VASurfaceDisplaying) {
         unsigned int i, num_output_surfaces_displaying = 0;
         for (i = 0; i < obj_surface->output_surfaces_count; i++) {
@@ -670,6 +885,9 @@ sync_surface(
     object_surface_p     obj_surface
 )
 {
+    /* Wait for the picture to reach VDPAU, if it was queued */
+    sync_surface_decode(driver_data, obj_surface);
+
     /* VDPAU only supports status interface for in-progress display */
     /* XXX: polling is bad but there currently is no alternative */
     for (;;) {
@@ -691,6 +909,25 @@ sync_surface(
     return VA_STATUS_SUCCESS;
 }
 
+// Check whether the surface is the one being decoded by the context
+static int
+is_current_render_target(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    VAContextID          context,
+    object_surface_p     obj_surface
+)
+{
+    int is_current;
+
+    pthread_mutex_lock(&obj_context->lock);
+    is_current = (context_is_alive(driver_data, obj_context, context) &&
+                  obj_context->current_render_target == obj_surface->base.id);
+    pthread_mutex_unlock(&obj_context->lock);
+    ASSERT(!is_current);
+    return is_current;
+}
+
 // vaSyncSurface
 VAStatus
 vdpau_SyncSurface2(
@@ -705,12 +942,11 @@ vdpau_SyncSurface2(
         return VA_STATUS_ERROR_INVALID_SURFACE;
 
     /* Assume that this shouldn't be called before vaEndPicture() */
-    object_context_p obj_context = VDPAU_CONTEXT(obj_surface->va_context);
-    if (obj_context) {
-        ASSERT(obj_context->current_render_target != obj_surface->base.id);
-        if (obj_context->current_render_target == obj_surface->base.id)
-            return VA_STATUS_ERROR_INVALID_CONTEXT;
-    }
+    const VAContextID context = surface_get_context(obj_surface);
+    object_context_p obj_context = VDPAU_CONTEXT(context);
+    if (obj_context &&
+        is_current_render_target(driver_data, obj_context, context, obj_surface))
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
 
     return sync_surface(driver_data, obj_surface);
 }
@@ -730,11 +966,9 @@ vdpau_SyncSurface3(
 
     /* Assume that this shouldn't be called before vaEndPicture() */
     object_context_p obj_context = VDPAU_CONTEXT(context);
-    if (obj_context) {
-        ASSERT(obj_context->current_render_target != obj_surface->base.id);
-        if (obj_context->current_render_target == obj_surface->base.id)
-            return VA_STATUS_ERROR_INVALID_CONTEXT;
-    }
+    if (obj_context &&
+        is_current_render_target(driver_data, obj_context, context, obj_surface))
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
     return sync_surface(driver_data, obj_surface);
 }
 
@@ -23,6 +23,7 @@
 
 #include "vdpau_driver.h"
 #include "vdpau_decode.h"
+#include <pthread.h>
 
 typedef struct SubpictureAssociation *SubpictureAssociationP;
 struct SubpictureAssociation {
@@ -42,9 +43,65 @@ struct object_config {
     int                          attrib_count;
 };
 
+typedef union vdpau_picture_info vdpau_picture_info_t;
+union vdpau_picture_info {
+    VdpPictureInfoMPEG1Or2       mpeg2;
+#if HAVE_VDPAU_MPEG4
+    VdpPictureInfoMPEG4Part2     mpeg4;
+#endif
+    VdpPictureInfoH264           h264;
+    VdpPictureInfoVC1            vc1;
+#if HAVE_VDPAU_HEVC
+    VdpPictureInfoHEVC           hevc;
+#endif
+#if HAVE_VDPAU_VP9
+    VdpPictureInfoVP9            vp9;
+#endif
+#if HAVE_VDPAU_AV1
+    VdpPictureInfoAV1            av1;
+#endif
+};
+
+typedef struct context_surface_map context_surface_map_t;
+struct context_surface_map {
+    VASurfaceID                  va_surface;
+    VdpVideoSurface              vdp_surface;
+};
+
+typedef struct translated_buffer translated_buffer_t;
+struct translated_buffer {
+    void                        *data;
+    unsigned int                 size;
+    unsigned int                 size_max;
+};
+
+/* Per-picture decode state. With VDPAU_VIDEO_ASYNC_DECODE, a context
+   cycles through VDPAU_PICTURE_SLOTS of them so that the next picture
+   can be translated while the decode worker submits the previous ones */
+typedef struct picture_slot picture_slot_t;
+struct picture_slot {
+    vdpau_picture_info_t         vdp_picture_info;
+    VdpBitstreamBuffer          *vdp_bitstream_buffers;
+    unsigned int                 vdp_bitstream_buffers_count;
+    unsigned int                 vdp_bitstream_buffers_count_max;
+    struct _UArena              *gen_slice_arena;
+    uint8_t                     *coalesce_buffer;
+    unsigned int                 coalesce_buffer_size_max;
+    /* Set while the slot is queued to the decode worker */
+    VdpDecoder                   vdp_decoder;
+    VdpVideoSurface              vdp_surface;
+    struct picture_arena        *picture_arena;
+    uint64_t                     decode_seq;
+};
+
 typedef struct object_context object_context_t;
 struct object_context {
     struct object_base           base;
+    /* Serializes the decode calls made on this context (see README).
+       It lives as long as the heap slot, not the context, since a thread
+       may still wait on it after vaDestroyContext() */
+    pthread_mutex_t              lock;
+    int                          is_lock_initialized;
     VAContextID                  context_id;
     VAConfigID                   config_id;
     VASurfaceID                  current_render_target;
@@ -54,6 +111,8 @@ struct object_context {
     int                          flags;
     int                          max_ref_frames;
     VASurfaceID                 *render_targets;
+    context_surface_map_t       *surface_map;
+    unsigned int                 surface_map_size;
     VABufferID                  *dead_buffers;
     uint32_t                     dead_buffers_count;
     uint32_t                     dead_buffers_count_max;
@@ -61,22 +120,23 @@ struct object_context {
     void                        *last_slice_params;
     unsigned int                 last_slice_params_count;
     VdpCodec                     vdp_codec;
+    const decode_backend_t      *decode_backend;
+    translated_buffer_t          translated_buffers[VDPAU_TRANSLATED_BUFFERS];
     VdpDecoderProfile            vdp_profile;
     VdpDecoder                   vdp_decoder;
-    uint8_t                     *gen_slice_data;
-    unsigned int                 gen_slice_data_size;
-    unsigned int                 gen_slice_data_size_max;
-    VdpBitstreamBuffer          *vdp_bitstream_buffers;
-    unsigned int                 vdp_bitstream_buffers_count;
-    unsigned int                 vdp_bitstream_buffers_count_max;
-    union {
-        VdpPictureInfoMPEG1Or2   mpeg2;
-#if HAVE_VDPAU_MPEG4
-        VdpPictureInfoMPEG4Part2 mpeg4;
-#endif
-        VdpPictureInfoH264       h264;
-        VdpPictureInfoVC1        vc1;
-    }                            vdp_picture_info;
+    struct picture_arena        *picture_arena;
+    struct picture_arena        *spare_picture_arena;
+    unsigned int                 slice_count;
+    unsigned int                 split_slice_count;
+    unsigned int                 max_slice_count;
+    struct decode_worker        *decode_worker;
+    pthread_t                    warmup_thread;
+    unsigned int                 warmup_pending;
+    unsigned int                 picture_count;
+    uint64_t                     first_picture_time;
+    picture_slot_t              *picture_slot;
+    unsigned int                 picture_slot_index;
+    picture_slot_t               picture_slots[VDPAU_PICTURE_SLOTS];
 };
 
 typedef struct object_surface object_surface_t;
@@ -92,6 +152,11 @@ struct object_surface {
     unsigned int                 width;
     unsigned int                 height;
     VdpChromaType                vdp_chroma_type;
+    uint64_t                     decode_seq;
+    /* Frame size and order hint of the last AV1 picture decoded into it */
+    unsigned int                 frame_width;
+    unsigned int                 frame_height;
+    unsigned int                 order_hint;
     SubpictureAssociationP      *assocs;
     unsigned int                 assocs_count;
     unsigned int                 assocs_count_max;
@@ -197,6 +262,36 @@ vdpau_CreateContext(
     VAContextID        *context
 ) attribute_hidden;
 
+// Check whether context still designates obj_context, with its lock held
+int
+context_is_alive(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context,
+    VAContextID          context
+) attribute_hidden;
+
+// Get the context surface is bound to, which vaCreateContext() and
+// vaDestroyContext() may change from another thread
+static inline VAContextID
+surface_get_context(object_surface_p obj_surface)
+{
+    return __atomic_load_n(&obj_surface->va_context, __ATOMIC_ACQUIRE);
+}
+
+// Bind surface to context, or unbind it with VA_INVALID_ID
+static inline void
+surface_set_context(object_surface_p obj_surface, VAContextID context)
+{
+    __atomic_store_n(&obj_surface->va_context, context, __ATOMIC_RELEASE);
+}
+
+// Destroy context, its decode worker and everything it still holds
+void
+destroy_context(
+    vdpau_driver_data_t *driver_data,
+    object_context_p     obj_context
+) attribute_hidden;
+
 // vaDestroyContext
 VAStatus
 vdpau_DestroyContext(
@@ -23,6 +23,7 @@
 #include "vdpau_video_x11.h"
 #include "vdpau_subpic.h"
 #include "vdpau_mixer.h"
+#include "vdpau_stats.h"
 #include "utils.h"
 #include "utils_x11.h"
 
@@ -104,6 +105,21 @@ output_surface_unlock(object_output_p obj_output)
 {
 }
 
+// Accounts for the release of one of the output surface VDPAU surfaces
+static inline void
+output_surface_stats_remove(
+    vdpau_driver_data_t *driver_data,
+    object_output_p      obj_output
+)
+{
+    vdpau_mem_stats_remove(
+        &driver_data->output_surface_stats,
+        vdpau_output_surface_size(VDP_RGBA_FORMAT_B8G8R8A8,
+                                  obj_output->max_width,
+                                  obj_output->max_height)
+    );
+}
+
 // Ensure output surface size matches drawable size
 int
 output_surface_ensure_size(
@@ -120,8 +136,6 @@ output_surface_ensure_size(
 
     if (width > obj_output->max_width || height > obj_output->max_height) {
         const unsigned int max_waste = 1U << 8;
-        obj_output->max_width        = (width  + max_waste - 1) & -max_waste;
-        obj_output->max_height       = (height + max_waste - 1) & -max_waste;
 
         for (i = 0; i < VDPAU_MAX_OUTPUT_SURFACES; i++) {
             if (obj_output->vdp_output_surfaces[i] != VDP_INVALID_HANDLE) {
@@ -131,8 +145,12 @@ output_surface_ensure_size(
                 );
                 obj_output->vdp_output_surfaces[i] = VDP_INVALID_HANDLE;
                 obj_output->vdp_output_surfaces_dirty[i] = 0;
+                output_surface_stats_remove(driver_data, obj_output);
             }
         }
+
+        obj_output->max_width        = (width  + max_waste - 1) & -max_waste;
+        obj_output->max_height       = (height + max_waste - 1) & -max_waste;
     }
 
     obj_output->size_changed = (
@@ -158,6 +176,12 @@ output_surface_ensure_size(
         );
         if (!VDPAU_CHECK_STATUS(vdp_status, "VdpOutputSurfaceCreate()"))
             return -1;
+        vdpau_mem_stats_add(
+            &driver_data->output_surface_stats,
+            vdpau_output_surface_size(VDP_RGBA_FORMAT_B8G8R8A8,
+                                      obj_output->max_width,
+                                      obj_output->max_height)
+        );
     }
     return 0;
 }
@@ -264,6 +288,7 @@ output_surface_destroy(
         if (vdp_output_surface != VDP_INVALID_HANDLE) {
             vdpau_output_surface_destroy(driver_data, vdp_output_surface);
             obj_output->vdp_output_surfaces[i] = VDP_INVALID_HANDLE;
+            output_surface_stats_remove(driver_data, obj_output);
         }
     }
 
@@ -321,6 +346,12 @@ output_surface_lookup(object_surface_p obj_surface, Drawable drawable)
     return NULL;
 }
 
+static int
+output_surface_match_drawable(object_base_p obj, void *user_data)
+{
+    return ((object_output_p)obj)->drawable == *(Drawable *)user_data;
+}
+
 // Ensure an output surface is created for the specified surface and drawable
 static object_output_p
 output_surface_ensure(
@@ -342,16 +373,14 @@ output_surface_ensure(
 
     /* ... that might have been created for another video surface */
     if (!obj_output) {
-        object_heap_iterator iter;
-        object_base_p obj = object_heap_first(&driver_data->output_heap, &iter);
-        while (obj) {
-            object_output_p m = (object_output_p)obj;
-            if (m->drawable == drawable) {
-                obj_output = output_surface_ref(driver_data, m);
-                new_obj_output = 1;
-                break;
-            }
-            obj = object_heap_next(&driver_data->output_heap, &iter);
+        obj_output = (object_output_p)object_heap_foreach(
+            &driver_data->output_heap,
+            output_surface_match_drawable,
+            &drawable
+        );
+        if (obj_output) {
+            obj_output = output_surface_ref(driver_data, obj_output);
+            new_obj_output = 1;
         }
     }
 
@@ -0,0 +1,192 @@
+/*
+ *  bench_coalesce.c - Bitstream submission with and without coalescing
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Decodes MPEG-2 pictures of NUM_SLICES slices whose data lacks start
+ * codes, so that each slice reaches VdpDecoderRender() as three
+ * fragments: start code, slice header byte and payload. The stand-in
+ * VdpDecoderRender() copies every fragment into a staging buffer, as a
+ * VDPAU implementation has to before handing the bitstream to the
+ * hardware. Pictures are submitted as they are, then coalesced into a
+ * single fragment with VDPAU_VIDEO_COALESCE.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "utils.h"
+
+#define NUM_SURFACES            2
+#define NUM_SLICES              200
+#define NUM_PICTURES            2000
+#define PICTURE_WIDTH           1920
+#define PICTURE_HEIGHT          1088
+#define MAX_SLICE_SIZE          1024
+
+typedef struct bench_stream bench_stream_t;
+struct bench_stream {
+    VADriverContextP            ctx;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+static uint8_t      staging_buffer[NUM_SLICES * (MAX_SLICE_SIZE + 4)];
+static unsigned int num_fragments;
+
+// Copies the bitstream into the staging buffer
+static void
+render_hook(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    uint8_t *dst = staging_buffer;
+    unsigned int i;
+
+    for (i = 0; i < bitstream_buffer_count; i++) {
+        memcpy(dst, bitstream_buffers[i].bitstream,
+               bitstream_buffers[i].bitstream_bytes);
+        dst += bitstream_buffers[i].bitstream_bytes;
+    }
+    num_fragments += bitstream_buffer_count;
+}
+
+static int
+decode_picture(bench_stream_t *bs, unsigned int n, unsigned int slice_size,
+               uint64_t *elapsed)
+{
+    static uint8_t slice_data[NUM_SLICES * MAX_SLICE_SIZE];
+    VAPictureParameterBufferMPEG2 pic_param;
+    VASliceParameterBufferMPEG2 slice_params[NUM_SLICES];
+    VABufferID buffers[3];
+    unsigned int i;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(slice_params, 0, sizeof(slice_params));
+    for (i = 0; i < NUM_SLICES; i++) {
+        slice_params[i].slice_data_size         = slice_size;
+        slice_params[i].slice_data_offset       = i * slice_size;
+        slice_params[i].slice_vertical_position = i % (PICTURE_HEIGHT / 16);
+    }
+    memset(slice_data, 0x42, NUM_SLICES * slice_size);
+
+    buffers[0] = test_create_buffer(bs->ctx, bs->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    if (vdpau_CreateBuffer(bs->ctx, bs->context, VASliceParameterBufferType,
+                           sizeof(slice_params[0]), NUM_SLICES, slice_params,
+                           &buffers[1]) != VA_STATUS_SUCCESS)
+        buffers[1] = VA_INVALID_BUFFER;
+    buffers[2] = test_create_buffer(bs->ctx, bs->context,
+                                    VASliceDataBufferType,
+                                    NUM_SLICES * slice_size, slice_data);
+    for (i = 0; i < ARRAY_ELEMS(buffers); i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    const uint64_t start = get_ticks_usec();
+    TEST_CHECK_STATUS(vdpau_BeginPicture(bs->ctx, bs->context,
+                                         bs->surfaces[n % NUM_SURFACES]));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(bs->ctx, bs->context,
+                                          buffers, ARRAY_ELEMS(buffers)));
+    TEST_CHECK_STATUS(vdpau_EndPicture(bs->ctx, bs->context));
+    *elapsed += get_ticks_usec() - start;
+    return 0;
+}
+
+static int
+run_stream(test_driver_t *driver, unsigned int slice_size, double *picture_time)
+{
+    bench_stream_t bs;
+    uint64_t elapsed = 0;
+    unsigned int i;
+
+    bs.ctx = &driver->ctx;
+    TEST_CHECK_STATUS(vdpau_CreateConfig(bs.ctx, VAProfileMPEG2Main,
+                                         VAEntrypointVLD, NULL, 0, &bs.config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(bs.ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           VA_RT_FORMAT_YUV420, NUM_SURFACES,
+                                           bs.surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(bs.ctx, bs.config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          bs.surfaces, NUM_SURFACES,
+                                          &bs.context));
+
+    num_fragments = 0;
+    for (i = 0; i < NUM_PICTURES; i++)
+        TEST_CHECK(decode_picture(&bs, i, slice_size, &elapsed) == 0);
+    *picture_time = (double)elapsed / NUM_PICTURES;
+
+    TEST_CHECK_STATUS(vdpau_DestroyContext(bs.ctx, bs.context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(bs.ctx, bs.surfaces, NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(bs.ctx, bs.config));
+    return 0;
+}
+
+static int
+run_bench(int coalesce, unsigned int slice_size, double *picture_time)
+{
+    test_driver_t driver;
+
+    if (coalesce)
+        setenv("VDPAU_VIDEO_COALESCE", "2", 1);
+    else
+        unsetenv("VDPAU_VIDEO_COALESCE");
+    fake_vdpau_reset();
+    fake_vdpau_set_render_hook(render_hook, NULL);
+    TEST_CHECK(test_driver_open(&driver) == 0);
+    TEST_CHECK(run_stream(&driver, slice_size, picture_time) == 0);
+    test_driver_close(&driver);
+
+    printf("  %-11s %4u fragments, %6.1f us/picture\n",
+           coalesce ? "coalesced:" : "fragments:",
+           num_fragments / NUM_PICTURES, *picture_time);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const unsigned int slice_sizes[] = { 16, 128, MAX_SLICE_SIZE };
+    double fragments_time, coalesced_time;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_ELEMS(slice_sizes); i++) {
+        printf("%d slices of %u bytes:\n", NUM_SLICES, slice_sizes[i]);
+        if (run_bench(0, slice_sizes[i], &fragments_time) < 0 ||
+            run_bench(1, slice_sizes[i], &coalesced_time) < 0)
+            return 1;
+        printf("  speedup %.2fx\n", fragments_time / coalesced_time);
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ *  bench_context_layout.c - Cost of context and surface object layouts
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Replays MPEG-2 pictures interleaved over NUM_CONTEXTS contexts, as a
+ * process decoding many streams does, then looks every context and
+ * surface up in turn and reads a field of each. The more bytes of these
+ * objects each call touches, the more cache misses the interleaving
+ * causes, so both figures depend on how the objects are laid out.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "utils.h"
+
+#define NUM_CONTEXTS            128
+#define NUM_SURFACES            2
+#define NUM_PICTURES            100000
+#define NUM_LOOKUP_PASSES       20000
+#define SLICE_DATA_SIZE         64
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+typedef struct bench_stream bench_stream_t;
+struct bench_stream {
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+static bench_stream_t streams[NUM_CONTEXTS];
+
+static int
+decode_picture(VADriverContextP ctx, bench_stream_t *bs, unsigned int n)
+{
+    VAPictureParameterBufferMPEG2 pic_param;
+    VASliceParameterBufferMPEG2 slice_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    VABufferID buffers[3];
+    unsigned int i;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = SLICE_DATA_SIZE;
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+    slice_data[0] = 0x00;
+    slice_data[1] = 0x00;
+    slice_data[2] = 0x01;
+    slice_data[3] = 0x01;
+
+    buffers[0] = test_create_buffer(ctx, bs->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    buffers[1] = test_create_buffer(ctx, bs->context,
+                                    VASliceParameterBufferType,
+                                    sizeof(slice_param), &slice_param);
+    buffers[2] = test_create_buffer(ctx, bs->context,
+                                    VASliceDataBufferType,
+                                    sizeof(slice_data), slice_data);
+    for (i = 0; i < ARRAY_ELEMS(buffers); i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    TEST_CHECK_STATUS(vdpau_BeginPicture(ctx, bs->context,
+                                         bs->surfaces[n % NUM_SURFACES]));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(ctx, bs->context,
+                                          buffers, ARRAY_ELEMS(buffers)));
+    TEST_CHECK_STATUS(vdpau_EndPicture(ctx, bs->context));
+    return 0;
+}
+
+static int
+run_replay(VADriverContextP ctx)
+{
+    unsigned int i;
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < NUM_PICTURES; i++) {
+        bench_stream_t * const bs = &streams[i % NUM_CONTEXTS];
+        TEST_CHECK(decode_picture(ctx, bs, i / NUM_CONTEXTS) == 0);
+    }
+    const uint64_t elapsed = get_ticks_usec() - start;
+
+    printf("replay:  %.2f us/picture\n", (double)elapsed / NUM_PICTURES);
+    return 0;
+}
+
+static int
+run_lookups(vdpau_driver_data_t *driver_data)
+{
+    unsigned int i, j, sum = 0;
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < NUM_LOOKUP_PASSES; i++) {
+        for (j = 0; j < NUM_CONTEXTS; j++) {
+            object_context_p const obj_context = VDPAU_CONTEXT(streams[j].context);
+            TEST_CHECK(obj_context != NULL);
+            object_surface_p const obj_surface =
+                VDPAU_SURFACE(obj_context->render_targets[0]);
+            TEST_CHECK(obj_surface != NULL);
+            sum += obj_context->current_render_target + obj_surface->vdp_surface;
+        }
+    }
+    const uint64_t elapsed = get_ticks_usec() - start;
+
+    printf("lookups: %.1f ns per context and surface (%u)\n",
+           elapsed * 1000.0 / ((double)NUM_LOOKUP_PASSES * NUM_CONTEXTS),
+           sum & 1);
+    return 0;
+}
+
+static int
+run_bench(test_driver_t *driver)
+{
+    VADriverContextP const ctx = &driver->ctx;
+    VAConfigID config;
+    unsigned int i;
+
+    printf("%d contexts, object_context is %d bytes, object_surface %d bytes\n",
+           NUM_CONTEXTS, (int)sizeof(struct object_context),
+           (int)sizeof(struct object_surface));
+
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ctx, VAProfileMPEG2Main,
+                                         VAEntrypointVLD, NULL, 0, &config));
+    for (i = 0; i < NUM_CONTEXTS; i++) {
+        bench_stream_t * const bs = &streams[i];
+        TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                               VA_RT_FORMAT_YUV420, NUM_SURFACES,
+                                               bs->surfaces));
+        TEST_CHECK_STATUS(vdpau_CreateContext(ctx, config,
+                                              PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                              bs->surfaces, NUM_SURFACES,
+                                              &bs->context));
+    }
+
+    TEST_CHECK(run_replay(ctx) == 0);
+    TEST_CHECK(run_lookups(test_driver_get_data(driver)) == 0);
+
+    for (i = 0; i < NUM_CONTEXTS; i++) {
+        bench_stream_t * const bs = &streams[i];
+        TEST_CHECK_STATUS(vdpau_DestroyContext(ctx, bs->context));
+        TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, bs->surfaces,
+                                                NUM_SURFACES));
+    }
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ctx, config));
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_bench(&driver) < 0;
+    test_driver_close(&driver);
+    return error;
+}
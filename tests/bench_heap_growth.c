@@ -0,0 +1,144 @@
+/*
+ *  bench_heap_growth.c - Object allocation, lookup and free costs
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Fills a heap up to NUM_OBJECTS live objects, looks each of them up
+ * and frees them all. Fresh heaps grow while they fill up, either from
+ * the smallest bucket or from a first bucket sized by a preallocation
+ * hint. Reused heaps show the steady state, once they no longer grow.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "object_heap.h"
+#include "utils.h"
+
+#define NUM_OBJECTS             10000
+#define NUM_ROUNDS              100
+#define NUM_LOOKUP_PASSES       10
+
+/* Objects carry a payload, as driver objects do */
+typedef struct bench_object bench_object_t;
+struct bench_object {
+    struct object_base          base;
+    uint8_t                     data[120];
+};
+
+typedef struct bench_times bench_times_t;
+struct bench_times {
+    uint64_t                    allocate;
+    uint64_t                    lookup;
+    uint64_t                    free;
+};
+
+static int ids[NUM_OBJECTS];
+
+static int
+run_round(object_heap_p heap, bench_times_t *times)
+{
+    object_base_p obj;
+    unsigned int i, j;
+    uint64_t t;
+
+    t = get_ticks_usec();
+    for (i = 0; i < NUM_OBJECTS; i++) {
+        ids[i] = object_heap_allocate(heap);
+        TEST_CHECK(ids[i] >= 0);
+    }
+    times->allocate += get_ticks_usec() - t;
+
+    t = get_ticks_usec();
+    for (j = 0; j < NUM_LOOKUP_PASSES; j++) {
+        for (i = 0; i < NUM_OBJECTS; i++) {
+            obj = object_heap_lookup(heap, ids[(i * 61) % NUM_OBJECTS]);
+            TEST_CHECK(obj != NULL);
+        }
+    }
+    times->lookup += get_ticks_usec() - t;
+
+    t = get_ticks_usec();
+    for (i = 0; i < NUM_OBJECTS; i++)
+        object_heap_free(heap, object_heap_lookup(heap, ids[i]));
+    times->free += get_ticks_usec() - t;
+    return 0;
+}
+
+static void
+print_times(const char *name, const bench_times_t *times)
+{
+    const double n = (double)NUM_ROUNDS * NUM_OBJECTS;
+
+    printf("%-22s allocate %5.1f ns, lookup %5.1f ns, free %5.1f ns\n",
+           name, times->allocate * 1000.0 / n,
+           times->lookup * 1000.0 / (n * NUM_LOOKUP_PASSES),
+           times->free * 1000.0 / n);
+}
+
+// Runs each round on a fresh heap, initialized with num_objects_hint
+static int
+run_fresh_heaps(const char *name, unsigned int num_objects_hint)
+{
+    struct object_heap heap;
+    bench_times_t times;
+    unsigned int i;
+
+    memset(&times, 0, sizeof(times));
+    for (i = 0; i < NUM_ROUNDS; i++) {
+        TEST_CHECK(object_heap_init_full(&heap, sizeof(bench_object_t),
+                                         VDPAU_BUFFER_ID_OFFSET,
+                                         num_objects_hint) == 0);
+        TEST_CHECK(run_round(&heap, &times) == 0);
+        object_heap_destroy(&heap);
+    }
+    print_times(name, &times);
+    return 0;
+}
+
+// Runs all rounds on the same heap
+static int
+run_reused_heap(const char *name)
+{
+    struct object_heap heap;
+    bench_times_t times;
+    unsigned int i;
+
+    TEST_CHECK(object_heap_init(&heap, sizeof(bench_object_t),
+                                VDPAU_BUFFER_ID_OFFSET) == 0);
+    memset(&times, 0, sizeof(times));
+    TEST_CHECK(run_round(&heap, &times) == 0);
+    memset(&times, 0, sizeof(times));
+    for (i = 0; i < NUM_ROUNDS; i++)
+        TEST_CHECK(run_round(&heap, &times) == 0);
+    object_heap_destroy(&heap);
+    print_times(name, &times);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    printf("%d live objects of %d bytes\n", NUM_OBJECTS,
+           (int)sizeof(bench_object_t));
+    if (run_fresh_heaps("growing heap:", 0) < 0 ||
+        run_fresh_heaps("preallocated heap:", NUM_OBJECTS) < 0 ||
+        run_reused_heap("steady state:") < 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ *  bench_heap_lookup.c - Object lookups under allocation contention
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * NUM_READERS threads look objects up while another thread keeps
+ * allocating and freeing objects of the same heap, as decode threads do
+ * while the application creates and destroys buffers. Lookups run once
+ * as object_heap_lookup() does them, without any lock, and once with the
+ * heap mutex held around each of them, as they used to be.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "object_heap.h"
+#include "utils.h"
+#include <pthread.h>
+
+#define NUM_READERS             4
+#define NUM_OBJECTS             256
+#define NUM_LOOKUPS             2000000
+
+typedef struct bench_state bench_state_t;
+struct bench_state {
+    struct object_heap          heap;
+    int                         ids[NUM_OBJECTS];
+    int                         use_mutex;
+    int                         done;
+    unsigned int                misses;
+    unsigned long               num_updates;
+};
+
+static void *
+reader_thread(void *arg)
+{
+    bench_state_t * const bs = arg;
+    object_heap_p const heap = &bs->heap;
+    object_base_p obj;
+    unsigned int i, misses = 0;
+
+    for (i = 0; i < NUM_LOOKUPS; i++) {
+        const int id = bs->ids[(i * 7) % NUM_OBJECTS];
+        if (bs->use_mutex) {
+            pthread_mutex_lock(&heap->mutex);
+            obj = object_heap_lookup(heap, id);
+            pthread_mutex_unlock(&heap->mutex);
+        }
+        else
+            obj = object_heap_lookup(heap, id);
+        if (!obj || obj->id != id)
+            misses++;
+    }
+    __atomic_add_fetch(&bs->misses, misses, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void *
+writer_thread(void *arg)
+{
+    bench_state_t * const bs = arg;
+    object_heap_p const heap = &bs->heap;
+    unsigned long n = 0;
+    int id;
+
+    while (!__atomic_load_n(&bs->done, __ATOMIC_ACQUIRE)) {
+        id = object_heap_allocate(heap);
+        if (id >= 0)
+            object_heap_free(heap, object_heap_lookup(heap, id));
+        n++;
+    }
+    bs->num_updates = n;
+    return NULL;
+}
+
+// Returns the average time of a lookup, in nanoseconds
+static int
+run_lookups(bench_state_t *bs, int use_mutex, double *lookup_time)
+{
+    pthread_t readers[NUM_READERS], writer;
+    unsigned int i;
+
+    bs->use_mutex = use_mutex;
+    bs->done      = 0;
+    bs->misses    = 0;
+    TEST_CHECK(pthread_create(&writer, NULL, writer_thread, bs) == 0);
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < NUM_READERS; i++)
+        TEST_CHECK(pthread_create(&readers[i], NULL, reader_thread, bs) == 0);
+    for (i = 0; i < NUM_READERS; i++)
+        pthread_join(readers[i], NULL);
+    const uint64_t elapsed = get_ticks_usec() - start;
+
+    __atomic_store_n(&bs->done, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+    TEST_CHECK(bs->misses == 0);
+
+    *lookup_time = elapsed * 1000.0 / (NUM_READERS * NUM_LOOKUPS);
+    printf("%-12s %6.1f ns/lookup, %lu allocations meanwhile\n",
+           use_mutex ? "heap mutex:" : "lock-free:", *lookup_time,
+           bs->num_updates);
+    return 0;
+}
+
+static int
+run_bench(bench_state_t *bs)
+{
+    double locked_time, unlocked_time;
+    unsigned int i;
+
+    for (i = 0; i < NUM_OBJECTS; i++) {
+        bs->ids[i] = object_heap_allocate(&bs->heap);
+        TEST_CHECK(bs->ids[i] >= 0);
+    }
+
+    printf("%d readers, 1 writer, %d live objects\n", NUM_READERS, NUM_OBJECTS);
+    TEST_CHECK(run_lookups(bs, 1, &locked_time) == 0);
+    TEST_CHECK(run_lookups(bs, 0, &unlocked_time) == 0);
+    printf("speedup %.1fx\n", locked_time / unlocked_time);
+
+    for (i = 0; i < NUM_OBJECTS; i++)
+        object_heap_free(&bs->heap, object_heap_lookup(&bs->heap, bs->ids[i]));
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static bench_state_t bs;
+    int error;
+
+    if (object_heap_init(&bs.heap, sizeof(struct object_base),
+                         VDPAU_BUFFER_ID_OFFSET) < 0)
+        return 1;
+    error = run_bench(&bs) < 0;
+    object_heap_destroy(&bs.heap);
+    return error;
+}
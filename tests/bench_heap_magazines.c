@@ -0,0 +1,125 @@
+/*
+ *  bench_heap_magazines.c - Multi-threaded object allocation throughput
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * NUM_THREADS threads share one heap, as decode threads share the
+ * buffer heap. For each frame, a thread allocates between 4 and 200
+ * objects, as many as a picture has VA buffers, then frees them all.
+ * The heap runs once with per-thread magazines and once without.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "object_heap.h"
+#include "utils.h"
+#include <pthread.h>
+
+#define NUM_THREADS             8
+#define NUM_FRAMES              2000
+#define MIN_OBJECTS_PER_FRAME   4
+#define MAX_OBJECTS_PER_FRAME   200
+
+typedef struct bench_thread bench_thread_t;
+struct bench_thread {
+    object_heap_p               heap;
+    unsigned int                seed;
+    unsigned long               num_objects;
+    int                         errors;
+};
+
+static void *
+bench_thread(void *arg)
+{
+    bench_thread_t * const bt = arg;
+    int ids[MAX_OBJECTS_PER_FRAME];
+    unsigned int i, j, n;
+
+    for (i = 0; i < NUM_FRAMES; i++) {
+        n = MIN_OBJECTS_PER_FRAME +
+            rand_r(&bt->seed) % (MAX_OBJECTS_PER_FRAME - MIN_OBJECTS_PER_FRAME + 1);
+        for (j = 0; j < n; j++) {
+            ids[j] = object_heap_allocate(bt->heap);
+            if (ids[j] < 0)
+                bt->errors++;
+        }
+        for (j = 0; j < n; j++) {
+            if (ids[j] >= 0)
+                object_heap_free(bt->heap, object_heap_lookup(bt->heap, ids[j]));
+        }
+        bt->num_objects += n;
+    }
+    return NULL;
+}
+
+// Returns the number of objects allocated and freed per second
+static int
+run_threads(int use_magazines, double *throughput)
+{
+    struct object_heap heap;
+    bench_thread_t threads[NUM_THREADS];
+    pthread_t tids[NUM_THREADS];
+    unsigned long num_objects = 0;
+    unsigned int i;
+    int errors = 0;
+
+    TEST_CHECK(object_heap_init(&heap, sizeof(struct object_base),
+                                VDPAU_BUFFER_ID_OFFSET) == 0);
+    if (use_magazines)
+        TEST_CHECK(object_heap_enable_magazines(&heap) == 0);
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < NUM_THREADS; i++) {
+        threads[i].heap        = &heap;
+        threads[i].seed        = i + 1;
+        threads[i].num_objects = 0;
+        threads[i].errors      = 0;
+        TEST_CHECK(pthread_create(&tids[i], NULL, bench_thread, &threads[i]) == 0);
+    }
+    for (i = 0; i < NUM_THREADS; i++) {
+        pthread_join(tids[i], NULL);
+        num_objects += threads[i].num_objects;
+        errors      += threads[i].errors;
+    }
+    const uint64_t elapsed = get_ticks_usec() - start;
+
+    TEST_CHECK(errors == 0);
+    TEST_CHECK(object_heap_count(&heap) == 0);
+    object_heap_destroy(&heap);
+
+    *throughput = num_objects * 1000000.0 / elapsed;
+    printf("%-16s %6.2f M objects/s, %5.1f ns per allocate and free\n",
+           use_magazines ? "magazines:" : "heap mutex:",
+           *throughput / 1e6, 1e9 / *throughput);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    double locked_throughput, magazine_throughput;
+
+    printf("%d threads, %d-%d objects per frame\n", NUM_THREADS,
+           MIN_OBJECTS_PER_FRAME, MAX_OBJECTS_PER_FRAME);
+    if (run_threads(0, &locked_throughput) < 0 ||
+        run_threads(1, &magazine_throughput) < 0)
+        return 1;
+    printf("speedup %.1fx\n", magazine_throughput / locked_throughput);
+    return 0;
+}
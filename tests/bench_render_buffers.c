@@ -0,0 +1,169 @@
+/*
+ *  bench_render_buffers.c - Per-buffer cost of vaRenderPicture()
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Decodes MPEG-2 pictures made of a picture parameter buffer, an IQ
+ * matrix buffer and NUM_SLICES pairs of slice parameter and slice data
+ * buffers, each slice in its own pair as most applications send them.
+ * vaRenderPicture() is given one buffer at a time and timed alone, so
+ * that the figure is the cost of looking a buffer up, dispatching it to
+ * its translator and translating it.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "utils.h"
+
+#define NUM_SURFACES            2
+#define NUM_SLICES              68
+#define NUM_BUFFERS             (2 + 2 * NUM_SLICES)
+#define NUM_PICTURES            5000
+#define SLICE_DATA_SIZE         64
+#define PICTURE_WIDTH           1920
+#define PICTURE_HEIGHT          1088
+
+typedef struct bench_stream bench_stream_t;
+struct bench_stream {
+    VADriverContextP            ctx;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+static int
+create_picture_buffers(bench_stream_t *bs, VABufferID buffers[NUM_BUFFERS])
+{
+    VAPictureParameterBufferMPEG2 pic_param;
+    VAIQMatrixBufferMPEG2 iq_matrix;
+    VASliceParameterBufferMPEG2 slice_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    unsigned int i;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(&iq_matrix, 0, sizeof(iq_matrix));
+    iq_matrix.load_intra_quantiser_matrix     = 1;
+    iq_matrix.load_non_intra_quantiser_matrix = 1;
+    for (i = 0; i < 64; i++) {
+        iq_matrix.intra_quantiser_matrix[i]     = 16;
+        iq_matrix.non_intra_quantiser_matrix[i] = 16;
+    }
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = SLICE_DATA_SIZE;
+
+    slice_data[0] = 0x00;
+    slice_data[1] = 0x00;
+    slice_data[2] = 0x01;
+    memset(&slice_data[3], 0x42, SLICE_DATA_SIZE - 3);
+
+    buffers[0] = test_create_buffer(bs->ctx, bs->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    buffers[1] = test_create_buffer(bs->ctx, bs->context,
+                                    VAIQMatrixBufferType,
+                                    sizeof(iq_matrix), &iq_matrix);
+    for (i = 0; i < NUM_SLICES; i++) {
+        slice_param.slice_vertical_position = i;
+        slice_data[3] = i + 1;
+        buffers[2 + 2 * i] = test_create_buffer(bs->ctx, bs->context,
+                                                VASliceParameterBufferType,
+                                                sizeof(slice_param),
+                                                &slice_param);
+        buffers[3 + 2 * i] = test_create_buffer(bs->ctx, bs->context,
+                                                VASliceDataBufferType,
+                                                sizeof(slice_data),
+                                                slice_data);
+    }
+    for (i = 0; i < NUM_BUFFERS; i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+    return 0;
+}
+
+static int
+decode_picture(bench_stream_t *bs, unsigned int n, uint64_t *elapsed)
+{
+    VABufferID buffers[NUM_BUFFERS];
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    unsigned int i;
+
+    TEST_CHECK(create_picture_buffers(bs, buffers) == 0);
+    TEST_CHECK_STATUS(vdpau_BeginPicture(bs->ctx, bs->context,
+                                         bs->surfaces[n % NUM_SURFACES]));
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < NUM_BUFFERS && va_status == VA_STATUS_SUCCESS; i++)
+        va_status = vdpau_RenderPicture(bs->ctx, bs->context, &buffers[i], 1);
+    *elapsed += get_ticks_usec() - start;
+    TEST_CHECK_STATUS(va_status);
+    TEST_CHECK_STATUS(vdpau_EndPicture(bs->ctx, bs->context));
+    return 0;
+}
+
+static int
+run_bench(test_driver_t *driver)
+{
+    bench_stream_t bs;
+    uint64_t elapsed = 0;
+    unsigned int i;
+
+    bs.ctx = &driver->ctx;
+    TEST_CHECK_STATUS(vdpau_CreateConfig(bs.ctx, VAProfileMPEG2Main,
+                                         VAEntrypointVLD, NULL, 0, &bs.config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(bs.ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           VA_RT_FORMAT_YUV420, NUM_SURFACES,
+                                           bs.surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(bs.ctx, bs.config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          bs.surfaces, NUM_SURFACES,
+                                          &bs.context));
+
+    for (i = 0; i < NUM_PICTURES; i++)
+        TEST_CHECK(decode_picture(&bs, i, &elapsed) == 0);
+    printf("%d buffers per picture: %.1f ns per vaRenderPicture() buffer\n",
+           NUM_BUFFERS, elapsed * 1000.0 / ((double)NUM_PICTURES * NUM_BUFFERS));
+    TEST_CHECK(fake_vdpau_get_render_count() == NUM_PICTURES);
+
+    TEST_CHECK_STATUS(vdpau_DestroyContext(bs.ctx, bs.context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(bs.ctx, bs.surfaces, NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(bs.ctx, bs.config));
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_bench(&driver) < 0;
+    test_driver_close(&driver);
+    return error;
+}
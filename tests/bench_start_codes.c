@@ -0,0 +1,140 @@
+/*
+ *  bench_start_codes.c - Start code scanner throughput
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Splits synthetic H.264 bitstreams at their start codes, as
+ * VDPAU_VIDEO_SPLIT_SLICES does with whole access units. NAL units are
+ * random, emulation-prevented bytes. The bitstream is scanned with
+ * bitstream_find_start_code() and with a plain byte loop, which also
+ * checks that both find the same NAL units. Small bitstreams stay in
+ * the cache, large ones measure memory bandwidth.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "ubitstream.h"
+#include "utils.h"
+
+#define MIN_SCAN_BYTES          (64U << 20)
+
+typedef unsigned int (*find_start_code_func_t)(const uint8_t *buf,
+                                               unsigned int buf_size);
+
+// Scans one byte at a time, for reference
+static unsigned int
+find_start_code_bytes(const uint8_t *buf, unsigned int buf_size)
+{
+    unsigned int i;
+
+    for (i = 0; i + 2 < buf_size; i++) {
+        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1)
+            return i;
+    }
+    return buf_size;
+}
+
+// Fills buf with NAL units of nal_size bytes, each behind a start code
+static void
+make_bitstream(uint8_t *buf, unsigned int buf_size, unsigned int nal_size)
+{
+    unsigned int i, n, seed = 1;
+
+    for (i = 0, n = 0; i < buf_size; i++, n++) {
+        if (n == nal_size)
+            n = 0;
+        if (n < 4) {
+            static const uint8_t start_code[4] = { 0x00, 0x00, 0x01, 0x65 };
+            buf[i] = start_code[n];
+            continue;
+        }
+        /* Random bytes skewed towards zero, as in real slice data */
+        buf[i] = rand_r(&seed) % 4 == 0 ? 0 : rand_r(&seed) & 0xff;
+
+        /* Emulation prevention: 00 00 is never followed by 00-03 */
+        if (n >= 6 && buf[i - 2] == 0 && buf[i - 1] == 0 && buf[i] <= 3)
+            buf[i] = 0x03 + 1;
+    }
+}
+
+// Returns the number of start codes found
+static unsigned int
+split_bitstream(find_start_code_func_t find, const uint8_t *buf,
+                unsigned int buf_size)
+{
+    unsigned int pos = 0, count = 0, offset;
+
+    for (;;) {
+        offset = find(buf + pos, buf_size - pos);
+        if (offset >= buf_size - pos)
+            break;
+        count++;
+        pos += offset + 3;
+    }
+    return count;
+}
+
+static int
+run_scanner(const char *name, find_start_code_func_t find,
+            const uint8_t *buf, unsigned int buf_size, unsigned int *count)
+{
+    const unsigned int num_passes = MAX(1, MIN_SCAN_BYTES / buf_size);
+    unsigned int i;
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < num_passes; i++)
+        *count = split_bitstream(find, buf, buf_size);
+    const uint64_t elapsed = get_ticks_usec() - start;
+
+    printf("  %-5s %6.2f GB/s\n", name,
+           (double)num_passes * buf_size / (elapsed * 1000.0));
+    return 0;
+}
+
+static int
+run_bitstream(unsigned int buf_size, unsigned int nal_size)
+{
+    unsigned int count, ref_count;
+    uint8_t *buf;
+
+    buf = malloc(buf_size);
+    TEST_CHECK(buf != NULL);
+    make_bitstream(buf, buf_size, nal_size);
+
+    printf("%u KB bitstream, %u-byte NAL units:\n", buf_size >> 10, nal_size);
+    TEST_CHECK(run_scanner("bytes", find_start_code_bytes,
+                           buf, buf_size, &ref_count) == 0);
+    TEST_CHECK(run_scanner(bitstream_get_scanner_name(),
+                           bitstream_find_start_code,
+                           buf, buf_size, &count) == 0);
+    TEST_CHECK(ref_count == (buf_size + nal_size - 1) / nal_size);
+    TEST_CHECK(count == ref_count);
+    free(buf);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (run_bitstream(1U << 20, 1500) < 0 ||
+        run_bitstream(1U << 20, 64 << 10) < 0 ||
+        run_bitstream(64U << 20, 64 << 10) < 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,468 @@
+/*
+ *  fake_vdpau.c - Stand-in VDPAU device for tests and benchmarks
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "fake_vdpau.h"
+#include <vdpau/vdpau_x11.h>
+#include <pthread.h>
+#include <time.h>
+
+#define FAKE_DEVICE             1
+#define FAKE_MAX_DECODERS       256
+#define FAKE_DECODER_BASE       0x10000
+
+typedef struct fake_decoder fake_decoder_t;
+struct fake_decoder {
+    VdpDecoderProfile           profile;
+    uint32_t                    width;
+    uint32_t                    height;
+    int                         is_allocated;
+    int                         is_busy;
+};
+
+static pthread_mutex_t          fake_lock = PTHREAD_MUTEX_INITIALIZER;
+static fake_decoder_t           fake_decoders[FAKE_MAX_DECODERS];
+static uint32_t                 fake_next_handle;
+static unsigned int             fake_render_usec;
+static VdpBool                  fake_422_support;
+static fake_vdpau_render_hook_t fake_render_hook;
+static void                    *fake_render_hook_data;
+static unsigned int             fake_render_count;
+static unsigned int             fake_overlap_count;
+static unsigned int             fake_decoder_create_count;
+static unsigned int             fake_decoder_count;
+
+static uint32_t
+fake_new_handle(void)
+{
+    return __atomic_add_fetch(&fake_next_handle, 1, __ATOMIC_RELAXED);
+}
+
+static fake_decoder_t *
+fake_get_decoder(VdpDecoder decoder)
+{
+    const uint32_t index = decoder - FAKE_DECODER_BASE;
+
+    if (index >= FAKE_MAX_DECODERS || !fake_decoders[index].is_allocated)
+        return NULL;
+    return &fake_decoders[index];
+}
+
+void
+fake_vdpau_reset(void)
+{
+    pthread_mutex_lock(&fake_lock);
+    memset(fake_decoders, 0, sizeof(fake_decoders));
+    fake_next_handle          = 0x100;
+    fake_render_usec          = 0;
+    fake_422_support          = VDP_TRUE;
+    fake_render_hook          = NULL;
+    fake_render_hook_data     = NULL;
+    fake_render_count         = 0;
+    fake_overlap_count        = 0;
+    fake_decoder_create_count = 0;
+    fake_decoder_count        = 0;
+    pthread_mutex_unlock(&fake_lock);
+}
+
+void
+fake_vdpau_set_render_time(unsigned int usec)
+{
+    fake_render_usec = usec;
+}
+
+void
+fake_vdpau_set_422_support(int is_supported)
+{
+    fake_422_support = is_supported ? VDP_TRUE : VDP_FALSE;
+}
+
+void
+fake_vdpau_set_render_hook(fake_vdpau_render_hook_t hook, void *user_data)
+{
+    fake_render_hook      = hook;
+    fake_render_hook_data = user_data;
+}
+
+unsigned int
+fake_vdpau_get_render_count(void)
+{
+    return __atomic_load_n(&fake_render_count, __ATOMIC_RELAXED);
+}
+
+unsigned int
+fake_vdpau_get_overlap_count(void)
+{
+    return __atomic_load_n(&fake_overlap_count, __ATOMIC_RELAXED);
+}
+
+unsigned int
+fake_vdpau_get_decoder_create_count(void)
+{
+    return fake_decoder_create_count;
+}
+
+unsigned int
+fake_vdpau_get_decoder_count(void)
+{
+    return fake_decoder_count;
+}
+
+static char const *
+fake_get_error_string(VdpStatus status)
+{
+    return status == VDP_STATUS_OK ? "No error" : "Stand-in VDPAU error";
+}
+
+static VdpStatus
+fake_get_api_version(uint32_t *api_version)
+{
+    *api_version = VDPAU_VERSION;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_get_information_string(char const **information_string)
+{
+    *information_string = "Stand-in VDPAU device";
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_device_destroy(VdpDevice device)
+{
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_generate_csc_matrix(
+    VdpProcamp         *procamp,
+    VdpColorStandard    standard,
+    VdpCSCMatrix       *csc_matrix
+)
+{
+    memset(csc_matrix, 0, sizeof(*csc_matrix));
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_surface_create(
+    VdpDevice           device,
+    VdpChromaType       chroma_type,
+    uint32_t            width,
+    uint32_t            height,
+    VdpVideoSurface    *surface
+)
+{
+    if (chroma_type == VDP_CHROMA_TYPE_422 && !fake_422_support)
+        return VDP_STATUS_INVALID_CHROMA_TYPE;
+    *surface = fake_new_handle();
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_destroy_handle(uint32_t handle)
+{
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_surface_query_caps(
+    VdpDevice           device,
+    VdpChromaType       surface_chroma_type,
+    VdpBool            *is_supported,
+    uint32_t           *max_width,
+    uint32_t           *max_height
+)
+{
+    *is_supported = (surface_chroma_type != VDP_CHROMA_TYPE_422 ||
+                     fake_422_support);
+    *max_width    = 4096;
+    *max_height   = 4096;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_surface_query_ycbcr_caps(
+    VdpDevice           device,
+    VdpChromaType       surface_chroma_type,
+    VdpYCbCrFormat      bits_ycbcr_format,
+    VdpBool            *is_supported
+)
+{
+    *is_supported = VDP_TRUE;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_output_surface_create(
+    VdpDevice           device,
+    VdpRGBAFormat       rgba_format,
+    uint32_t            width,
+    uint32_t            height,
+    VdpOutputSurface   *surface
+)
+{
+    *surface = fake_new_handle();
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_output_surface_query_rgba_caps(
+    VdpDevice           device,
+    VdpRGBAFormat       surface_rgba_format,
+    VdpBool            *is_supported
+)
+{
+    *is_supported = VDP_TRUE;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_mixer_create(
+    VdpDevice                   device,
+    uint32_t                    feature_count,
+    VdpVideoMixerFeature const *features,
+    uint32_t                    parameter_count,
+    VdpVideoMixerParameter const *parameters,
+    void const * const         *parameter_values,
+    VdpVideoMixer              *mixer
+)
+{
+    *mixer = fake_new_handle();
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_mixer_query_feature_support(
+    VdpDevice           device,
+    VdpVideoMixerFeature feature,
+    VdpBool            *is_supported
+)
+{
+    *is_supported = VDP_FALSE;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_mixer_set_feature_enables(
+    VdpVideoMixer               mixer,
+    uint32_t                    feature_count,
+    VdpVideoMixerFeature const *features,
+    VdpBool const              *feature_enables
+)
+{
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_video_mixer_set_attribute_values(
+    VdpVideoMixer               mixer,
+    uint32_t                    attribute_count,
+    VdpVideoMixerAttribute const *attributes,
+    void const * const         *attribute_values
+)
+{
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_decoder_query_capabilities(
+    VdpDevice           device,
+    VdpDecoderProfile   profile,
+    VdpBool            *is_supported,
+    uint32_t           *max_level,
+    uint32_t           *max_macroblocks,
+    uint32_t           *max_width,
+    uint32_t           *max_height
+)
+{
+    *is_supported    = VDP_TRUE;
+    *max_level       = 51;
+    *max_macroblocks = (4096 / 16) * (4096 / 16);
+    *max_width       = 4096;
+    *max_height      = 4096;
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_decoder_create(
+    VdpDevice           device,
+    VdpDecoderProfile   profile,
+    uint32_t            width,
+    uint32_t            height,
+    uint32_t            max_references,
+    VdpDecoder         *decoder
+)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&fake_lock);
+    for (i = 0; i < FAKE_MAX_DECODERS; i++) {
+        fake_decoder_t * const dec = &fake_decoders[i];
+        if (dec->is_allocated)
+            continue;
+        dec->profile      = profile;
+        dec->width        = width;
+        dec->height       = height;
+        dec->is_busy      = 0;
+        dec->is_allocated = 1;
+        fake_decoder_create_count++;
+        fake_decoder_count++;
+        pthread_mutex_unlock(&fake_lock);
+        *decoder = FAKE_DECODER_BASE + i;
+        return VDP_STATUS_OK;
+    }
+    pthread_mutex_unlock(&fake_lock);
+    return VDP_STATUS_RESOURCES;
+}
+
+static VdpStatus
+fake_decoder_destroy(VdpDecoder decoder)
+{
+    VdpStatus vdp_status = VDP_STATUS_INVALID_HANDLE;
+
+    pthread_mutex_lock(&fake_lock);
+    fake_decoder_t * const dec = fake_get_decoder(decoder);
+    if (dec) {
+        dec->is_allocated = 0;
+        fake_decoder_count--;
+        vdp_status = VDP_STATUS_OK;
+    }
+    pthread_mutex_unlock(&fake_lock);
+    return vdp_status;
+}
+
+static VdpStatus
+fake_decoder_render(
+    VdpDecoder                  decoder,
+    VdpVideoSurface             target,
+    VdpPictureInfo const       *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    VdpBitstreamBuffer const   *bitstream_buffers
+)
+{
+    fake_decoder_t * const dec = fake_get_decoder(decoder);
+    if (!dec)
+        return VDP_STATUS_INVALID_HANDLE;
+
+    /* VDPAU decoders must not be used by several threads at once */
+    if (__atomic_exchange_n(&dec->is_busy, 1, __ATOMIC_ACQUIRE))
+        __atomic_add_fetch(&fake_overlap_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fake_render_count, 1, __ATOMIC_RELAXED);
+
+    if (fake_render_hook)
+        fake_render_hook(fake_render_hook_data, decoder, dec->profile, target,
+                         (const void *)picture_info,
+                         bitstream_buffer_count, bitstream_buffers);
+
+    if (fake_render_usec > 0) {
+        struct timespec ts;
+        ts.tv_sec  = fake_render_usec / 1000000;
+        ts.tv_nsec = (fake_render_usec % 1000000) * 1000;
+        nanosleep(&ts, NULL);
+    }
+    __atomic_store_n(&dec->is_busy, 0, __ATOMIC_RELEASE);
+    return VDP_STATUS_OK;
+}
+
+static VdpStatus
+fake_get_proc_address(
+    VdpDevice           device,
+    VdpFuncId           function_id,
+    void              **function_pointer
+)
+{
+    void *func;
+
+    switch (function_id) {
+#define FAKE_PROC(FUNC_ID, FUNC) \
+    case VDP_FUNC_ID_##FUNC_ID: func = (void *)fake_##FUNC; break
+        FAKE_PROC(GET_ERROR_STRING,             get_error_string);
+        FAKE_PROC(GET_API_VERSION,              get_api_version);
+        FAKE_PROC(GET_INFORMATION_STRING,       get_information_string);
+        FAKE_PROC(DEVICE_DESTROY,               device_destroy);
+        FAKE_PROC(GENERATE_CSC_MATRIX,          generate_csc_matrix);
+        FAKE_PROC(VIDEO_SURFACE_CREATE,         video_surface_create);
+        FAKE_PROC(VIDEO_SURFACE_DESTROY,        destroy_handle);
+        FAKE_PROC(VIDEO_SURFACE_QUERY_CAPABILITIES,
+                  video_surface_query_caps);
+        FAKE_PROC(VIDEO_SURFACE_QUERY_GET_PUT_BITS_Y_CB_CR_CAPABILITIES,
+                  video_surface_query_ycbcr_caps);
+        FAKE_PROC(OUTPUT_SURFACE_CREATE,        output_surface_create);
+        FAKE_PROC(OUTPUT_SURFACE_DESTROY,       destroy_handle);
+        FAKE_PROC(OUTPUT_SURFACE_QUERY_GET_PUT_BITS_NATIVE_CAPABILITIES,
+                  output_surface_query_rgba_caps);
+        FAKE_PROC(VIDEO_MIXER_CREATE,           video_mixer_create);
+        FAKE_PROC(VIDEO_MIXER_DESTROY,          destroy_handle);
+        FAKE_PROC(VIDEO_MIXER_QUERY_FEATURE_SUPPORT,
+                  video_mixer_query_feature_support);
+        FAKE_PROC(VIDEO_MIXER_SET_FEATURE_ENABLES,
+                  video_mixer_set_feature_enables);
+        FAKE_PROC(VIDEO_MIXER_SET_ATTRIBUTE_VALUES,
+                  video_mixer_set_attribute_values);
+        FAKE_PROC(DECODER_QUERY_CAPABILITIES,   decoder_query_capabilities);
+        FAKE_PROC(DECODER_CREATE,               decoder_create);
+        FAKE_PROC(DECODER_DESTROY,              decoder_destroy);
+        FAKE_PROC(DECODER_RENDER,               decoder_render);
+#undef FAKE_PROC
+    default:
+        /* Not needed by decoding; calling it faults right away */
+        func = NULL;
+        break;
+    }
+    *function_pointer = func;
+    return VDP_STATUS_OK;
+}
+
+VdpStatus
+vdp_device_create_x11(
+    Display             *display,
+    int                  screen,
+    VdpDevice           *device,
+    VdpGetProcAddress  **get_proc_address
+)
+{
+    *device           = FAKE_DEVICE;
+    *get_proc_address = fake_get_proc_address;
+    return VDP_STATUS_OK;
+}
+
+/* The driver opens a display of its own for VDPAU */
+static char fake_display[64];
+
+Display *
+XOpenDisplay(const char *display_name)
+{
+    return (Display *)fake_display;
+}
+
+int
+XCloseDisplay(Display *display)
+{
+    return 0;
+}
+
+char *
+XDisplayString(Display *display)
+{
+    static char display_string[] = ":0";
+    return display_string;
+}
@@ -0,0 +1,78 @@
+/*
+ *  fake_vdpau.h - Stand-in VDPAU device for tests and benchmarks
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef FAKE_VDPAU_H
+#define FAKE_VDPAU_H
+
+#include <vdpau/vdpau.h>
+
+/*
+ * The stand-in device replaces vdp_device_create_x11() and the few Xlib
+ * calls the driver makes at vaInitialize() time, so that the driver can
+ * run without an X server or a GPU. Decoders only record what they are
+ * asked to render: VdpDecoderRender() sleeps for the configured time,
+ * optionally calls a hook with the translated picture, and counts calls
+ * that overlap on the same decoder, which VDPAU does not allow.
+ */
+
+// Called from VdpDecoderRender() with the picture to decode
+typedef void (*fake_vdpau_render_hook_t)(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+);
+
+// Resets the device state, to be called before vaInitialize()
+void
+fake_vdpau_reset(void);
+
+// Sets the time VdpDecoderRender() takes, in microseconds
+void
+fake_vdpau_set_render_time(unsigned int usec);
+
+// Sets whether video surfaces can be 4:2:2, they can after a reset
+void
+fake_vdpau_set_422_support(int is_supported);
+
+// Sets the hook called for each VdpDecoderRender()
+void
+fake_vdpau_set_render_hook(fake_vdpau_render_hook_t hook, void *user_data);
+
+// Returns the number of VdpDecoderRender() calls so far
+unsigned int
+fake_vdpau_get_render_count(void);
+
+// Returns the number of VdpDecoderRender() calls that overlapped
+unsigned int
+fake_vdpau_get_overlap_count(void);
+
+// Returns the number of VdpDecoderCreate() calls so far
+unsigned int
+fake_vdpau_get_decoder_create_count(void);
+
+// Returns the number of decoders currently alive
+unsigned int
+fake_vdpau_get_decoder_count(void);
+
+#endif /* FAKE_VDPAU_H */
@@ -0,0 +1,608 @@
+/*
+ *  test_decode_av1.c - Tests for the AV1 decode backend
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Decodes AV1 frames on the stand-in device and checks the
+ * VdpPictureInfoAV1 and bitstream that reach VdpDecoderRender() against
+ * values worked out by hand from the VA-API buffers.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_buffer.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+
+#if USE_VDPAU_AV1
+#define NUM_SURFACES            4
+#define MAX_TILES               4
+#define TILE_SIZE(n)            (24 + 8 * (n))
+#define MAX_BITSTREAM_SIZE      (MAX_TILES * TILE_SIZE(MAX_TILES))
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+typedef struct test_stream test_stream_t;
+struct test_stream {
+    VADriverContextP            ctx;
+    vdpau_driver_data_t        *driver_data;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+// What the last VdpDecoderRender() call was given
+typedef struct rendered_picture rendered_picture_t;
+struct rendered_picture {
+    unsigned int                count;
+    VdpDecoderProfile           profile;
+    VdpVideoSurface             target;
+    VdpPictureInfoAV1           info;
+    unsigned int                num_fragments;
+    unsigned int                bitstream_size;
+    uint8_t                     bitstream[MAX_BITSTREAM_SIZE];
+};
+
+static rendered_picture_t rendered;
+
+static void
+render_hook(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    rendered_picture_t * const rp = user_data;
+    unsigned int i;
+
+    rp->count++;
+    rp->profile        = profile;
+    rp->target         = target;
+    rp->info           = *(const VdpPictureInfoAV1 *)picture_info;
+    rp->num_fragments  = bitstream_buffer_count;
+    rp->bitstream_size = 0;
+    for (i = 0; i < bitstream_buffer_count; i++) {
+        const uint32_t size = bitstream_buffers[i].bitstream_bytes;
+        if (rp->bitstream_size + size > sizeof(rp->bitstream))
+            break;
+        memcpy(&rp->bitstream[rp->bitstream_size],
+               bitstream_buffers[i].bitstream, size);
+        rp->bitstream_size += size;
+    }
+}
+
+static VdpVideoSurface
+get_vdp_surface(vdpau_driver_data_t *driver_data, VASurfaceID surface)
+{
+    object_surface_p const obj_surface = VDPAU_SURFACE(surface);
+
+    return obj_surface ? obj_surface->vdp_surface : VDP_INVALID_HANDLE;
+}
+
+static int
+open_stream(test_driver_t *driver, test_stream_t *ts, unsigned int rt_format)
+{
+    ts->ctx         = &driver->ctx;
+    ts->driver_data = test_driver_get_data(driver);
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ts->ctx, VAProfileAV1Profile0,
+                                         VAEntrypointVLD, NULL, 0,
+                                         &ts->config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ts->ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           rt_format, NUM_SURFACES,
+                                           ts->surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(ts->ctx, ts->config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          ts->surfaces, NUM_SURFACES,
+                                          &ts->context));
+    return 0;
+}
+
+static int
+close_stream(test_stream_t *ts)
+{
+    TEST_CHECK_STATUS(vdpau_DestroyContext(ts->ctx, ts->context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ts->ctx, ts->surfaces,
+                                            NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ts->ctx, ts->config));
+    return 0;
+}
+
+// Fills in the parameters of a shown key frame, with a single tile
+static void
+init_pic_param(VADecPictureParameterBufferAV1 *pic_param, VASurfaceID target,
+               unsigned int order_hint)
+{
+    unsigned int i;
+
+    memset(pic_param, 0, sizeof(*pic_param));
+    pic_param->order_hint_bits_minus_1                  = 6;
+    pic_param->seq_info_fields.fields.enable_order_hint = 1;
+    pic_param->seq_info_fields.fields.enable_cdef       = 1;
+    pic_param->seq_info_fields.fields.subsampling_x     = 1;
+    pic_param->seq_info_fields.fields.subsampling_y     = 1;
+    pic_param->current_frame                            = target;
+    pic_param->current_display_picture                  = target;
+    pic_param->frame_width_minus1                       = PICTURE_WIDTH - 1;
+    pic_param->frame_height_minus1                      = PICTURE_HEIGHT - 1;
+    for (i = 0; i < ARRAY_ELEMS(pic_param->ref_frame_map); i++)
+        pic_param->ref_frame_map[i]                     = VA_INVALID_SURFACE;
+    pic_param->primary_ref_frame                        = 7; /* PRIMARY_REF_NONE */
+    pic_param->order_hint                               = order_hint;
+    pic_param->tile_cols                                = 1;
+    pic_param->tile_rows                                = 1;
+    pic_param->width_in_sbs_minus_1[0]                  = (PICTURE_WIDTH + 63) / 64 - 1;
+    pic_param->height_in_sbs_minus_1[0]                 = (PICTURE_HEIGHT + 63) / 64 - 1;
+    pic_param->pic_info_fields.bits.frame_type          = 0; /* KEY_FRAME */
+    pic_param->pic_info_fields.bits.show_frame          = 1;
+    pic_param->base_qindex                              = 100;
+    for (i = 0; i < ARRAY_ELEMS(pic_param->wm); i++)
+        pic_param->wm[i].invalid                        = 1;
+}
+
+// Decodes the tiles of pic_param into target, tiles_per_group per tile group
+static int
+decode_picture(
+    test_stream_t                           *ts,
+    VASurfaceID                              target,
+    const VADecPictureParameterBufferAV1    *pic_param,
+    unsigned int                             tiles_per_group
+)
+{
+    const unsigned int num_tiles = pic_param->tile_cols * pic_param->tile_rows;
+    VASliceParameterBufferAV1 slice_params[MAX_TILES];
+    uint8_t tile_data[MAX_BITSTREAM_SIZE];
+    VABufferID buffers[1 + 2 * MAX_TILES];
+    unsigned int i, num_buffers = 0, offset = 0;
+
+    TEST_CHECK(num_tiles <= MAX_TILES);
+    TEST_CHECK(num_tiles % tiles_per_group == 0);
+
+    /* Tile n holds TILE_SIZE(n) bytes of value n + 1 */
+    memset(slice_params, 0, sizeof(slice_params));
+    for (i = 0; i < num_tiles; i++) {
+        if (i % tiles_per_group == 0)
+            offset = 0;
+        slice_params[i].slice_data_size   = TILE_SIZE(i);
+        slice_params[i].slice_data_offset = offset;
+        slice_params[i].tile_row          = i / pic_param->tile_cols;
+        slice_params[i].tile_column       = i % pic_param->tile_cols;
+        slice_params[i].tg_start          = i - i % tiles_per_group;
+        slice_params[i].tg_end            = slice_params[i].tg_start + tiles_per_group - 1;
+        offset += TILE_SIZE(i);
+    }
+
+    buffers[num_buffers++] = test_create_buffer(ts->ctx, ts->context,
+                                                VAPictureParameterBufferType,
+                                                sizeof(*pic_param), pic_param);
+    for (i = 0; i < num_tiles; i += tiles_per_group) {
+        unsigned int j, size = 0;
+
+        for (j = 0; j < tiles_per_group; j++) {
+            memset(&tile_data[size], i + j + 1, TILE_SIZE(i + j));
+            size += TILE_SIZE(i + j);
+        }
+        TEST_CHECK_STATUS(vdpau_CreateBuffer(ts->ctx, ts->context,
+                                             VASliceParameterBufferType,
+                                             sizeof(slice_params[0]),
+                                             tiles_per_group, &slice_params[i],
+                                             &buffers[num_buffers++]));
+        buffers[num_buffers++] = test_create_buffer(ts->ctx, ts->context,
+                                                    VASliceDataBufferType,
+                                                    size, tile_data);
+    }
+    for (i = 0; i < num_buffers; i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    memset(&rendered, 0, sizeof(rendered));
+    fake_vdpau_set_render_hook(render_hook, &rendered);
+    TEST_CHECK_STATUS(vdpau_BeginPicture(ts->ctx, ts->context, target));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(ts->ctx, ts->context,
+                                          buffers, num_buffers));
+    TEST_CHECK_STATUS(vdpau_EndPicture(ts->ctx, ts->context));
+    fake_vdpau_set_render_hook(NULL, NULL);
+    TEST_CHECK(rendered.count == 1);
+    TEST_CHECK(rendered.target == get_vdp_surface(ts->driver_data, target));
+    TEST_CHECK(rendered.profile == VDP_DECODER_PROFILE_AV1_MAIN);
+    return 0;
+}
+
+// Frame header, tools, tiles and film grain of a key frame
+static int
+test_key_frame(test_driver_t *driver)
+{
+    VADecPictureParameterBufferAV1 pic_param;
+    VAFilmGrainStructAV1 * const fg = &pic_param.film_grain_info;
+    const VdpPictureInfoAV1 * const pic_info = &rendered.info;
+    test_stream_t ts;
+    unsigned int i, j, offset;
+
+    TEST_CHECK(open_stream(driver, &ts, VA_RT_FORMAT_YUV420) == 0);
+
+    init_pic_param(&pic_param, ts.surfaces[0], 0);
+    pic_param.seq_info_fields.fields.film_grain_params_present = 1;
+    pic_param.pic_info_fields.bits.allow_screen_content_tools = 1;
+    pic_param.pic_info_fields.bits.disable_cdf_update = 1;
+
+    /* 2x2 tiles of 3x2 and 3x3 superblocks */
+    pic_param.tile_cols                 = 2;
+    pic_param.tile_rows                 = 2;
+    pic_param.width_in_sbs_minus_1[0]   = 2;
+    pic_param.width_in_sbs_minus_1[1]   = 2;
+    pic_param.height_in_sbs_minus_1[0]  = 1;
+    pic_param.height_in_sbs_minus_1[1]  = 2;
+    pic_param.context_update_tile_id    = 3;
+
+    pic_param.y_dc_delta_q              = -4;
+    pic_param.v_ac_delta_q              = 3;
+    pic_param.qmatrix_fields.bits.using_qmatrix = 1;
+    pic_param.qmatrix_fields.bits.qm_y  = 5;
+    pic_param.qmatrix_fields.bits.qm_v  = 9;
+    pic_param.mode_control_fields.bits.delta_q_present_flag = 1;
+    pic_param.mode_control_fields.bits.log2_delta_q_res = 2;
+    pic_param.mode_control_fields.bits.tx_mode = 2;
+
+    pic_param.seg_info.segment_info_fields.bits.enabled     = 1;
+    pic_param.seg_info.segment_info_fields.bits.update_map  = 1;
+    pic_param.seg_info.segment_info_fields.bits.update_data = 1;
+    pic_param.seg_info.feature_mask[1]                      = 0x01;
+    pic_param.seg_info.feature_data[1][0]                   = -30;
+    pic_param.seg_info.feature_mask[6]                      = 0x22;
+    pic_param.seg_info.feature_data[6][1]                   = 12;
+    pic_param.seg_info.feature_data[6][5]                   = 3;
+
+    pic_param.filter_level[0]           = 10;
+    pic_param.filter_level[1]           = 11;
+    pic_param.filter_level_u            = 12;
+    pic_param.filter_level_v            = 13;
+    pic_param.loop_filter_info_fields.bits.sharpness_level = 4;
+    pic_param.loop_filter_info_fields.bits.mode_ref_delta_enabled = 1;
+    pic_param.ref_deltas[0]             = 1;
+    pic_param.ref_deltas[4]             = -1;
+    pic_param.mode_deltas[1]            = 2;
+
+    /* CDEF strengths: primary 5, secondary 2 then primary 15, secondary 3 */
+    pic_param.cdef_damping_minus_3      = 2;
+    pic_param.cdef_bits                 = 1;
+    pic_param.cdef_y_strengths[0]       = (5 << 2) | 2;
+    pic_param.cdef_uv_strengths[1]      = (15 << 2) | 3;
+
+    pic_param.loop_restoration_fields.bits.yframe_restoration_type  = 1;
+    pic_param.loop_restoration_fields.bits.crframe_restoration_type = 3;
+    pic_param.loop_restoration_fields.bits.lr_unit_shift            = 1;
+    pic_param.loop_restoration_fields.bits.lr_uv_shift              = 1;
+
+    fg->film_grain_info_fields.bits.apply_grain              = 1;
+    fg->film_grain_info_fields.bits.chroma_scaling_from_luma = 0;
+    fg->film_grain_info_fields.bits.grain_scaling_minus_8    = 3;
+    fg->film_grain_info_fields.bits.ar_coeff_lag             = 2;
+    fg->film_grain_info_fields.bits.ar_coeff_shift_minus_6   = 1;
+    fg->film_grain_info_fields.bits.grain_scale_shift        = 1;
+    fg->film_grain_info_fields.bits.overlap_flag             = 1;
+    fg->film_grain_info_fields.bits.clip_to_restricted_range = 1;
+    fg->grain_seed          = 1234;
+    fg->num_y_points        = 2;
+    fg->point_y_value[0]    = 0;
+    fg->point_y_scaling[0]  = 20;
+    fg->point_y_value[1]    = 255;
+    fg->point_y_scaling[1]  = 40;
+    fg->num_cb_points       = 1;
+    fg->point_cb_value[0]   = 128;
+    fg->point_cb_scaling[0] = 30;
+    fg->num_cr_points       = 1;
+    fg->point_cr_value[0]   = 64;
+    fg->point_cr_scaling[0] = 50;
+    fg->ar_coeffs_y[0]      = -5;
+    fg->ar_coeffs_y[23]     = 7;
+    fg->ar_coeffs_cb[24]    = -128;
+    fg->ar_coeffs_cr[0]     = 127;
+    fg->cb_mult             = 128;
+    fg->cb_luma_mult        = 192;
+    fg->cb_offset           = 256;
+    fg->cr_mult             = 129;
+    fg->cr_luma_mult        = 193;
+    fg->cr_offset           = 257;
+
+    /* Two tile groups of two tiles, in separate slice data buffers */
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, 2) == 0);
+
+    TEST_CHECK(pic_info->width == PICTURE_WIDTH);
+    TEST_CHECK(pic_info->height == PICTURE_HEIGHT);
+    TEST_CHECK(pic_info->frame_offset == 0);
+    TEST_CHECK(pic_info->profile == 0);
+    TEST_CHECK(pic_info->bit_depth_minus8 == 0);
+    TEST_CHECK(pic_info->subsampling_x == 1 && pic_info->subsampling_y == 1);
+    TEST_CHECK(pic_info->enable_order_hint == 1);
+    TEST_CHECK(pic_info->order_hint_bits_minus1 == 6);
+    TEST_CHECK(pic_info->enable_cdef == 1);
+    TEST_CHECK(pic_info->enable_fgs == 1);
+    TEST_CHECK(pic_info->enable_restoration == 1);
+    TEST_CHECK(pic_info->frame_type == 0);
+    TEST_CHECK(pic_info->show_frame == 1);
+    TEST_CHECK(pic_info->disable_cdf_update == 1);
+    TEST_CHECK(pic_info->allow_screen_content_tools == 1);
+    TEST_CHECK(pic_info->delta_q_present == 1);
+    TEST_CHECK(pic_info->delta_q_res == 2);
+    TEST_CHECK(pic_info->tx_mode == 2);
+    TEST_CHECK(pic_info->primary_ref_frame == VDP_INVALID_HANDLE);
+    for (i = 0; i < ARRAY_ELEMS(pic_info->ref_frame_map); i++)
+        TEST_CHECK(pic_info->ref_frame_map[i] == VDP_INVALID_HANDLE);
+
+    /* Quantizer */
+    TEST_CHECK(pic_info->base_qindex == 100);
+    TEST_CHECK(pic_info->qp_y_dc_delta_q == -4);
+    TEST_CHECK(pic_info->qp_u_dc_delta_q == 0);
+    TEST_CHECK(pic_info->qp_v_ac_delta_q == 3);
+    TEST_CHECK(pic_info->using_qmatrix == 1);
+    TEST_CHECK(pic_info->qm_y == 5 && pic_info->qm_u == 0 && pic_info->qm_v == 9);
+    TEST_CHECK(pic_info->coded_lossless == 0);
+
+    /* Segmentation */
+    TEST_CHECK(pic_info->segmentation_enabled == 1);
+    TEST_CHECK(pic_info->segmentation_update_map == 1);
+    TEST_CHECK(pic_info->segmentation_update_data == 1);
+    TEST_CHECK(pic_info->segmentation_temporal_update == 0);
+    TEST_CHECK(pic_info->segmentation_feature_mask[1] == 0x01);
+    TEST_CHECK(pic_info->segmentation_feature_data[1][0] == -30);
+    TEST_CHECK(pic_info->segmentation_feature_mask[6] == 0x22);
+    TEST_CHECK(pic_info->segmentation_feature_data[6][1] == 12);
+    TEST_CHECK(pic_info->segmentation_feature_data[6][5] == 3);
+
+    /* Loop filter, CDEF and loop restoration */
+    TEST_CHECK(pic_info->loop_filter_level[0] == 10);
+    TEST_CHECK(pic_info->loop_filter_level[1] == 11);
+    TEST_CHECK(pic_info->loop_filter_level_u == 12);
+    TEST_CHECK(pic_info->loop_filter_level_v == 13);
+    TEST_CHECK(pic_info->loop_filter_sharpness == 4);
+    TEST_CHECK(pic_info->loop_filter_delta_enabled == 1);
+    TEST_CHECK(pic_info->loop_filter_ref_deltas[0] == 1);
+    TEST_CHECK(pic_info->loop_filter_ref_deltas[4] == -1);
+    TEST_CHECK(pic_info->loop_filter_mode_deltas[1] == 2);
+    TEST_CHECK(pic_info->cdef_damping_minus_3 == 2);
+    TEST_CHECK(pic_info->cdef_bits == 1);
+    TEST_CHECK(pic_info->cdef_y_strength[0] == ((2 << 4) | 5));
+    TEST_CHECK(pic_info->cdef_uv_strength[0] == 0);
+    TEST_CHECK(pic_info->cdef_uv_strength[1] == ((3 << 4) | 15));
+    TEST_CHECK(pic_info->lr_type[0] == 1);
+    TEST_CHECK(pic_info->lr_type[1] == 0);
+    TEST_CHECK(pic_info->lr_type[2] == 3);
+    TEST_CHECK(pic_info->lr_unit_size[0] == 2);
+    TEST_CHECK(pic_info->lr_unit_size[1] == 1);
+    TEST_CHECK(pic_info->lr_unit_size[2] == 1);
+
+    /* Film grain */
+    TEST_CHECK(pic_info->apply_grain == 1);
+    TEST_CHECK(pic_info->chroma_scaling_from_luma == 0);
+    TEST_CHECK(pic_info->scaling_shift_minus8 == 3);
+    TEST_CHECK(pic_info->ar_coeff_lag == 2);
+    TEST_CHECK(pic_info->ar_coeff_shift_minus6 == 1);
+    TEST_CHECK(pic_info->grain_scale_shift == 1);
+    TEST_CHECK(pic_info->overlap_flag == 1);
+    TEST_CHECK(pic_info->clip_to_restricted_range == 1);
+    TEST_CHECK(pic_info->random_seed == 1234);
+    TEST_CHECK(pic_info->num_y_points == 2);
+    TEST_CHECK(pic_info->scaling_points_y[0][0] == 0);
+    TEST_CHECK(pic_info->scaling_points_y[0][1] == 20);
+    TEST_CHECK(pic_info->scaling_points_y[1][0] == 255);
+    TEST_CHECK(pic_info->scaling_points_y[1][1] == 40);
+    TEST_CHECK(pic_info->num_cb_points == 1);
+    TEST_CHECK(pic_info->scaling_points_cb[0][0] == 128);
+    TEST_CHECK(pic_info->scaling_points_cb[0][1] == 30);
+    TEST_CHECK(pic_info->num_cr_points == 1);
+    TEST_CHECK(pic_info->scaling_points_cr[0][0] == 64);
+    TEST_CHECK(pic_info->scaling_points_cr[0][1] == 50);
+    TEST_CHECK(pic_info->ar_coeffs_y[0] == -5);
+    TEST_CHECK(pic_info->ar_coeffs_y[23] == 7);
+    TEST_CHECK(pic_info->ar_coeffs_cb[24] == -128);
+    TEST_CHECK(pic_info->ar_coeffs_cr[0] == 127);
+    TEST_CHECK(pic_info->cb_mult == 128 && pic_info->cb_luma_mult == 192);
+    TEST_CHECK(pic_info->cb_offset == 256);
+    TEST_CHECK(pic_info->cr_mult == 129 && pic_info->cr_luma_mult == 193);
+    TEST_CHECK(pic_info->cr_offset == 257);
+
+    /* Tiles follow each other, located by offsets into the bitstream */
+    TEST_CHECK(pic_info->num_tile_cols == 2);
+    TEST_CHECK(pic_info->num_tile_rows == 2);
+    TEST_CHECK(pic_info->context_update_tile_id == 3);
+    TEST_CHECK(pic_info->tile_widths[0] == 3 && pic_info->tile_widths[1] == 3);
+    TEST_CHECK(pic_info->tile_heights[0] == 2 && pic_info->tile_heights[1] == 3);
+    TEST_CHECK(rendered.num_fragments == 4);
+    for (i = 0, offset = 0; i < 4; i++) {
+        TEST_CHECK(pic_info->tile_info[2 * i] == offset);
+        TEST_CHECK(pic_info->tile_info[2 * i + 1] == offset + TILE_SIZE(i));
+        for (j = 0; j < TILE_SIZE(i); j++)
+            TEST_CHECK(rendered.bitstream[offset + j] == i + 1);
+        offset += TILE_SIZE(i);
+    }
+    TEST_CHECK(rendered.bitstream_size == offset);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+// References, their recorded sizes and order hints, and skip mode frames
+static int
+test_inter_frame(test_driver_t *driver)
+{
+    /* VA-API reference slot of LAST_FRAME ... ALTREF_FRAME */
+    static const uint8_t ref_frame_idx[7] = { 0, 0, 0, 1, 2, 2, 2 };
+    VADecPictureParameterBufferAV1 pic_param;
+    const VdpPictureInfoAV1 * const pic_info = &rendered.info;
+    test_stream_t ts;
+    VdpVideoSurface vdp_surfaces[NUM_SURFACES];
+    unsigned int i;
+
+    TEST_CHECK(open_stream(driver, &ts, VA_RT_FORMAT_YUV420) == 0);
+    for (i = 0; i < NUM_SURFACES; i++)
+        vdp_surfaces[i] = get_vdp_surface(ts.driver_data, ts.surfaces[i]);
+
+    /* Key frames with order hints 0, 8 and 120, the second one smaller */
+    init_pic_param(&pic_param, ts.surfaces[0], 0);
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, 1) == 0);
+    init_pic_param(&pic_param, ts.surfaces[1], 8);
+    pic_param.frame_width_minus1  = 176 - 1;
+    pic_param.frame_height_minus1 = 144 - 1;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[1], &pic_param, 1) == 0);
+    TEST_CHECK(pic_info->width == 176 && pic_info->height == 144);
+    TEST_CHECK(pic_info->frame_offset == 8);
+    init_pic_param(&pic_param, ts.surfaces[2], 120);
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[2], &pic_param, 1) == 0);
+
+    /* Inter frame with order hint 4, between the first two */
+    init_pic_param(&pic_param, ts.surfaces[3], 4);
+    pic_param.pic_info_fields.bits.frame_type              = 1; /* INTER_FRAME */
+    pic_param.pic_info_fields.bits.allow_high_precision_mv = 1;
+    pic_param.pic_info_fields.bits.use_ref_frame_mvs       = 1;
+    pic_param.mode_control_fields.bits.reference_select    = 1;
+    pic_param.mode_control_fields.bits.skip_mode_present   = 1;
+    pic_param.interp_filter         = 4; /* SWITCHABLE */
+    pic_param.primary_ref_frame     = 3;
+    pic_param.ref_frame_map[0]      = ts.surfaces[0];
+    pic_param.ref_frame_map[1]      = ts.surfaces[1];
+    pic_param.ref_frame_map[2]      = ts.surfaces[2];
+    memcpy(pic_param.ref_frame_idx, ref_frame_idx, sizeof(ref_frame_idx));
+    pic_param.wm[1].invalid         = 0;
+    pic_param.wm[1].wmtype          = VAAV1TransformationRotzoom;
+    pic_param.wm[1].wmmat[0]        = 3;
+    pic_param.wm[1].wmmat[2]        = 1 << 16;
+    pic_param.wm[1].wmmat[3]        = -42;
+    pic_param.wm[1].wmmat[5]        = 1 << 16;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[3], &pic_param, 1) == 0);
+
+    TEST_CHECK(pic_info->frame_type == 1);
+    TEST_CHECK(pic_info->frame_offset == 4);
+    TEST_CHECK(pic_info->allow_high_precision_mv == 1);
+    TEST_CHECK(pic_info->use_ref_frame_mvs == 1);
+    TEST_CHECK(pic_info->reference_mode == 1);
+    TEST_CHECK(pic_info->interp_filter == 4);
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(pic_info->ref_frame_map[i] == vdp_surfaces[i]);
+    for (; i < ARRAY_ELEMS(pic_info->ref_frame_map); i++)
+        TEST_CHECK(pic_info->ref_frame_map[i] == VDP_INVALID_HANDLE);
+
+    /* Sizes are those the references were decoded with */
+    for (i = 0; i < 7; i++) {
+        const unsigned int ref = ref_frame_idx[i];
+        TEST_CHECK(pic_info->ref_frame[i].index == vdp_surfaces[ref]);
+        TEST_CHECK(pic_info->ref_frame[i].width ==
+                   (ref == 1 ? 176 : PICTURE_WIDTH));
+        TEST_CHECK(pic_info->ref_frame[i].height ==
+                   (ref == 1 ? 144 : PICTURE_HEIGHT));
+    }
+    TEST_CHECK(pic_info->primary_ref_frame == vdp_surfaces[1]);
+
+    /* Order hint 120 is 12 frames before 4 with 7-bit order hints, so
+       the closest forward reference is LAST_FRAME at 0 and the closest
+       backward one GOLDEN_FRAME at 8 (5.9.22) */
+    TEST_CHECK(pic_info->skip_mode == 1);
+    TEST_CHECK(pic_info->SkipModeFrame0 == 1);
+    TEST_CHECK(pic_info->SkipModeFrame1 == 4);
+
+    TEST_CHECK(pic_info->global_motion[0].invalid == 1);
+    TEST_CHECK(pic_info->global_motion[1].invalid == 0);
+    TEST_CHECK(pic_info->global_motion[1].wmtype == VAAV1TransformationRotzoom);
+    TEST_CHECK(pic_info->global_motion[1].wmmat[0] == 3);
+    TEST_CHECK(pic_info->global_motion[1].wmmat[2] == 1 << 16);
+    TEST_CHECK(pic_info->global_motion[1].wmmat[3] == -42);
+    TEST_CHECK(pic_info->global_motion[1].wmmat[5] == 1 << 16);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+// A lossless frame has a zero quantizer in every segment
+static int
+test_coded_lossless(test_driver_t *driver)
+{
+    VADecPictureParameterBufferAV1 pic_param;
+    test_stream_t ts;
+
+    TEST_CHECK(open_stream(driver, &ts, VA_RT_FORMAT_YUV420) == 0);
+
+    init_pic_param(&pic_param, ts.surfaces[0], 0);
+    pic_param.base_qindex = 0;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, 1) == 0);
+    TEST_CHECK(rendered.info.coded_lossless == 1);
+
+    /* Segment 5 raises its quantizer */
+    pic_param.seg_info.segment_info_fields.bits.enabled = 1;
+    pic_param.seg_info.feature_mask[5]                  = 0x01;
+    pic_param.seg_info.feature_data[5][0]               = 4;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[1], &pic_param, 1) == 0);
+    TEST_CHECK(rendered.info.coded_lossless == 0);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+#if USE_VDPAU_HIGH_BIT_DEPTH
+// 10-bit streams decode into 10-bit surfaces
+static int
+test_10bit(test_driver_t *driver)
+{
+    VADecPictureParameterBufferAV1 pic_param;
+    test_stream_t ts;
+
+    TEST_CHECK(open_stream(driver, &ts, VA_RT_FORMAT_YUV420_10BPP) == 0);
+
+    init_pic_param(&pic_param, ts.surfaces[0], 0);
+    pic_param.bit_depth_idx = 1;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, 1) == 0);
+    TEST_CHECK(rendered.info.bit_depth_minus8 == 2);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+#endif
+
+static int
+run_tests(test_driver_t *driver)
+{
+    TEST_CHECK(test_key_frame(driver) == 0);
+    TEST_CHECK(test_inter_frame(driver) == 0);
+    TEST_CHECK(test_coded_lossless(driver) == 0);
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    TEST_CHECK(test_10bit(driver) == 0);
+#endif
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver);
+    test_driver_close(&driver);
+    return error < 0;
+}
+#else
+int
+main(int argc, char *argv[])
+{
+    return TEST_SKIPPED;
+}
+#endif
@@ -0,0 +1,530 @@
+/*
+ *  test_decode_hevc.c - Tests for the HEVC decode backend
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Decodes HEVC pictures on the stand-in device and checks the
+ * VdpPictureInfoHEVC and bitstream that reach VdpDecoderRender()
+ * against values worked out by hand from the VA-API buffers.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+
+#if USE_VDPAU_HEVC
+#define NUM_SURFACES            8
+#define MAX_SLICES              2
+#define SLICE_DATA_SIZE         32
+#define MAX_BITSTREAM_SIZE      256
+#define PICTURE_WIDTH           1920
+#define PICTURE_HEIGHT          1080
+
+typedef struct test_stream test_stream_t;
+struct test_stream {
+    VADriverContextP            ctx;
+    vdpau_driver_data_t        *driver_data;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+// What the last VdpDecoderRender() call was given
+typedef struct rendered_picture rendered_picture_t;
+struct rendered_picture {
+    unsigned int                count;
+    VdpDecoderProfile           profile;
+    VdpVideoSurface             target;
+    VdpPictureInfoHEVC          info;
+    unsigned int                num_fragments;
+    unsigned int                bitstream_size;
+    uint8_t                     bitstream[MAX_BITSTREAM_SIZE];
+};
+
+static rendered_picture_t rendered;
+
+static void
+render_hook(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    rendered_picture_t * const rp = user_data;
+    unsigned int i;
+
+    rp->count++;
+    rp->profile        = profile;
+    rp->target         = target;
+    rp->info           = *(const VdpPictureInfoHEVC *)picture_info;
+    rp->num_fragments  = bitstream_buffer_count;
+    rp->bitstream_size = 0;
+    for (i = 0; i < bitstream_buffer_count; i++) {
+        const uint32_t size = bitstream_buffers[i].bitstream_bytes;
+        if (rp->bitstream_size + size > sizeof(rp->bitstream))
+            break;
+        memcpy(&rp->bitstream[rp->bitstream_size],
+               bitstream_buffers[i].bitstream, size);
+        rp->bitstream_size += size;
+    }
+}
+
+// Builds the up-right diagonal scan of a size x size block (6.5.3)
+static void
+make_diag_scan(uint8_t *scan, int size)
+{
+    int i = 0, x = 0, y = 0;
+
+    while (i < size * size) {
+        while (y >= 0) {
+            if (x < size && y < size)
+                scan[i++] = y * size + x;
+            y--;
+            x++;
+        }
+        y = x;
+        x = 0;
+    }
+}
+
+static VdpVideoSurface
+get_vdp_surface(vdpau_driver_data_t *driver_data, VASurfaceID surface)
+{
+    object_surface_p const obj_surface = VDPAU_SURFACE(surface);
+
+    return obj_surface ? obj_surface->vdp_surface : VDP_INVALID_HANDLE;
+}
+
+static int
+open_stream(test_driver_t *driver, test_stream_t *ts, VAProfile profile,
+            unsigned int rt_format)
+{
+    ts->ctx         = &driver->ctx;
+    ts->driver_data = test_driver_get_data(driver);
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ts->ctx, profile, VAEntrypointVLD,
+                                         NULL, 0, &ts->config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ts->ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           rt_format, NUM_SURFACES,
+                                           ts->surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(ts->ctx, ts->config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          ts->surfaces, NUM_SURFACES,
+                                          &ts->context));
+    return 0;
+}
+
+static int
+close_stream(test_stream_t *ts)
+{
+    TEST_CHECK_STATUS(vdpau_DestroyContext(ts->ctx, ts->context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ts->ctx, ts->surfaces,
+                                            NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ts->ctx, ts->config));
+    return 0;
+}
+
+// Fills in the parameters of a 1080p intra picture without references
+static void
+init_pic_param(VAPictureParameterBufferHEVC *pic_param)
+{
+    unsigned int i;
+
+    memset(pic_param, 0, sizeof(*pic_param));
+    pic_param->CurrPic.picture_id                       = VA_INVALID_SURFACE;
+    for (i = 0; i < ARRAY_ELEMS(pic_param->ReferenceFrames); i++) {
+        pic_param->ReferenceFrames[i].picture_id        = VA_INVALID_SURFACE;
+        pic_param->ReferenceFrames[i].flags             = VA_PICTURE_HEVC_INVALID;
+    }
+    pic_param->pic_width_in_luma_samples                = PICTURE_WIDTH;
+    pic_param->pic_height_in_luma_samples               = PICTURE_HEIGHT;
+    pic_param->pic_fields.bits.chroma_format_idc        = 1;
+    pic_param->pic_fields.bits.amp_enabled_flag         = 1;
+    pic_param->pic_fields.bits.cu_qp_delta_enabled_flag = 1;
+    pic_param->pic_fields.bits.tiles_enabled_flag       = 1;
+    pic_param->pic_fields.bits.loop_filter_across_tiles_enabled_flag = 1;
+    pic_param->sps_max_dec_pic_buffering_minus1         = 4;
+    pic_param->log2_min_luma_coding_block_size_minus3   = 0;
+    pic_param->log2_diff_max_min_luma_coding_block_size = 3;
+    pic_param->log2_diff_max_min_transform_block_size   = 3;
+    pic_param->max_transform_hierarchy_depth_inter      = 2;
+    pic_param->max_transform_hierarchy_depth_intra      = 1;
+    pic_param->init_qp_minus26                          = -3;
+    pic_param->diff_cu_qp_delta_depth                   = 1;
+    pic_param->pps_cb_qp_offset                         = -2;
+    pic_param->pps_cr_qp_offset                         = 1;
+    pic_param->num_tile_columns_minus1                  = 1;
+    pic_param->num_tile_rows_minus1                     = 0;
+    pic_param->column_width_minus1[0]                   = 14;
+    pic_param->column_width_minus1[1]                   = 14;
+    pic_param->row_height_minus1[0]                     = 16;
+    pic_param->slice_parsing_fields.bits.sample_adaptive_offset_enabled_flag = 1;
+    pic_param->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag = 1;
+    pic_param->slice_parsing_fields.bits.IdrPicFlag     = 1;
+    pic_param->slice_parsing_fields.bits.RapPicFlag     = 1;
+    pic_param->slice_parsing_fields.bits.IntraPicFlag   = 1;
+    pic_param->log2_max_pic_order_cnt_lsb_minus4        = 4;
+    pic_param->num_short_term_ref_pic_sets              = 3;
+    pic_param->pps_beta_offset_div2                     = 2;
+    pic_param->st_rps_bits                              = 7;
+}
+
+// Decodes one picture into target, with num_slices slices in one data buffer
+static int
+decode_picture(
+    test_stream_t                       *ts,
+    VASurfaceID                          target,
+    const VAPictureParameterBufferHEVC  *pic_param,
+    const VAIQMatrixBufferHEVC          *iq_matrix,
+    const uint8_t                       *slice_data,
+    unsigned int                         num_slices
+)
+{
+    VASliceParameterBufferHEVC slice_params[MAX_SLICES];
+    VABufferID buffers[4];
+    unsigned int i, num_buffers = 0;
+
+    memset(slice_params, 0, sizeof(slice_params));
+    for (i = 0; i < num_slices; i++) {
+        slice_params[i].slice_data_size   = SLICE_DATA_SIZE;
+        slice_params[i].slice_data_offset = i * SLICE_DATA_SIZE;
+    }
+
+    buffers[num_buffers++] = test_create_buffer(ts->ctx, ts->context,
+                                                VAPictureParameterBufferType,
+                                                sizeof(*pic_param), pic_param);
+    if (iq_matrix)
+        buffers[num_buffers++] = test_create_buffer(ts->ctx, ts->context,
+                                                    VAIQMatrixBufferType,
+                                                    sizeof(*iq_matrix),
+                                                    iq_matrix);
+    if (vdpau_CreateBuffer(ts->ctx, ts->context, VASliceParameterBufferType,
+                           sizeof(slice_params[0]), num_slices, slice_params,
+                           &buffers[num_buffers++]) != VA_STATUS_SUCCESS)
+        buffers[num_buffers - 1] = VA_INVALID_BUFFER;
+    buffers[num_buffers++] = test_create_buffer(ts->ctx, ts->context,
+                                                VASliceDataBufferType,
+                                                num_slices * SLICE_DATA_SIZE,
+                                                slice_data);
+    for (i = 0; i < num_buffers; i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    memset(&rendered, 0, sizeof(rendered));
+    fake_vdpau_set_render_hook(render_hook, &rendered);
+    TEST_CHECK_STATUS(vdpau_BeginPicture(ts->ctx, ts->context, target));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(ts->ctx, ts->context,
+                                          buffers, num_buffers));
+    TEST_CHECK_STATUS(vdpau_EndPicture(ts->ctx, ts->context));
+    fake_vdpau_set_render_hook(NULL, NULL);
+    TEST_CHECK(rendered.count == 1);
+    TEST_CHECK(rendered.target == get_vdp_surface(ts->driver_data, target));
+    return 0;
+}
+
+// Sequence and picture parameters, and start codes of the slices
+static int
+test_intra_picture(test_driver_t *driver)
+{
+    static const uint8_t start_code[3] = { 0x00, 0x00, 0x01 };
+    VAPictureParameterBufferHEVC pic_param;
+    uint8_t slice_data[2 * SLICE_DATA_SIZE];
+    const VdpPictureInfoHEVC * const pic_info = &rendered.info;
+    test_stream_t ts;
+    unsigned int i;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileHEVCMain,
+                           VA_RT_FORMAT_YUV420) == 0);
+
+    /* The first slice has its start code, the second lacks it */
+    memset(slice_data, 0x42, sizeof(slice_data));
+    memcpy(slice_data, start_code, sizeof(start_code));
+    slice_data[3]                   = 0x26; /* IDR_W_RADL */
+    slice_data[SLICE_DATA_SIZE]     = 0x26;
+
+    init_pic_param(&pic_param);
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, NULL,
+                              slice_data, 2) == 0);
+    TEST_CHECK(rendered.profile == VDP_DECODER_PROFILE_HEVC_MAIN);
+
+    TEST_CHECK(pic_info->chroma_format_idc == 1);
+    TEST_CHECK(pic_info->pic_width_in_luma_samples == 1920);
+    TEST_CHECK(pic_info->pic_height_in_luma_samples == 1080);
+    TEST_CHECK(pic_info->bit_depth_luma_minus8 == 0);
+    TEST_CHECK(pic_info->bit_depth_chroma_minus8 == 0);
+    TEST_CHECK(pic_info->log2_max_pic_order_cnt_lsb_minus4 == 4);
+    TEST_CHECK(pic_info->sps_max_dec_pic_buffering_minus1 == 4);
+    TEST_CHECK(pic_info->log2_diff_max_min_luma_coding_block_size == 3);
+    TEST_CHECK(pic_info->log2_diff_max_min_transform_block_size == 3);
+    TEST_CHECK(pic_info->max_transform_hierarchy_depth_inter == 2);
+    TEST_CHECK(pic_info->max_transform_hierarchy_depth_intra == 1);
+    TEST_CHECK(pic_info->amp_enabled_flag == 1);
+    TEST_CHECK(pic_info->sample_adaptive_offset_enabled_flag == 1);
+    TEST_CHECK(pic_info->sps_temporal_mvp_enabled_flag == 1);
+    TEST_CHECK(pic_info->num_short_term_ref_pic_sets == 3);
+    TEST_CHECK(pic_info->init_qp_minus26 == -3);
+    TEST_CHECK(pic_info->cu_qp_delta_enabled_flag == 1);
+    TEST_CHECK(pic_info->diff_cu_qp_delta_depth == 1);
+    TEST_CHECK(pic_info->pps_cb_qp_offset == -2);
+    TEST_CHECK(pic_info->pps_cr_qp_offset == 1);
+
+    /* Explicit tile sizes */
+    TEST_CHECK(pic_info->tiles_enabled_flag == 1);
+    TEST_CHECK(pic_info->uniform_spacing_flag == 0);
+    TEST_CHECK(pic_info->num_tile_columns_minus1 == 1);
+    TEST_CHECK(pic_info->num_tile_rows_minus1 == 0);
+    TEST_CHECK(pic_info->column_width_minus1[0] == 14);
+    TEST_CHECK(pic_info->column_width_minus1[1] == 14);
+    TEST_CHECK(pic_info->column_width_minus1[2] == 0);
+    TEST_CHECK(pic_info->row_height_minus1[0] == 16);
+    TEST_CHECK(pic_info->row_height_minus1[1] == 0);
+    TEST_CHECK(pic_info->loop_filter_across_tiles_enabled_flag == 1);
+
+    /* A non-zero beta offset means the PPS had deblocking controls */
+    TEST_CHECK(pic_info->pps_beta_offset_div2 == 2);
+    TEST_CHECK(pic_info->deblocking_filter_control_present_flag == 1);
+
+    /* Flat scaling lists when scaling_list_enabled_flag is clear */
+    for (i = 0; i < 16; i++)
+        TEST_CHECK(pic_info->ScalingList4x4[5][i] == 16);
+    for (i = 0; i < 64; i++)
+        TEST_CHECK(pic_info->ScalingList32x32[1][i] == 16);
+    TEST_CHECK(pic_info->ScalingListDCCoeff16x16[0] == 16);
+
+    TEST_CHECK(pic_info->IDRPicFlag == 1);
+    TEST_CHECK(pic_info->RAPPicFlag == 1);
+    TEST_CHECK(pic_info->CurrPicOrderCntVal == 0);
+    TEST_CHECK(pic_info->NumShortTermPictureSliceHeaderBits == 7);
+    TEST_CHECK(pic_info->NumPocTotalCurr == 0);
+    for (i = 0; i < ARRAY_ELEMS(pic_info->RefPics); i++)
+        TEST_CHECK(pic_info->RefPics[i] == VDP_INVALID_HANDLE);
+
+    /* The missing start code is submitted as its own fragment */
+    TEST_CHECK(rendered.num_fragments == 3);
+    TEST_CHECK(rendered.bitstream_size == 2 * SLICE_DATA_SIZE + 3);
+    TEST_CHECK(memcmp(rendered.bitstream, slice_data, SLICE_DATA_SIZE) == 0);
+    TEST_CHECK(memcmp(&rendered.bitstream[SLICE_DATA_SIZE], start_code,
+                      sizeof(start_code)) == 0);
+    TEST_CHECK(memcmp(&rendered.bitstream[SLICE_DATA_SIZE + 3],
+                      &slice_data[SLICE_DATA_SIZE], SLICE_DATA_SIZE) == 0);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+// Reference pictures and the order of the RPS sets
+static int
+test_reference_pictures(test_driver_t *driver)
+{
+    /* Surface index, POC and flags of each VA reference frame */
+    static const struct {
+        unsigned int    surface;
+        int             poc;
+        unsigned int    flags;
+    } refs[] = {
+        { 2,  0, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE },
+        { 3, 16, VA_PICTURE_HEVC_RPS_ST_CURR_AFTER },
+        { 1,  4, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE },
+        { 4, 12, VA_PICTURE_HEVC_RPS_ST_CURR_AFTER },
+        { 5, -8, VA_PICTURE_HEVC_RPS_LT_CURR |
+                 VA_PICTURE_HEVC_LONG_TERM_REFERENCE },
+        { 6,  2, 0 },
+    };
+    VAPictureParameterBufferHEVC pic_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    const VdpPictureInfoHEVC * const pic_info = &rendered.info;
+    test_stream_t ts;
+    unsigned int i;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileHEVCMain,
+                           VA_RT_FORMAT_YUV420) == 0);
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+    slice_data[0] = 0x02; /* TRAIL_R */
+
+    init_pic_param(&pic_param);
+    pic_param.slice_parsing_fields.bits.IdrPicFlag   = 0;
+    pic_param.slice_parsing_fields.bits.RapPicFlag   = 0;
+    pic_param.slice_parsing_fields.bits.IntraPicFlag = 0;
+    pic_param.CurrPic.picture_id    = ts.surfaces[0];
+    pic_param.CurrPic.pic_order_cnt = 8;
+    for (i = 0; i < ARRAY_ELEMS(refs); i++) {
+        pic_param.ReferenceFrames[i].picture_id    = ts.surfaces[refs[i].surface];
+        pic_param.ReferenceFrames[i].pic_order_cnt = refs[i].poc;
+        pic_param.ReferenceFrames[i].flags         = refs[i].flags;
+    }
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, NULL,
+                              slice_data, 1) == 0);
+
+    TEST_CHECK(pic_info->IDRPicFlag == 0);
+    TEST_CHECK(pic_info->CurrPicOrderCntVal == 8);
+    for (i = 0; i < ARRAY_ELEMS(refs); i++) {
+        TEST_CHECK(pic_info->RefPics[i] ==
+                   get_vdp_surface(ts.driver_data, ts.surfaces[refs[i].surface]));
+        TEST_CHECK(pic_info->PicOrderCntVal[i] == refs[i].poc);
+        TEST_CHECK(pic_info->IsLongTerm[i] == (i == 4));
+    }
+    for (; i < ARRAY_ELEMS(pic_info->RefPics); i++)
+        TEST_CHECK(pic_info->RefPics[i] == VDP_INVALID_HANDLE);
+
+    /* Before: POC 4 then 0. After: POC 12 then 16 */
+    TEST_CHECK(pic_info->NumPocStCurrBefore == 2);
+    TEST_CHECK(pic_info->RefPicSetStCurrBefore[0] == 2);
+    TEST_CHECK(pic_info->RefPicSetStCurrBefore[1] == 0);
+    TEST_CHECK(pic_info->NumPocStCurrAfter == 2);
+    TEST_CHECK(pic_info->RefPicSetStCurrAfter[0] == 3);
+    TEST_CHECK(pic_info->RefPicSetStCurrAfter[1] == 1);
+    TEST_CHECK(pic_info->NumPocLtCurr == 1);
+    TEST_CHECK(pic_info->RefPicSetLtCurr[0] == 4);
+    TEST_CHECK(pic_info->NumPocTotalCurr == 5);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+// VA-API raster scaling lists reach VDPAU in diagonal scan order
+static int
+test_scaling_lists(test_driver_t *driver)
+{
+    VAPictureParameterBufferHEVC pic_param;
+    VAIQMatrixBufferHEVC iq_matrix;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    uint8_t scan_4x4[16], scan_8x8[64];
+    const VdpPictureInfoHEVC * const pic_info = &rendered.info;
+    test_stream_t ts;
+    unsigned int i, j;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileHEVCMain,
+                           VA_RT_FORMAT_YUV420) == 0);
+
+    make_diag_scan(scan_4x4, 4);
+    make_diag_scan(scan_8x8, 8);
+    TEST_CHECK(scan_4x4[1] == 4 && scan_4x4[2] == 1 && scan_4x4[15] == 15);
+
+    /* Each list holds its raster positions, offset by the list number */
+    memset(&iq_matrix, 0, sizeof(iq_matrix));
+    for (j = 0; j < 6; j++) {
+        for (i = 0; i < 16; i++)
+            iq_matrix.ScalingList4x4[j][i] = 16 * j + i;
+        for (i = 0; i < 64; i++) {
+            iq_matrix.ScalingList8x8[j][i]   = j + i;
+            iq_matrix.ScalingList16x16[j][i] = 100 + j + i;
+        }
+        iq_matrix.ScalingListDC16x16[j] = 200 + j;
+    }
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < 64; i++)
+            iq_matrix.ScalingList32x32[j][i] = 150 + j + i;
+        iq_matrix.ScalingListDC32x32[j] = 250 + j;
+    }
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+    slice_data[0] = 0x26;
+
+    init_pic_param(&pic_param);
+    pic_param.pic_fields.bits.scaling_list_enabled_flag = 1;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, &iq_matrix,
+                              slice_data, 1) == 0);
+
+    TEST_CHECK(pic_info->scaling_list_enabled_flag == 1);
+    for (j = 0; j < 6; j++) {
+        for (i = 0; i < 16; i++)
+            TEST_CHECK(pic_info->ScalingList4x4[j][i] == 16 * j + scan_4x4[i]);
+        for (i = 0; i < 64; i++) {
+            TEST_CHECK(pic_info->ScalingList8x8[j][i] == j + scan_8x8[i]);
+            TEST_CHECK(pic_info->ScalingList16x16[j][i] ==
+                       100 + j + scan_8x8[i]);
+        }
+        TEST_CHECK(pic_info->ScalingListDCCoeff16x16[j] == 200 + j);
+    }
+    for (j = 0; j < 2; j++) {
+        for (i = 0; i < 64; i++)
+            TEST_CHECK(pic_info->ScalingList32x32[j][i] ==
+                       150 + j + scan_8x8[i]);
+        TEST_CHECK(pic_info->ScalingListDCCoeff32x32[j] == 250 + j);
+    }
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+#if USE_VDPAU_HIGH_BIT_DEPTH
+// Main10 decodes into 10-bit surfaces with the Main10 decoder profile
+static int
+test_main10(test_driver_t *driver)
+{
+    VAPictureParameterBufferHEVC pic_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    test_stream_t ts;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileHEVCMain10,
+                           VA_RT_FORMAT_YUV420_10BPP) == 0);
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+    slice_data[0] = 0x26;
+
+    init_pic_param(&pic_param);
+    pic_param.bit_depth_luma_minus8   = 2;
+    pic_param.bit_depth_chroma_minus8 = 2;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param, NULL,
+                              slice_data, 1) == 0);
+    TEST_CHECK(rendered.profile == VDP_DECODER_PROFILE_HEVC_MAIN_10);
+    TEST_CHECK(rendered.info.bit_depth_luma_minus8 == 2);
+    TEST_CHECK(rendered.info.bit_depth_chroma_minus8 == 2);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+#endif
+
+static int
+run_tests(test_driver_t *driver)
+{
+    TEST_CHECK(test_intra_picture(driver) == 0);
+    TEST_CHECK(test_reference_pictures(driver) == 0);
+    TEST_CHECK(test_scaling_lists(driver) == 0);
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    TEST_CHECK(test_main10(driver) == 0);
+#endif
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver);
+    test_driver_close(&driver);
+    return error < 0;
+}
+#else
+int
+main(int argc, char *argv[])
+{
+    return TEST_SKIPPED;
+}
+#endif
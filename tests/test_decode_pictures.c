@@ -0,0 +1,236 @@
+/*
+ *  test_decode_pictures.c - Tests for VDPAU_EXT_decode_pictures
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_buffer.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "vdpau_ext.h"
+
+#define NUM_SURFACES            2
+#define NUM_PICTURE_BUFFERS     3
+#define SLICE_DATA_SIZE         64
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+typedef struct test_context test_context_t;
+struct test_context {
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+// Creates the buffers of an MPEG-2 intra picture
+static int
+create_picture_buffers(
+    VADriverContextP    ctx,
+    VAContextID         context,
+    VABufferID          buffers[NUM_PICTURE_BUFFERS]
+)
+{
+    VAPictureParameterBufferMPEG2 pic_param;
+    VASliceParameterBufferMPEG2 slice_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    unsigned int i;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = SLICE_DATA_SIZE;
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+
+    buffers[0] = test_create_buffer(ctx, context, VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    buffers[1] = test_create_buffer(ctx, context, VASliceParameterBufferType,
+                                    sizeof(slice_param), &slice_param);
+    buffers[2] = test_create_buffer(ctx, context, VASliceDataBufferType,
+                                    sizeof(slice_data), slice_data);
+    for (i = 0; i < NUM_PICTURE_BUFFERS; i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+    return 0;
+}
+
+static void
+init_picture(
+    VADecodePictureVDPAU *picture,
+    test_context_t       *tc,
+    unsigned int          surface,
+    VABufferID           *buffers
+)
+{
+    picture->context       = tc->context;
+    picture->render_target = tc->surfaces[surface];
+    picture->buffers       = buffers;
+    picture->num_buffers   = NUM_PICTURE_BUFFERS;
+    picture->status        = VA_STATUS_SUCCESS;
+}
+
+// Pictures of interleaved contexts are all decoded, in order
+static int
+test_interleaved_contexts(VADriverContextP ctx, test_context_t *tc)
+{
+    VABufferID buffers[4][NUM_PICTURE_BUFFERS];
+    VADecodePictureVDPAU pictures[4];
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_ELEMS(pictures); i++) {
+        test_context_t * const t = &tc[(i / 2) % 2];
+        TEST_CHECK(create_picture_buffers(ctx, t->context, buffers[i]) == 0);
+        init_picture(&pictures[i], t, i % NUM_SURFACES, buffers[i]);
+    }
+
+    const unsigned int render_count = fake_vdpau_get_render_count();
+    TEST_CHECK_STATUS(vdpau_DecodePictures(ctx, pictures,
+                                           ARRAY_ELEMS(pictures)));
+    for (i = 0; i < ARRAY_ELEMS(pictures); i++)
+        TEST_CHECK(pictures[i].status == VA_STATUS_SUCCESS);
+    TEST_CHECK(fake_vdpau_get_render_count() ==
+               render_count + ARRAY_ELEMS(pictures));
+    return 0;
+}
+
+// A buffer used twice in a batch rejects the whole batch
+static int
+test_duplicate_buffers(VADriverContextP ctx, test_context_t *tc)
+{
+    VABufferID buffers[2][NUM_PICTURE_BUFFERS];
+    VABufferID shared_buffers[NUM_PICTURE_BUFFERS];
+    VADecodePictureVDPAU pictures[2];
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_ELEMS(pictures); i++) {
+        TEST_CHECK(create_picture_buffers(ctx, tc[i].context, buffers[i]) == 0);
+        init_picture(&pictures[i], &tc[i], 0, buffers[i]);
+    }
+
+    /* Across pictures, even of different contexts */
+    memcpy(shared_buffers, buffers[1], sizeof(shared_buffers));
+    shared_buffers[2] = buffers[0][2];
+    pictures[1].buffers = shared_buffers;
+    const unsigned int render_count = fake_vdpau_get_render_count();
+    TEST_CHECK(vdpau_DecodePictures(ctx, pictures, 2) ==
+               VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(pictures[0].status == VA_STATUS_ERROR_UNKNOWN);
+    TEST_CHECK(pictures[1].status == VA_STATUS_ERROR_INVALID_BUFFER);
+
+    /* Within a picture */
+    memcpy(shared_buffers, buffers[0], sizeof(shared_buffers));
+    shared_buffers[1] = shared_buffers[0];
+    pictures[0].buffers = shared_buffers;
+    TEST_CHECK(vdpau_DecodePictures(ctx, pictures, 1) ==
+               VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(pictures[0].status == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(fake_vdpau_get_render_count() == render_count);
+
+    /* Rejected batches leave their buffers alone */
+    pictures[0].buffers = buffers[0];
+    pictures[1].buffers = buffers[1];
+    TEST_CHECK_STATUS(vdpau_DecodePictures(ctx, pictures, 2));
+    TEST_CHECK(fake_vdpau_get_render_count() == render_count + 2);
+    return 0;
+}
+
+// An invalid object anywhere in the batch keeps it all from decoding
+static int
+test_invalid_objects(VADriverContextP ctx, test_context_t *tc)
+{
+    VABufferID buffers[2][NUM_PICTURE_BUFFERS];
+    VADecodePictureVDPAU pictures[2];
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_ELEMS(pictures); i++) {
+        TEST_CHECK(create_picture_buffers(ctx, tc[i].context, buffers[i]) == 0);
+        init_picture(&pictures[i], &tc[i], 1, buffers[i]);
+    }
+
+    const unsigned int render_count = fake_vdpau_get_render_count();
+    pictures[1].render_target = VA_INVALID_SURFACE;
+    TEST_CHECK(vdpau_DecodePictures(ctx, pictures, 2) ==
+               VA_STATUS_ERROR_INVALID_SURFACE);
+    TEST_CHECK(pictures[0].status == VA_STATUS_ERROR_UNKNOWN);
+    TEST_CHECK(pictures[1].status == VA_STATUS_ERROR_INVALID_SURFACE);
+
+    pictures[1].render_target = tc[1].surfaces[1];
+    pictures[1].context       = VA_INVALID_ID;
+    TEST_CHECK(vdpau_DecodePictures(ctx, pictures, 2) ==
+               VA_STATUS_ERROR_INVALID_CONTEXT);
+    TEST_CHECK(pictures[0].status == VA_STATUS_ERROR_UNKNOWN);
+    TEST_CHECK(pictures[1].status == VA_STATUS_ERROR_INVALID_CONTEXT);
+    TEST_CHECK(fake_vdpau_get_render_count() == render_count);
+
+    pictures[1].context = tc[1].context;
+    TEST_CHECK_STATUS(vdpau_DecodePictures(ctx, pictures, 2));
+    TEST_CHECK(fake_vdpau_get_render_count() == render_count + 2);
+    return 0;
+}
+
+static int
+run_tests(VADriverContextP ctx)
+{
+    test_context_t tc[2];
+    VAConfigID config;
+    unsigned int i;
+
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ctx, VAProfileMPEG2Main,
+                                         VAEntrypointVLD, NULL, 0, &config));
+    for (i = 0; i < ARRAY_ELEMS(tc); i++) {
+        TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx,
+                                               PICTURE_WIDTH, PICTURE_HEIGHT,
+                                               VA_RT_FORMAT_YUV420,
+                                               NUM_SURFACES, tc[i].surfaces));
+        TEST_CHECK_STATUS(vdpau_CreateContext(ctx, config,
+                                              PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                              tc[i].surfaces, NUM_SURFACES,
+                                              &tc[i].context));
+    }
+
+    TEST_CHECK(test_interleaved_contexts(ctx, tc) == 0);
+    TEST_CHECK(test_duplicate_buffers(ctx, tc) == 0);
+    TEST_CHECK(test_invalid_objects(ctx, tc) == 0);
+
+    for (i = 0; i < ARRAY_ELEMS(tc); i++) {
+        TEST_CHECK_STATUS(vdpau_DestroyContext(ctx, tc[i].context));
+        TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, tc[i].surfaces,
+                                                NUM_SURFACES));
+    }
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ctx, config));
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver.ctx);
+    test_driver_close(&driver);
+    return error < 0;
+}
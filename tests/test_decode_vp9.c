@@ -0,0 +1,552 @@
+/*
+ *  test_decode_vp9.c - Tests for the VP9 decode backend
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Decodes VP9 frames on the stand-in device and checks the
+ * VdpPictureInfoVP9 and bitstream that reach VdpDecoderRender(). The
+ * loop filter deltas, quantizer and segmentation features only exist in
+ * the uncompressed header, so the frames start with headers written bit
+ * by bit here, from which the expected values follow directly.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+
+#if USE_VDPAU_VP9
+#define NUM_SURFACES            4
+#define FRAME_DATA_SIZE         96
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+typedef struct test_stream test_stream_t;
+struct test_stream {
+    VADriverContextP            ctx;
+    vdpau_driver_data_t        *driver_data;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+// What the last VdpDecoderRender() call was given
+typedef struct rendered_picture rendered_picture_t;
+struct rendered_picture {
+    unsigned int                count;
+    VdpDecoderProfile           profile;
+    VdpVideoSurface             target;
+    VdpPictureInfoVP9           info;
+    unsigned int                num_fragments;
+    unsigned int                bitstream_size;
+    uint8_t                     bitstream[FRAME_DATA_SIZE + 3];
+};
+
+static rendered_picture_t rendered;
+
+// Writes a VP9 uncompressed header, most significant bit first
+typedef struct bit_writer bit_writer_t;
+struct bit_writer {
+    uint8_t                    *buf;
+    unsigned int                index;
+};
+
+static void
+render_hook(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    rendered_picture_t * const rp = user_data;
+    unsigned int i;
+
+    rp->count++;
+    rp->profile        = profile;
+    rp->target         = target;
+    rp->info           = *(const VdpPictureInfoVP9 *)picture_info;
+    rp->num_fragments  = bitstream_buffer_count;
+    rp->bitstream_size = 0;
+    for (i = 0; i < bitstream_buffer_count; i++) {
+        const uint32_t size = bitstream_buffers[i].bitstream_bytes;
+        if (rp->bitstream_size + size > sizeof(rp->bitstream))
+            break;
+        memcpy(&rp->bitstream[rp->bitstream_size],
+               bitstream_buffers[i].bitstream, size);
+        rp->bitstream_size += size;
+    }
+}
+
+static void
+put_bits(bit_writer_t *bw, unsigned int n, unsigned int value)
+{
+    while (n-- > 0) {
+        if ((value >> n) & 1)
+            bw->buf[bw->index >> 3] |= 0x80 >> (bw->index & 7);
+        bw->index++;
+    }
+}
+
+// Writes a magnitude of n bits followed by a sign bit
+static void
+put_signed(bit_writer_t *bw, unsigned int n, int value)
+{
+    put_bits(bw, n, value < 0 ? -value : value);
+    put_bits(bw, 1, value < 0);
+}
+
+static VdpVideoSurface
+get_vdp_surface(vdpau_driver_data_t *driver_data, VASurfaceID surface)
+{
+    object_surface_p const obj_surface = VDPAU_SURFACE(surface);
+
+    return obj_surface ? obj_surface->vdp_surface : VDP_INVALID_HANDLE;
+}
+
+static int
+open_stream(test_driver_t *driver, test_stream_t *ts, VAProfile profile,
+            unsigned int rt_format)
+{
+    ts->ctx         = &driver->ctx;
+    ts->driver_data = test_driver_get_data(driver);
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ts->ctx, profile, VAEntrypointVLD,
+                                         NULL, 0, &ts->config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ts->ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           rt_format, NUM_SURFACES,
+                                           ts->surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(ts->ctx, ts->config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          ts->surfaces, NUM_SURFACES,
+                                          &ts->context));
+    return 0;
+}
+
+static int
+close_stream(test_stream_t *ts)
+{
+    TEST_CHECK_STATUS(vdpau_DestroyContext(ts->ctx, ts->context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ts->ctx, ts->surfaces,
+                                            NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ts->ctx, ts->config));
+    return 0;
+}
+
+// Fills in the parameters of a shown frame with invalid references
+static void
+init_pic_param(VADecPictureParameterBufferVP9 *pic_param)
+{
+    unsigned int i;
+
+    memset(pic_param, 0, sizeof(*pic_param));
+    pic_param->frame_width                      = PICTURE_WIDTH;
+    pic_param->frame_height                     = PICTURE_HEIGHT;
+    for (i = 0; i < ARRAY_ELEMS(pic_param->reference_frames); i++)
+        pic_param->reference_frames[i]          = VA_INVALID_SURFACE;
+    pic_param->pic_fields.bits.subsampling_x    = 1;
+    pic_param->pic_fields.bits.subsampling_y    = 1;
+    pic_param->pic_fields.bits.show_frame       = 1;
+    pic_param->bit_depth                        = 8;
+}
+
+// Writes the loop filter and quantizer syntax shared by the test frames
+static void
+put_loop_filter_and_quantizer(bit_writer_t *bw, int update_deltas)
+{
+    put_bits(bw, 6, 20);                /* filter_level */
+    put_bits(bw, 3, 2);                 /* sharpness_level */
+    put_bits(bw, 1, 1);                 /* mode_ref_delta_enabled */
+    put_bits(bw, 1, update_deltas);     /* mode_ref_delta_update */
+    if (update_deltas) {
+        put_bits(bw, 1, 1);             /* ref_deltas[INTRA] = 1 */
+        put_signed(bw, 6, 1);
+        put_bits(bw, 1, 0);
+        put_bits(bw, 1, 1);             /* ref_deltas[GOLDEN] = -2 */
+        put_signed(bw, 6, -2);
+        put_bits(bw, 1, 0);
+        put_bits(bw, 1, 1);             /* mode_deltas[0] = 3 */
+        put_signed(bw, 6, 3);
+        put_bits(bw, 1, 0);
+    }
+
+    put_bits(bw, 8, 60);                /* base_q_idx */
+    put_bits(bw, 1, 1);                 /* delta_q_y_dc = -3 */
+    put_signed(bw, 4, -3);
+    put_bits(bw, 1, 0);                 /* delta_q_uv_dc = 0 */
+    put_bits(bw, 1, 1);                 /* delta_q_uv_ac = 2 */
+    put_signed(bw, 4, 2);
+}
+
+// Decodes a frame made of frame_data into target
+static int
+decode_picture(
+    test_stream_t                           *ts,
+    VASurfaceID                              target,
+    const VADecPictureParameterBufferVP9    *pic_param,
+    const uint8_t                           *frame_data
+)
+{
+    VASliceParameterBufferVP9 slice_param;
+    VABufferID buffers[3];
+    unsigned int i;
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = FRAME_DATA_SIZE;
+
+    buffers[0] = test_create_buffer(ts->ctx, ts->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(*pic_param), pic_param);
+    buffers[1] = test_create_buffer(ts->ctx, ts->context,
+                                    VASliceParameterBufferType,
+                                    sizeof(slice_param), &slice_param);
+    buffers[2] = test_create_buffer(ts->ctx, ts->context,
+                                    VASliceDataBufferType,
+                                    FRAME_DATA_SIZE, frame_data);
+    for (i = 0; i < ARRAY_ELEMS(buffers); i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    memset(&rendered, 0, sizeof(rendered));
+    fake_vdpau_set_render_hook(render_hook, &rendered);
+    TEST_CHECK_STATUS(vdpau_BeginPicture(ts->ctx, ts->context, target));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(ts->ctx, ts->context,
+                                          buffers, ARRAY_ELEMS(buffers)));
+    TEST_CHECK_STATUS(vdpau_EndPicture(ts->ctx, ts->context));
+    fake_vdpau_set_render_hook(NULL, NULL);
+    TEST_CHECK(rendered.count == 1);
+    TEST_CHECK(rendered.target == get_vdp_surface(ts->driver_data, target));
+    return 0;
+}
+
+// Decodes a key frame with segmentation, then an inter frame that keeps it
+static int
+test_key_and_inter_frames(test_driver_t *driver)
+{
+    static const uint8_t start_code[3] = { 0x00, 0x00, 0x01 };
+    VADecPictureParameterBufferVP9 pic_param;
+    uint8_t frame_data[FRAME_DATA_SIZE];
+    const VdpPictureInfoVP9 * const pic_info = &rendered.info;
+    bit_writer_t bw;
+    test_stream_t ts;
+    unsigned int i, j;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileVP9Profile0,
+                           VA_RT_FORMAT_YUV420) == 0);
+
+    /* Key frame */
+    memset(frame_data, 0, sizeof(frame_data));
+    bw.buf   = frame_data;
+    bw.index = 0;
+    put_bits(&bw, 2, 2);                /* frame_marker */
+    put_bits(&bw, 2, 0);                /* profile 0 */
+    put_bits(&bw, 1, 0);                /* show_existing_frame */
+    put_bits(&bw, 1, 0);                /* frame_type: KEY_FRAME */
+    put_bits(&bw, 1, 1);                /* show_frame */
+    put_bits(&bw, 1, 0);                /* error_resilient_mode */
+    put_bits(&bw, 24, 0x498342);        /* frame_sync_code */
+    put_bits(&bw, 3, 2);                /* color_space: CS_BT_709 */
+    put_bits(&bw, 1, 0);                /* color_range */
+    put_bits(&bw, 16, PICTURE_WIDTH - 1);
+    put_bits(&bw, 16, PICTURE_HEIGHT - 1);
+    put_bits(&bw, 1, 0);                /* render_and_frame_size_different */
+    put_bits(&bw, 1, 1);                /* refresh_frame_context */
+    put_bits(&bw, 1, 0);                /* frame_parallel_decoding_mode */
+    put_bits(&bw, 2, 1);                /* frame_context_idx */
+    put_loop_filter_and_quantizer(&bw, 1);
+    put_bits(&bw, 1, 1);                /* segmentation_enabled */
+    put_bits(&bw, 1, 1);                /* segmentation_update_map */
+    put_bits(&bw, 1, 1);                /* tree_probs[0] = 128 */
+    put_bits(&bw, 8, 128);
+    put_bits(&bw, 6, 0);                /* tree_probs[1-6] = 255 */
+    put_bits(&bw, 1, 0);                /* segmentation_temporal_update */
+    put_bits(&bw, 1, 1);                /* segmentation_update_data */
+    put_bits(&bw, 1, 1);                /* segmentation_abs_or_delta_update */
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 4; j++) {
+            if (i == 1 && j == 0) {     /* ALT_Q = -10 */
+                put_bits(&bw, 1, 1);
+                put_signed(&bw, 8, -10);
+            }
+            else if (i == 2 && j == 1) { /* ALT_LF = 5 */
+                put_bits(&bw, 1, 1);
+                put_signed(&bw, 6, 5);
+            }
+            else if (i == 3 && j == 2) { /* REF_FRAME = LAST */
+                put_bits(&bw, 1, 1);
+                put_bits(&bw, 2, 1);
+            }
+            else if (i == 4 && j == 3)  /* SKIP */
+                put_bits(&bw, 1, 1);
+            else
+                put_bits(&bw, 1, 0);
+        }
+    }
+    /* The tile info and header_size_in_bytes that follow are not parsed */
+    bw.index += 6 + 16;
+    for (i = (bw.index + 7) / 8; i < sizeof(frame_data); i++)
+        frame_data[i] = 0x42 + i;
+
+    init_pic_param(&pic_param);
+    pic_param.pic_fields.bits.frame_type            = 0;
+    pic_param.pic_fields.bits.refresh_frame_context = 1;
+    pic_param.pic_fields.bits.frame_context_idx     = 1;
+    pic_param.pic_fields.bits.segmentation_enabled  = 1;
+    pic_param.pic_fields.bits.segmentation_update_map = 1;
+    pic_param.filter_level                          = 20;
+    pic_param.sharpness_level                       = 2;
+    pic_param.log2_tile_columns                     = 1;
+    pic_param.frame_header_length_in_bytes          = (bw.index + 7) / 8;
+    pic_param.first_partition_size                  = 40;
+    pic_param.mb_segment_tree_probs[0]              = 128;
+    for (i = 1; i < ARRAY_ELEMS(pic_param.mb_segment_tree_probs); i++)
+        pic_param.mb_segment_tree_probs[i]          = 255;
+    for (i = 0; i < ARRAY_ELEMS(pic_param.segment_pred_probs); i++)
+        pic_param.segment_pred_probs[i]             = 255;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param,
+                              frame_data) == 0);
+    TEST_CHECK(rendered.profile == VDP_DECODER_PROFILE_VP9_PROFILE_0);
+
+    /* From the VA-API picture parameters */
+    TEST_CHECK(pic_info->width == PICTURE_WIDTH);
+    TEST_CHECK(pic_info->height == PICTURE_HEIGHT);
+    TEST_CHECK(pic_info->profile == 0);
+    TEST_CHECK(pic_info->keyFrame == 1);
+    TEST_CHECK(pic_info->showFrame == 1);
+    TEST_CHECK(pic_info->intraOnly == 0);
+    TEST_CHECK(pic_info->frameContextIdx == 1);
+    TEST_CHECK(pic_info->refreshEntropyProbs == 1);
+    TEST_CHECK(pic_info->subSamplingX == 1);
+    TEST_CHECK(pic_info->subSamplingY == 1);
+    TEST_CHECK(pic_info->bitDepthMinus8Luma == 0);
+    TEST_CHECK(pic_info->loopFilterLevel == 20);
+    TEST_CHECK(pic_info->loopFilterSharpness == 2);
+    TEST_CHECK(pic_info->log2TileColumns == 1);
+    TEST_CHECK(pic_info->log2TileRows == 0);
+    TEST_CHECK(pic_info->segmentEnabled == 1);
+    TEST_CHECK(pic_info->segmentMapUpdate == 1);
+    TEST_CHECK(pic_info->segmentMapTemporalUpdate == 0);
+    TEST_CHECK(pic_info->mbSegmentTreeProbs[0] == 128);
+    TEST_CHECK(pic_info->mbSegmentTreeProbs[6] == 255);
+    TEST_CHECK(pic_info->segmentPredProbs[2] == 255);
+    TEST_CHECK(pic_info->uncompressedHeaderSize ==
+               pic_param.frame_header_length_in_bytes);
+    TEST_CHECK(pic_info->compressedHeaderSize == 40);
+    TEST_CHECK(pic_info->lastReference == VDP_INVALID_HANDLE);
+    TEST_CHECK(pic_info->goldenReference == VDP_INVALID_HANDLE);
+    TEST_CHECK(pic_info->altReference == VDP_INVALID_HANDLE);
+
+    /* From the uncompressed header */
+    TEST_CHECK(pic_info->colorSpace == 2);
+    TEST_CHECK(pic_info->modeRefLfEnabled == 1);
+    TEST_CHECK(pic_info->mbRefLfDelta[0] == 1);
+    TEST_CHECK(pic_info->mbRefLfDelta[1] == 0);
+    TEST_CHECK((int)pic_info->mbRefLfDelta[2] == -2);
+    TEST_CHECK((int)pic_info->mbRefLfDelta[3] == -1);
+    TEST_CHECK(pic_info->mbModeLfDelta[0] == 3);
+    TEST_CHECK(pic_info->mbModeLfDelta[1] == 0);
+    TEST_CHECK(pic_info->qpYAc == 60);
+    TEST_CHECK(pic_info->qpYDc == -3);
+    TEST_CHECK(pic_info->qpChDc == 0);
+    TEST_CHECK(pic_info->qpChAc == 2);
+    TEST_CHECK(pic_info->segmentFeatureMode == 1);
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 4; j++)
+            TEST_CHECK(pic_info->segmentFeatureEnable[i][j] ==
+                       ((i == 1 && j == 0) || (i == 2 && j == 1) ||
+                        (i == 3 && j == 2) || (i == 4 && j == 3)));
+    }
+    TEST_CHECK(pic_info->segmentFeatureData[1][0] == -10);
+    TEST_CHECK(pic_info->segmentFeatureData[2][1] == 5);
+    TEST_CHECK(pic_info->segmentFeatureData[3][2] == 1);
+    TEST_CHECK(pic_info->segmentFeatureData[4][3] == 0);
+
+    /* The frame follows a start code */
+    TEST_CHECK(rendered.num_fragments == 2);
+    TEST_CHECK(rendered.bitstream_size == sizeof(start_code) + FRAME_DATA_SIZE);
+    TEST_CHECK(memcmp(rendered.bitstream, start_code, sizeof(start_code)) == 0);
+    TEST_CHECK(memcmp(&rendered.bitstream[sizeof(start_code)], frame_data,
+                      FRAME_DATA_SIZE) == 0);
+
+    /* Inter frame, keeping the loop filter deltas and segment features */
+    memset(frame_data, 0, sizeof(frame_data));
+    bw.index = 0;
+    put_bits(&bw, 2, 2);                /* frame_marker */
+    put_bits(&bw, 2, 0);                /* profile 0 */
+    put_bits(&bw, 1, 0);                /* show_existing_frame */
+    put_bits(&bw, 1, 1);                /* frame_type: NON_KEY_FRAME */
+    put_bits(&bw, 1, 1);                /* show_frame */
+    put_bits(&bw, 1, 0);                /* error_resilient_mode */
+    put_bits(&bw, 2, 0);                /* reset_frame_context */
+    put_bits(&bw, 8, 0x02);             /* refresh_frame_flags */
+    put_bits(&bw, 3, 0);                /* LAST: slot 0 */
+    put_bits(&bw, 1, 0);
+    put_bits(&bw, 3, 1);                /* GOLDEN: slot 1 */
+    put_bits(&bw, 1, 0);
+    put_bits(&bw, 3, 2);                /* ALTREF: slot 2, sign bias */
+    put_bits(&bw, 1, 1);
+    put_bits(&bw, 1, 1);                /* found_ref */
+    put_bits(&bw, 1, 0);                /* render_and_frame_size_different */
+    put_bits(&bw, 1, 1);                /* allow_high_precision_mv */
+    put_bits(&bw, 1, 1);                /* is_filter_switchable */
+    put_bits(&bw, 1, 0);                /* refresh_frame_context */
+    put_bits(&bw, 1, 0);                /* frame_parallel_decoding_mode */
+    put_bits(&bw, 2, 1);                /* frame_context_idx */
+    put_loop_filter_and_quantizer(&bw, 0);
+    put_bits(&bw, 1, 1);                /* segmentation_enabled */
+    put_bits(&bw, 1, 0);                /* segmentation_update_map */
+    put_bits(&bw, 1, 0);                /* segmentation_update_data */
+    bw.index += 6 + 16;
+
+    init_pic_param(&pic_param);
+    pic_param.pic_fields.bits.frame_type                = 1;
+    pic_param.pic_fields.bits.allow_high_precision_mv   = 1;
+    pic_param.pic_fields.bits.mcomp_filter_type         = 4; /* SWITCHABLE */
+    pic_param.pic_fields.bits.frame_context_idx         = 1;
+    pic_param.pic_fields.bits.segmentation_enabled      = 1;
+    pic_param.pic_fields.bits.last_ref_frame            = 0;
+    pic_param.pic_fields.bits.golden_ref_frame          = 1;
+    pic_param.pic_fields.bits.alt_ref_frame             = 2;
+    pic_param.pic_fields.bits.alt_ref_frame_sign_bias   = 1;
+    pic_param.reference_frames[0]   = ts.surfaces[0];
+    pic_param.reference_frames[1]   = ts.surfaces[2];
+    pic_param.reference_frames[2]   = ts.surfaces[3];
+    pic_param.filter_level          = 20;
+    pic_param.sharpness_level       = 2;
+    pic_param.frame_header_length_in_bytes = (bw.index + 7) / 8;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[1], &pic_param,
+                              frame_data) == 0);
+
+    TEST_CHECK(pic_info->keyFrame == 0);
+    TEST_CHECK(pic_info->allowHighPrecisionMv == 1);
+    TEST_CHECK(pic_info->mcompFilterType == 4);
+    TEST_CHECK(pic_info->lastReference ==
+               get_vdp_surface(ts.driver_data, ts.surfaces[0]));
+    TEST_CHECK(pic_info->goldenReference ==
+               get_vdp_surface(ts.driver_data, ts.surfaces[2]));
+    TEST_CHECK(pic_info->altReference ==
+               get_vdp_surface(ts.driver_data, ts.surfaces[3]));
+    TEST_CHECK(pic_info->activeRefIdx[0] == 0);
+    TEST_CHECK(pic_info->activeRefIdx[1] == 1);
+    TEST_CHECK(pic_info->activeRefIdx[2] == 2);
+    TEST_CHECK(pic_info->refFrameSignBias[0] == 0);
+    TEST_CHECK(pic_info->refFrameSignBias[1] == 0);
+    TEST_CHECK(pic_info->refFrameSignBias[2] == 0);
+    TEST_CHECK(pic_info->refFrameSignBias[3] == 1);
+    TEST_CHECK(pic_info->segmentMapUpdate == 0);
+
+    /* Not updated by this frame, so carried over from the key frame */
+    TEST_CHECK(pic_info->colorSpace == 2);
+    TEST_CHECK(pic_info->mbRefLfDelta[0] == 1);
+    TEST_CHECK((int)pic_info->mbRefLfDelta[2] == -2);
+    TEST_CHECK(pic_info->mbModeLfDelta[0] == 3);
+    TEST_CHECK(pic_info->segmentFeatureMode == 1);
+    TEST_CHECK(pic_info->segmentFeatureEnable[1][0] == 1);
+    TEST_CHECK(pic_info->segmentFeatureData[1][0] == -10);
+    TEST_CHECK(pic_info->segmentFeatureData[2][1] == 5);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+
+#if USE_VDPAU_HIGH_BIT_DEPTH
+// Profile 2 decodes into 10-bit surfaces with the profile 2 decoder
+static int
+test_profile2(test_driver_t *driver)
+{
+    VADecPictureParameterBufferVP9 pic_param;
+    uint8_t frame_data[FRAME_DATA_SIZE];
+    bit_writer_t bw;
+    test_stream_t ts;
+
+    TEST_CHECK(open_stream(driver, &ts, VAProfileVP9Profile2,
+                           VA_RT_FORMAT_YUV420_10BPP) == 0);
+
+    memset(frame_data, 0, sizeof(frame_data));
+    bw.buf   = frame_data;
+    bw.index = 0;
+    put_bits(&bw, 2, 2);                /* frame_marker */
+    put_bits(&bw, 1, 0);                /* profile_low_bit */
+    put_bits(&bw, 1, 1);                /* profile_high_bit */
+    put_bits(&bw, 1, 0);                /* show_existing_frame */
+    put_bits(&bw, 1, 0);                /* frame_type: KEY_FRAME */
+    put_bits(&bw, 1, 1);                /* show_frame */
+    put_bits(&bw, 1, 0);                /* error_resilient_mode */
+    put_bits(&bw, 24, 0x498342);        /* frame_sync_code */
+    put_bits(&bw, 1, 0);                /* ten_or_twelve_bit: 10-bit */
+    put_bits(&bw, 3, 5);                /* color_space: CS_BT_2020 */
+    put_bits(&bw, 1, 0);                /* color_range */
+    put_bits(&bw, 16, PICTURE_WIDTH - 1);
+    put_bits(&bw, 16, PICTURE_HEIGHT - 1);
+    put_bits(&bw, 1, 0);                /* render_and_frame_size_different */
+    put_bits(&bw, 2, 0);                /* refresh_frame_context, parallel */
+    put_bits(&bw, 2, 0);                /* frame_context_idx */
+    put_loop_filter_and_quantizer(&bw, 0);
+    put_bits(&bw, 1, 0);                /* segmentation_enabled */
+    bw.index += 6 + 16;
+
+    init_pic_param(&pic_param);
+    pic_param.profile   = 2;
+    pic_param.bit_depth = 10;
+    pic_param.frame_header_length_in_bytes = (bw.index + 7) / 8;
+    TEST_CHECK(decode_picture(&ts, ts.surfaces[0], &pic_param,
+                              frame_data) == 0);
+    TEST_CHECK(rendered.profile == VDP_DECODER_PROFILE_VP9_PROFILE_2);
+    TEST_CHECK(rendered.info.profile == 2);
+    TEST_CHECK(rendered.info.bitDepthMinus8Luma == 2);
+    TEST_CHECK(rendered.info.bitDepthMinus8Chroma == 2);
+    TEST_CHECK(rendered.info.colorSpace == 5);
+    TEST_CHECK(rendered.info.qpYAc == 60);
+
+    TEST_CHECK(close_stream(&ts) == 0);
+    return 0;
+}
+#endif
+
+static int
+run_tests(test_driver_t *driver)
+{
+    TEST_CHECK(test_key_and_inter_frames(driver) == 0);
+#if USE_VDPAU_HIGH_BIT_DEPTH
+    TEST_CHECK(test_profile2(driver) == 0);
+#endif
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver);
+    test_driver_close(&driver);
+    return error < 0;
+}
+#else
+int
+main(int argc, char *argv[])
+{
+    return TEST_SKIPPED;
+}
+#endif
@@ -0,0 +1,219 @@
+/*
+ *  test_mpeg1.c - Tests for VDPAU_EXT_mpeg1
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "vdpau_ext.h"
+
+#define NUM_SURFACES            2
+#define SLICE_DATA_SIZE         64
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+typedef struct test_stream test_stream_t;
+struct test_stream {
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+};
+
+// Records the profile of the last decoder that rendered a picture
+static void
+render_hook(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    *(VdpDecoderProfile *)user_data = profile;
+}
+
+static int
+open_stream(
+    VADriverContextP    ctx,
+    test_stream_t      *stream,
+    VAProfile           profile,
+    VAConfigAttrib     *attrib_list,
+    int                 num_attribs
+)
+{
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ctx, profile, VAEntrypointVLD,
+                                         attrib_list, num_attribs,
+                                         &stream->config));
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           VA_RT_FORMAT_YUV420, NUM_SURFACES,
+                                           stream->surfaces));
+    TEST_CHECK_STATUS(vdpau_CreateContext(ctx, stream->config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          stream->surfaces, NUM_SURFACES,
+                                          &stream->context));
+    return 0;
+}
+
+static int
+close_stream(VADriverContextP ctx, test_stream_t *stream)
+{
+    TEST_CHECK_STATUS(vdpau_DestroyContext(ctx, stream->context));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, stream->surfaces,
+                                            NUM_SURFACES));
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ctx, stream->config));
+    return 0;
+}
+
+// Decodes an intra picture and returns the profile it was decoded with
+static int
+decode_picture(
+    VADriverContextP    ctx,
+    test_stream_t      *stream,
+    VdpDecoderProfile  *profile
+)
+{
+    VAPictureParameterBufferMPEG2 pic_param;
+    VASliceParameterBufferMPEG2 slice_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    VABufferID buffers[3];
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = SLICE_DATA_SIZE;
+
+    memset(slice_data, 0x42, sizeof(slice_data));
+
+    buffers[0] = test_create_buffer(ctx, stream->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    buffers[1] = test_create_buffer(ctx, stream->context,
+                                    VASliceParameterBufferType,
+                                    sizeof(slice_param), &slice_param);
+    buffers[2] = test_create_buffer(ctx, stream->context,
+                                    VASliceDataBufferType,
+                                    sizeof(slice_data), slice_data);
+
+    *profile = (VdpDecoderProfile)-1;
+    fake_vdpau_set_render_hook(render_hook, profile);
+    TEST_CHECK_STATUS(vdpau_BeginPicture(ctx, stream->context,
+                                         stream->surfaces[0]));
+    TEST_CHECK_STATUS(vdpau_RenderPicture(ctx, stream->context,
+                                          buffers, ARRAY_ELEMS(buffers)));
+    TEST_CHECK_STATUS(vdpau_EndPicture(ctx, stream->context));
+    fake_vdpau_set_render_hook(NULL, NULL);
+    return 0;
+}
+
+// The attribute is only reported for MPEG-2 profiles
+static int
+test_config_attributes(VADriverContextP ctx)
+{
+    VAConfigAttrib attrib;
+
+    attrib.type = VAConfigAttribMPEG1VDPAU;
+    TEST_CHECK_STATUS(vdpau_GetConfigAttributes(ctx, VAProfileMPEG2Simple,
+                                                VAEntrypointVLD, &attrib, 1));
+    TEST_CHECK(attrib.value == 1);
+    TEST_CHECK_STATUS(vdpau_GetConfigAttributes(ctx, VAProfileMPEG2Main,
+                                                VAEntrypointVLD, &attrib, 1));
+    TEST_CHECK(attrib.value == 1);
+    TEST_CHECK_STATUS(vdpau_GetConfigAttributes(ctx, VAProfileH264High,
+                                                VAEntrypointVLD, &attrib, 1));
+    TEST_CHECK(attrib.value == VA_ATTRIB_NOT_SUPPORTED);
+    return 0;
+}
+
+// Other profiles cannot be decoded as MPEG-1
+static int
+test_unsupported_profile(VADriverContextP ctx)
+{
+    VAConfigAttrib attrib;
+    VAConfigID config;
+
+    attrib.type  = VAConfigAttribMPEG1VDPAU;
+    attrib.value = 1;
+    TEST_CHECK(vdpau_CreateConfig(ctx, VAProfileH264High, VAEntrypointVLD,
+                                  &attrib, 1, &config) ==
+               VA_STATUS_ERROR_ATTR_NOT_SUPPORTED);
+    return 0;
+}
+
+// MPEG-1 and MPEG-2 streams decode side by side
+static int
+test_mixed_streams(VADriverContextP ctx)
+{
+    test_stream_t streams[3];
+    VAConfigAttrib attrib;
+    VdpDecoderProfile profile;
+    unsigned int i;
+
+    attrib.type  = VAConfigAttribMPEG1VDPAU;
+    attrib.value = 1;
+    TEST_CHECK(open_stream(ctx, &streams[0], VAProfileMPEG2Simple,
+                           &attrib, 1) == 0);
+    TEST_CHECK(open_stream(ctx, &streams[1], VAProfileMPEG2Simple,
+                           NULL, 0) == 0);
+    attrib.value = 0;
+    TEST_CHECK(open_stream(ctx, &streams[2], VAProfileMPEG2Main,
+                           &attrib, 1) == 0);
+
+    TEST_CHECK(decode_picture(ctx, &streams[0], &profile) == 0);
+    TEST_CHECK(profile == VDP_DECODER_PROFILE_MPEG1);
+    TEST_CHECK(decode_picture(ctx, &streams[1], &profile) == 0);
+    TEST_CHECK(profile == VDP_DECODER_PROFILE_MPEG2_SIMPLE);
+    TEST_CHECK(decode_picture(ctx, &streams[2], &profile) == 0);
+    TEST_CHECK(profile == VDP_DECODER_PROFILE_MPEG2_MAIN);
+
+    for (i = 0; i < ARRAY_ELEMS(streams); i++)
+        TEST_CHECK(close_stream(ctx, &streams[i]) == 0);
+    return 0;
+}
+
+static int
+run_tests(VADriverContextP ctx)
+{
+    TEST_CHECK(test_config_attributes(ctx) == 0);
+    TEST_CHECK(test_unsupported_profile(ctx) == 0);
+    TEST_CHECK(test_mixed_streams(ctx) == 0);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver.ctx);
+    test_driver_close(&driver);
+    return error < 0;
+}
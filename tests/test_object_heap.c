@@ -0,0 +1,106 @@
+/*
+ *  test_object_heap.c - Tests for object IDs
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "object_heap.h"
+
+#define NUM_GENERATIONS \
+    ((OBJECT_HEAP_GEN_MASK >> OBJECT_HEAP_GEN_SHIFT) + 1)
+#define NUM_SLOTS \
+    (OBJECT_HEAP_INDEX_MASK + 1)
+
+// A stale ID is rejected until its slot is recycled NUM_GENERATIONS times
+static int
+test_generations(object_heap_p heap)
+{
+    object_base_p obj;
+    unsigned int i;
+    int id, stale_id;
+
+    stale_id = object_heap_allocate(heap);
+    TEST_CHECK(stale_id > 0);
+    TEST_CHECK((stale_id & OBJECT_HEAP_OFFSET_MASK) == VDPAU_BUFFER_ID_OFFSET);
+    TEST_CHECK(object_heap_lookup(heap, stale_id) != NULL);
+
+    /* Objects of other types never match */
+    TEST_CHECK(object_heap_lookup(heap, (stale_id & OBJECT_HEAP_ID_MASK) |
+                                  VDPAU_SURFACE_ID_OFFSET) == NULL);
+
+    obj = object_heap_lookup(heap, stale_id);
+    for (i = 1; i < NUM_GENERATIONS; i++) {
+        object_heap_free(heap, obj);
+        id = object_heap_allocate(heap);
+        TEST_CHECK((id & OBJECT_HEAP_INDEX_MASK) ==
+                   (stale_id & OBJECT_HEAP_INDEX_MASK));
+        TEST_CHECK(id != stale_id);
+        TEST_CHECK(object_heap_lookup(heap, stale_id) == NULL);
+        obj = object_heap_lookup(heap, id);
+        TEST_CHECK(obj != NULL);
+    }
+
+    /* The generation wraps around */
+    object_heap_free(heap, obj);
+    id = object_heap_allocate(heap);
+    TEST_CHECK(id == stale_id);
+    object_heap_free(heap, object_heap_lookup(heap, id));
+    return 0;
+}
+
+static int
+free_object(object_base_p obj, void *user_data)
+{
+    object_heap_free(user_data, obj);
+    return 0;
+}
+
+// A heap holds NUM_SLOTS objects at most
+static int
+test_capacity(object_heap_p heap)
+{
+    unsigned int i;
+    int id;
+
+    for (i = 0; i < NUM_SLOTS; i++) {
+        id = object_heap_allocate(heap);
+        TEST_CHECK(id > 0);
+        TEST_CHECK(object_heap_lookup(heap, id) != NULL);
+    }
+    TEST_CHECK(object_heap_allocate(heap) == -1);
+    TEST_CHECK(object_heap_count(heap) == NUM_SLOTS);
+
+    object_heap_foreach(heap, free_object, heap);
+    TEST_CHECK(object_heap_count(heap) == 0);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct object_heap heap;
+    int error;
+
+    if (object_heap_init(&heap, sizeof(struct object_base),
+                         VDPAU_BUFFER_ID_OFFSET) < 0)
+        return 1;
+    error = test_generations(&heap) < 0 || test_capacity(&heap) < 0;
+    object_heap_destroy(&heap);
+    return error;
+}
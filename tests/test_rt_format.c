@@ -0,0 +1,101 @@
+/*
+ *  test_rt_format.c - Tests for render target formats
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_video.h"
+
+#define NUM_SURFACES            2
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+// Returns the VAConfigAttribRTFormat value of profile, or 0 on error
+static unsigned int
+get_rt_format(VADriverContextP ctx, VAProfile profile)
+{
+    VAConfigAttrib attrib;
+
+    attrib.type = VAConfigAttribRTFormat;
+    if (vdpau_GetConfigAttributes(ctx, profile, VAEntrypointVLD,
+                                  &attrib, 1) != VA_STATUS_SUCCESS)
+        return 0;
+    return attrib.value;
+}
+
+// 4:2:2 is advertised and accepted when VDPAU supports it
+static int
+test_422_supported(VADriverContextP ctx)
+{
+    VASurfaceID surfaces[NUM_SURFACES];
+
+    fake_vdpau_set_422_support(1);
+    TEST_CHECK(get_rt_format(ctx, VAProfileMPEG2Main) ==
+               (VA_RT_FORMAT_YUV420 | VA_RT_FORMAT_YUV422));
+    TEST_CHECK(get_rt_format(ctx, VAProfileMPEG2Simple) ==
+               VA_RT_FORMAT_YUV420);
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           VA_RT_FORMAT_YUV422, NUM_SURFACES,
+                                           surfaces));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, surfaces, NUM_SURFACES));
+    return 0;
+}
+
+// 4:2:2 is neither advertised nor accepted when VDPAU lacks it
+static int
+test_422_unsupported(VADriverContextP ctx)
+{
+    VASurfaceID surfaces[NUM_SURFACES];
+
+    fake_vdpau_set_422_support(0);
+    TEST_CHECK(get_rt_format(ctx, VAProfileMPEG2Main) == VA_RT_FORMAT_YUV420);
+    TEST_CHECK(vdpau_CreateSurfaces(ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                    VA_RT_FORMAT_YUV422, NUM_SURFACES,
+                                    surfaces) ==
+               VA_STATUS_ERROR_UNSUPPORTED_RT_FORMAT);
+
+    /* 4:2:0 surfaces are still fine */
+    TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx, PICTURE_WIDTH, PICTURE_HEIGHT,
+                                           VA_RT_FORMAT_YUV420, NUM_SURFACES,
+                                           surfaces));
+    TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, surfaces, NUM_SURFACES));
+    return 0;
+}
+
+static int
+run_tests(VADriverContextP ctx)
+{
+    TEST_CHECK(test_422_supported(ctx) == 0);
+    TEST_CHECK(test_422_unsupported(ctx) == 0);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    test_driver_t driver;
+    int error;
+
+    fake_vdpau_reset();
+    if (test_driver_open(&driver) < 0)
+        return 1;
+    error = run_tests(&driver.ctx);
+    test_driver_close(&driver);
+    return error < 0;
+}
@@ -0,0 +1,363 @@
+/*
+ *  test_stress.c - Decode from many contexts and threads at once
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/*
+ * Each context is driven by its own decode thread, with a second thread
+ * syncing and querying its surfaces, and is recreated every few pictures
+ * so that the decoder cache is shared across threads too. The stand-in
+ * VdpDecoderRender() takes a fixed time, checks that no decoder is used
+ * by two threads at once, and that each bitstream arrives intact into a
+ * surface of the context that submitted it.
+ *
+ * Since the rendering time dominates, contexts that do not serialize on
+ * a driver-wide lock decode NUM_CONTEXTS times faster than a single one.
+ * The test asks for a fourth of that, so that loaded machines pass too.
+ * ThreadSanitizer slows every lock down too much for any figure to hold.
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_buffer.h"
+#include "vdpau_decode.h"
+#include "vdpau_video.h"
+#include "utils.h"
+#include <pthread.h>
+
+#define NUM_CONTEXTS            16
+#define NUM_SURFACES            4
+#define NUM_PICTURES            200
+#define RECREATE_INTERVAL       50
+#define SLICE_DATA_SIZE         256
+#define RENDER_USEC             200
+#if defined(__SANITIZE_THREAD__)
+#define MIN_SPEEDUP             1
+#else
+#define MIN_SPEEDUP             (NUM_CONTEXTS / 4)
+#endif
+#define PICTURE_WIDTH           352
+#define PICTURE_HEIGHT          288
+
+/* Slice data starts with its start code, then the tag of its context */
+static const uint8_t slice_start_code[4] = { 0x00, 0x00, 0x01, 0x01 };
+#define TAG_OFFSET              sizeof(slice_start_code)
+
+typedef struct stress_context stress_context_t;
+struct stress_context {
+    VADriverContextP            ctx;
+    VAConfigID                  config;
+    VAContextID                 context;
+    VASurfaceID                 surfaces[NUM_SURFACES];
+    pthread_mutex_t             surface_locks[NUM_SURFACES];
+    unsigned int                tag;
+    unsigned int                num_pictures;
+    int                         is_done;
+    int                         errors;
+};
+
+/* Tag of the context each surface belongs to */
+typedef struct surface_tag surface_tag_t;
+struct surface_tag {
+    VdpVideoSurface             surface;
+    unsigned int                tag;
+};
+
+static pthread_mutex_t          surface_tags_lock = PTHREAD_MUTEX_INITIALIZER;
+static surface_tag_t            surface_tags[NUM_CONTEXTS * NUM_SURFACES];
+static unsigned int             num_surface_tags;
+static unsigned int             bad_bitstreams;
+
+static void
+reset_surface_tags(void)
+{
+    pthread_mutex_lock(&surface_tags_lock);
+    num_surface_tags = 0;
+    pthread_mutex_unlock(&surface_tags_lock);
+}
+
+// Check the bitstream is whole, and belongs to the target's context
+static void
+check_bitstream(
+    void                       *user_data,
+    VdpDecoder                  decoder,
+    VdpDecoderProfile           profile,
+    VdpVideoSurface             target,
+    const void                 *picture_info,
+    uint32_t                    bitstream_buffer_count,
+    const VdpBitstreamBuffer   *bitstream_buffers
+)
+{
+    unsigned int i, j, n = 0, tag = 0, seed = 0;
+    int is_valid = 1;
+
+    for (i = 0; i < bitstream_buffer_count; i++) {
+        const uint8_t * const buf = bitstream_buffers[i].bitstream;
+        for (j = 0; j < bitstream_buffers[i].bitstream_bytes; j++, n++) {
+            if (n < sizeof(slice_start_code)) {
+                if (buf[j] != slice_start_code[n])
+                    is_valid = 0;
+            }
+            else if (n == TAG_OFFSET)
+                tag = buf[j];
+            else if (n == TAG_OFFSET + 1)
+                seed = buf[j];
+            else if (buf[j] != ((tag * 31 + seed + n) & 0xff))
+                is_valid = 0;
+        }
+    }
+    if (n != SLICE_DATA_SIZE)
+        is_valid = 0;
+
+    /* Surfaces never move between contexts, so the first picture
+       decoded into a surface tells which context it belongs to */
+    pthread_mutex_lock(&surface_tags_lock);
+    for (i = 0; i < num_surface_tags; i++) {
+        if (surface_tags[i].surface == target)
+            break;
+    }
+    if (i < num_surface_tags) {
+        if (surface_tags[i].tag != tag)
+            is_valid = 0;
+    }
+    else if (i < ARRAY_ELEMS(surface_tags)) {
+        surface_tags[i].surface = target;
+        surface_tags[i].tag     = tag;
+        num_surface_tags++;
+    }
+    else
+        is_valid = 0;
+    pthread_mutex_unlock(&surface_tags_lock);
+
+    if (!is_valid)
+        __atomic_add_fetch(&bad_bitstreams, 1, __ATOMIC_RELAXED);
+}
+
+static int
+create_context(stress_context_t *sc)
+{
+    TEST_CHECK_STATUS(vdpau_CreateContext(sc->ctx, sc->config,
+                                          PICTURE_WIDTH, PICTURE_HEIGHT, 0,
+                                          sc->surfaces, NUM_SURFACES,
+                                          &sc->context));
+    return 0;
+}
+
+static int
+decode_picture(stress_context_t *sc, unsigned int n)
+{
+    VAPictureParameterBufferMPEG2 pic_param;
+    VASliceParameterBufferMPEG2 slice_param;
+    uint8_t slice_data[SLICE_DATA_SIZE];
+    VABufferID buffers[3];
+    unsigned int i;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    pic_param.horizontal_size            = PICTURE_WIDTH;
+    pic_param.vertical_size              = PICTURE_HEIGHT;
+    pic_param.forward_reference_picture  = VA_INVALID_SURFACE;
+    pic_param.backward_reference_picture = VA_INVALID_SURFACE;
+    pic_param.picture_coding_type        = 1; /* I */
+    pic_param.picture_coding_extension.bits.picture_structure = 3;
+
+    memset(&slice_param, 0, sizeof(slice_param));
+    slice_param.slice_data_size = SLICE_DATA_SIZE;
+
+    memcpy(slice_data, slice_start_code, sizeof(slice_start_code));
+    slice_data[TAG_OFFSET]     = sc->tag;
+    slice_data[TAG_OFFSET + 1] = n & 0xff;
+    for (i = TAG_OFFSET + 2; i < SLICE_DATA_SIZE; i++)
+        slice_data[i] = (sc->tag * 31 + slice_data[TAG_OFFSET + 1] + i) & 0xff;
+
+    buffers[0] = test_create_buffer(sc->ctx, sc->context,
+                                    VAPictureParameterBufferType,
+                                    sizeof(pic_param), &pic_param);
+    buffers[1] = test_create_buffer(sc->ctx, sc->context,
+                                    VASliceParameterBufferType,
+                                    sizeof(slice_param), &slice_param);
+    buffers[2] = test_create_buffer(sc->ctx, sc->context,
+                                    VASliceDataBufferType,
+                                    sizeof(slice_data), slice_data);
+    for (i = 0; i < ARRAY_ELEMS(buffers); i++)
+        TEST_CHECK(buffers[i] != VA_INVALID_BUFFER);
+
+    const unsigned int s = n % NUM_SURFACES;
+    pthread_mutex_lock(&sc->surface_locks[s]);
+    VAStatus va_status = vdpau_BeginPicture(sc->ctx, sc->context,
+                                            sc->surfaces[s]);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = vdpau_RenderPicture(sc->ctx, sc->context,
+                                        buffers, ARRAY_ELEMS(buffers));
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = vdpau_EndPicture(sc->ctx, sc->context);
+    pthread_mutex_unlock(&sc->surface_locks[s]);
+    TEST_CHECK_STATUS(va_status);
+    return 0;
+}
+
+static void *
+decode_thread(void *arg)
+{
+    stress_context_t * const sc = arg;
+    unsigned int n;
+
+    for (n = 0; n < sc->num_pictures; n++) {
+        if (n > 0 && n % RECREATE_INTERVAL == 0) {
+            if (vdpau_DestroyContext(sc->ctx, sc->context) != VA_STATUS_SUCCESS ||
+                create_context(sc) < 0) {
+                __atomic_add_fetch(&sc->errors, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+        if (decode_picture(sc, n) < 0) {
+            __atomic_add_fetch(&sc->errors, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    __atomic_store_n(&sc->is_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Surfaces may not be synced while they are being decoded into, hence
+   the per-surface locks */
+static void *
+sync_thread(void *arg)
+{
+    stress_context_t * const sc = arg;
+    VASurfaceStatus status;
+    unsigned int n = 0;
+
+    while (!__atomic_load_n(&sc->is_done, __ATOMIC_ACQUIRE)) {
+        const unsigned int s = n++ % NUM_SURFACES;
+        pthread_mutex_lock(&sc->surface_locks[s]);
+        if (vdpau_SyncSurface2(sc->ctx, sc->surfaces[s]) != VA_STATUS_SUCCESS ||
+            vdpau_QuerySurfaceStatus(sc->ctx, sc->surfaces[s],
+                                     &status) != VA_STATUS_SUCCESS)
+            __atomic_add_fetch(&sc->errors, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&sc->surface_locks[s]);
+
+        /* Like a player, sync about once per decoded picture */
+        delay_usec(RENDER_USEC);
+    }
+    return NULL;
+}
+
+// Decodes num_pictures pictures into each of num_contexts contexts
+static int
+run_contexts(
+    test_driver_t      *driver,
+    unsigned int        num_contexts,
+    unsigned int        num_pictures,
+    double             *elapsed_time
+)
+{
+    VADriverContextP const ctx = &driver->ctx;
+    stress_context_t contexts[NUM_CONTEXTS];
+    pthread_t threads[2 * NUM_CONTEXTS];
+    VAConfigID config;
+    unsigned int i, j;
+    int errors = 0;
+
+    TEST_CHECK(num_contexts <= NUM_CONTEXTS);
+    TEST_CHECK_STATUS(vdpau_CreateConfig(ctx, VAProfileMPEG2Main,
+                                         VAEntrypointVLD, NULL, 0, &config));
+
+    memset(contexts, 0, sizeof(contexts));
+    for (i = 0; i < num_contexts; i++) {
+        stress_context_t * const sc = &contexts[i];
+        sc->ctx          = ctx;
+        sc->config       = config;
+        sc->tag          = i + 1;
+        sc->num_pictures = num_pictures;
+        for (j = 0; j < NUM_SURFACES; j++)
+            pthread_mutex_init(&sc->surface_locks[j], NULL);
+        TEST_CHECK_STATUS(vdpau_CreateSurfaces(ctx,
+                                               PICTURE_WIDTH, PICTURE_HEIGHT,
+                                               VA_RT_FORMAT_YUV420,
+                                               NUM_SURFACES, sc->surfaces));
+        TEST_CHECK(create_context(sc) == 0);
+    }
+
+    const uint64_t start = get_ticks_usec();
+    for (i = 0; i < num_contexts; i++) {
+        TEST_CHECK(pthread_create(&threads[2 * i], NULL,
+                                  decode_thread, &contexts[i]) == 0);
+        TEST_CHECK(pthread_create(&threads[2 * i + 1], NULL,
+                                  sync_thread, &contexts[i]) == 0);
+    }
+    for (i = 0; i < 2 * num_contexts; i++)
+        pthread_join(threads[i], NULL);
+    *elapsed_time = (get_ticks_usec() - start) / 1000000.0;
+
+    for (i = 0; i < num_contexts; i++) {
+        stress_context_t * const sc = &contexts[i];
+        errors += sc->errors;
+        TEST_CHECK_STATUS(vdpau_DestroyContext(ctx, sc->context));
+        TEST_CHECK_STATUS(vdpau_DestroySurfaces(ctx, sc->surfaces,
+                                                NUM_SURFACES));
+        for (j = 0; j < NUM_SURFACES; j++)
+            pthread_mutex_destroy(&sc->surface_locks[j]);
+    }
+    TEST_CHECK_STATUS(vdpau_DestroyConfig(ctx, config));
+    TEST_CHECK(errors == 0);
+    return 0;
+}
+
+static int
+run_test(int async_decode)
+{
+    test_driver_t driver;
+    double serial_time, parallel_time;
+
+    setenv("VDPAU_VIDEO_ASYNC_DECODE", async_decode ? "yes" : "no", 1);
+    fake_vdpau_reset();
+    fake_vdpau_set_render_time(RENDER_USEC);
+    fake_vdpau_set_render_hook(check_bitstream, NULL);
+    bad_bitstreams = 0;
+    TEST_CHECK(test_driver_open(&driver) == 0);
+
+    reset_surface_tags();
+    TEST_CHECK(run_contexts(&driver, 1, NUM_PICTURES, &serial_time) == 0);
+    reset_surface_tags();
+    TEST_CHECK(run_contexts(&driver, NUM_CONTEXTS, NUM_PICTURES,
+                            &parallel_time) == 0);
+    test_driver_close(&driver);
+
+    const double speedup = NUM_CONTEXTS * serial_time / parallel_time;
+    printf("%s decode: 1 context %.1f pictures/s, %d contexts %.1f pictures/s, "
+           "speedup %.1fx\n",
+           async_decode ? "async" : "sync",
+           NUM_PICTURES / serial_time, NUM_CONTEXTS,
+           NUM_CONTEXTS * NUM_PICTURES / parallel_time, speedup);
+
+    TEST_CHECK(fake_vdpau_get_render_count() ==
+               (1 + NUM_CONTEXTS) * NUM_PICTURES);
+    TEST_CHECK(fake_vdpau_get_overlap_count() == 0);
+    TEST_CHECK(bad_bitstreams == 0);
+    TEST_CHECK(fake_vdpau_get_decoder_count() == 0);
+    TEST_CHECK(speedup >= MIN_SPEEDUP);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    if (run_test(0) < 0 || run_test(1) < 0)
+        return 1;
+    return 0;
+}
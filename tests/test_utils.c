@@ -0,0 +1,80 @@
+/*
+ *  test_utils.c - Helpers for tests and benchmarks
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "sysdeps.h"
+#include "test_utils.h"
+#include "vdpau_buffer.h"
+
+/* Driver entry-point, as looked up by libva */
+VAStatus VA_DRIVER_INIT_FUNC(void *ctx);
+
+/* Any non-NULL display will do, the stand-in device ignores it */
+static char test_display[64];
+
+// Loads the driver on the stand-in VDPAU device
+int
+test_driver_open(test_driver_t *driver)
+{
+    VAStatus va_status;
+
+    memset(driver, 0, sizeof(*driver));
+    driver->ctx.native_dpy             = (Display *)test_display;
+    driver->display.pDriverContext     = &driver->ctx;
+#if VA_CHECK_VERSION(0,32,0)
+    driver->ctx.vtable                 = &driver->vtable;
+#endif
+
+    va_status = VA_DRIVER_INIT_FUNC(&driver->ctx);
+    if (va_status != VA_STATUS_SUCCESS) {
+        fprintf(stderr, "driver initialization failed: status %d\n",
+                va_status);
+        return -1;
+    }
+    return 0;
+}
+
+// Runs vaTerminate()
+void
+test_driver_close(test_driver_t *driver)
+{
+#if VA_CHECK_VERSION(0,32,0)
+    driver->ctx.vtable->vaTerminate(&driver->ctx);
+#else
+    driver->ctx.vtable.vaTerminate(&driver->ctx);
+#endif
+}
+
+// Creates a VA buffer holding a copy of data
+VABufferID
+test_create_buffer(
+    VADriverContextP    ctx,
+    VAContextID         context,
+    VABufferType        type,
+    unsigned int        size,
+    const void         *data
+)
+{
+    VABufferID buf_id;
+
+    if (vdpau_CreateBuffer(ctx, context, type, size, 1, (void *)data,
+                           &buf_id) != VA_STATUS_SUCCESS)
+        return VA_INVALID_BUFFER;
+    return buf_id;
+}
@@ -0,0 +1,83 @@
+/*
+ *  test_utils.h - Helpers for tests and benchmarks
+ *
+ *  libva-vdpau-driver (C) 2009-2011 Splitted-Desktop Systems
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include "vdpau_driver.h"
+#include "fake_vdpau.h"
+
+/* Exit code that makes automake count a test as skipped */
+#define TEST_SKIPPED 77
+
+// Reports a failed check and returns from the calling function
+#define TEST_CHECK(expr) do {                                           \
+        if (!(expr)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                    __FILE__, __LINE__, #expr);                         \
+            return -1;                                                  \
+        }                                                               \
+    } while (0)
+
+// Reports a failed VA call and returns from the calling function
+#define TEST_CHECK_STATUS(expr) do {                                    \
+        const VAStatus test_va_status = (expr);                         \
+        if (test_va_status != VA_STATUS_SUCCESS) {                      \
+            fprintf(stderr, "%s:%d: %s returned status %d\n",           \
+                    __FILE__, __LINE__, #expr, test_va_status);         \
+            return -1;                                                  \
+        }                                                               \
+    } while (0)
+
+typedef struct test_driver test_driver_t;
+struct test_driver {
+    struct VADriverContext      ctx;
+    struct VADisplayContext     display;
+#if VA_CHECK_VERSION(0,32,0)
+    struct VADriverVTable       vtable;
+#endif
+};
+
+// Loads the driver on the stand-in VDPAU device
+int
+test_driver_open(test_driver_t *driver);
+
+// Runs vaTerminate()
+void
+test_driver_close(test_driver_t *driver);
+
+// Returns the driver data, for tests that look at driver internals
+static inline vdpau_driver_data_t *
+test_driver_get_data(test_driver_t *driver)
+{
+    return driver->ctx.pDriverData;
+}
+
+// Creates a VA buffer holding a copy of data
+VABufferID
+test_create_buffer(
+    VADriverContextP    ctx,
+    VAContextID         context,
+    VABufferType        type,
+    unsigned int        size,
+    const void         *data
+);
+
+#endif /* TEST_UTILS_H */